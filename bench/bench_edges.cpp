@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the capture edge kernels against the scalar ones, and
+ * against a plain copy of the buffer as the memory bandwidth reference.
+ * Built with src/gpio_capture_edges.cpp:
+ *
+ *   bench_edges [megabytes] [mean run length in samples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+#include "gpio.h"
+#include "gpio_capture.h"
+
+#define BENCH_ROUNDS 5
+
+static double now_s(void)
+{
+	return std::chrono::duration_cast<std::chrono::duration<double> >(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Random runs of mean length @run, as a square-ish signal would give */
+static void fill(std::vector<uint64_t> &words, unsigned int run)
+{
+	uint64_t state = 88172645463325252ULL;
+	uint64_t level = 0;
+	unsigned int left = 0;
+
+	for (size_t w = 0; w < words.size(); w++) {
+		uint64_t word = 0;
+
+		for (int bit = 0; bit < GPIO_CAPTURE_WORD_BITS; bit++) {
+			if (!left) {
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+				left = 1 + state % (2 * run);
+				level ^= 1;
+			}
+			left--;
+			word |= level << bit;
+		}
+		words[w] = word;
+	}
+}
+
+/* Best of BENCH_ROUNDS, in GB/s of samples read */
+template <class F>
+static double measure(size_t bytes, F run)
+{
+	double best = 0;
+
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		double start = now_s();
+		double elapsed;
+
+		run();
+		elapsed = now_s() - start;
+		if (bytes / elapsed / 1e9 > best)
+			best = bytes / elapsed / 1e9;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	size_t bytes = (size_t)(argc > 1 ? atoi(argv[1]) : 256) << 20;
+	unsigned int run = argc > 2 ? atoi(argv[2]) : 1000;
+	size_t word_count = bytes / sizeof(uint64_t);
+	std::vector<uint64_t> words(word_count);
+	std::vector<uint64_t> copy(word_count);
+	const struct gpio_capture_edge_ops_s *scalar = &gpio_capture_edge_scalar;
+	const struct gpio_capture_edge_ops_s *best = gpio_capture_edge_ops();
+	struct gpio_capture_edge_counts_s counts[2];
+	size_t edge_words[2];
+	double gbps;
+
+	fill(words, run);
+	printf("%zu MB, %llu samples, mean run %u samples\n", bytes >> 20,
+			(unsigned long long)word_count * GPIO_CAPTURE_WORD_BITS, run);
+
+	gbps = measure(bytes, [&] { memcpy(&copy[0], &words[0], bytes); });
+	printf("%-8s copy   %6.2f GB/s\n", "memcpy", gbps);
+
+	for (int k = 0; k < 2; k++) {
+		const struct gpio_capture_edge_ops_s *ops = k ? best : scalar;
+
+		gbps = measure(bytes, [&] {
+			counts[k].rising = counts[k].falling = counts[k].high = 0;
+			ops->count(&words[0], word_count, &counts[k]);
+		});
+		printf("%-8s count  %6.2f GB/s  rising %llu falling %llu duty %.4f\n", ops->name, gbps,
+				(unsigned long long)counts[k].rising, (unsigned long long)counts[k].falling,
+				(double)counts[k].high / ((double)word_count * GPIO_CAPTURE_WORD_BITS));
+
+		gbps = measure(bytes, [&] {
+			edge_words[k] = 0;
+			for (size_t w = ops->scan(&words[0], 0, word_count); w < word_count;
+					w = ops->scan(&words[0], w + 1, word_count))
+				edge_words[k]++;
+		});
+		printf("%-8s scan   %6.2f GB/s  %zu words with edges\n", ops->name, gbps, edge_words[k]);
+	}
+
+	if (memcmp(&counts[0], &counts[1], sizeof(counts[0])) || edge_words[0] != edge_words[1]) {
+		printf("MISMATCH between %s and %s\n", scalar->name, best->name);
+		return 1;
+	}
+	return 0;
+}
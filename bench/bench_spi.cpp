@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput of the software SPI master, unpaced, in each mode, against
+ * the same mode 0 bit stream written pin by pin with
+ * gpio_listener_set_data(). Needs the GPIO registers; built with the
+ * library:
+ *
+ *   bench_spi [kilobytes] [sclk pin] [mosi pin]
+ *
+ * The pins default to J27_11 and J27_12, which share a port.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+#include "gpio.h"
+
+#define BENCH_ROUNDS 5
+
+static double now_s(void)
+{
+	return std::chrono::duration_cast<std::chrono::duration<double> >(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Best of BENCH_ROUNDS, in bytes per second */
+template <class F>
+static double measure(size_t bytes, F run)
+{
+	double best = 0;
+
+	for (int i = 0; i < BENCH_ROUNDS; i++) {
+		double start = now_s();
+		double elapsed;
+
+		run();
+		elapsed = now_s() - start;
+		if (bytes / elapsed > best)
+			best = bytes / elapsed;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	size_t bytes = (size_t)(argc > 1 ? atoi(argv[1]) : 64) << 10;
+	gpio_pin_e sclk = argc > 2 ? (gpio_pin_e)strtol(argv[2], NULL, 0) : J27_11;
+	gpio_pin_e mosi = argc > 3 ? (gpio_pin_e)strtol(argv[3], NULL, 0) : J27_12;
+	std::vector<uint8_t> tx(bytes);
+	gpio_h sclk_gpio, mosi_gpio;
+	gpio_listener_h sclk_listener, mosi_listener;
+	gpio_spi_h spi;
+	double rate;
+
+	for (size_t i = 0; i < bytes; i++)
+		tx[i] = (uint8_t)(i * 0x9e3779b1 >> 24);
+
+	if (gpio_spi_create(sclk, mosi, &spi) != GPIO_ERROR_NONE) {
+		printf("cannot access the GPIO registers\n");
+		return 1;
+	}
+	printf("%zu KB, sclk %d, mosi %d\n", bytes >> 10, sclk, mosi);
+
+	for (int mode = GPIO_SPI_MODE_0; mode <= GPIO_SPI_MODE_3; mode++) {
+		gpio_spi_set_mode(spi, (gpio_spi_mode_e)mode);
+		rate = measure(bytes, [&] { gpio_spi_transfer(spi, &tx[0], NULL, bytes); });
+		printf("spi mode %d        %10.0f bytes/s\n", mode, rate);
+	}
+	gpio_spi_destroy(spi);
+
+	gpio_get_default_gpio(sclk, &sclk_gpio, GPIO_OUT);
+	gpio_get_default_gpio(mosi, &mosi_gpio, GPIO_OUT);
+	gpio_create_listener(sclk_gpio, &sclk_listener);
+	gpio_create_listener(mosi_gpio, &mosi_listener);
+
+	rate = measure(bytes, [&] {
+		for (size_t i = 0; i < bytes; i++) {
+			for (int n = 7; n >= 0; n--) {
+				gpio_listener_set_data(mosi_listener, (gpio_value_e)(tx[i] >> n & 1));
+				gpio_listener_set_data(sclk_listener, HIGH);
+				gpio_listener_set_data(sclk_listener, LOW);
+			}
+		}
+	});
+	printf("set_data mode 0    %10.0f bytes/s\n", rate);
+
+	gpio_destroy_listener(sclk_listener);
+	gpio_destroy_listener(mosi_listener);
+	return 0;
+}
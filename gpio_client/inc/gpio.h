@@ -85,9 +85,17 @@ typedef enum {
     GPIO_SET_DIRECTION,
     GPIO_GET_DIRECTION,
     GPIO_SET_VALUE,
-    GPIO_GET_VALUE
+    GPIO_GET_VALUE,
+    GPIO_SUBSCRIBE,
+    GPIO_UNSUBSCRIBE,
+    GPIO_EVENT,
+    GPIO_SET_CLOCK = 11, //10 is taken by debug messages
+    GPIO_ADVANCE_CLOCK
 } gpio_msg_e;
 
+/* Answer of a clock request the service does not take from this client */
+#define GPIO_CLOCK_DENIED -2
+
 /**
  * @brief   Enumeration for gpio types.
  * @since_tizen @if MOBILE 2.3 @elseif WEARABLE 2.3.1 @endif
@@ -351,6 +359,22 @@ typedef enum
     GPIO_PAUSE_ALL = 3,               /**< The gpio pauses in all the above cases */
 } gpio_pause_e;
 
+/**
+ * @brief   Enumeration for the edges reported by a gpio listener.
+ * @details Edge and level flags can be combined. A listener reports #GPIO_EDGE_BOTH by default.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_EDGE_NONE = 0,          /**< No event is reported */
+    GPIO_EDGE_RISING = 1,        /**< The pin changed from low to high */
+    GPIO_EDGE_FALLING = 2,       /**< The pin changed from high to low */
+    GPIO_EDGE_BOTH = 3,          /**< The pin changed in either direction */
+    GPIO_EDGE_LEVEL_HIGH = 4,    /**< Every sample in which the pin is high */
+    GPIO_EDGE_LEVEL_LOW = 8,     /**< Every sample in which the pin is low */
+} gpio_edge_e;
+
+
 
 /**
  * @brief   Called when a gpio event occurs.
@@ -468,6 +492,23 @@ EXPORT_API int gpio_listener_stop(gpio_listener_h listener);
  */
 EXPORT_API int gpio_listener_set_event_cb(gpio_listener_h listener, unsigned int interval_ms, gpio_event_cb callback, void *data);
 
+/**
+ * @brief   Selects which edges of the gpio are delivered via a given gpio listener.
+ * @details Samples that do not match @c edge are dropped by the sampler,
+ *          before any callback is invoked or any message is sent to the gpio service.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle
+ * @param[in]   edge        A combination of #gpio_edge_e flags
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ *
+ * @see gpio_listener_set_event_cb()
+ */
+EXPORT_API int gpio_listener_set_edge(gpio_listener_h listener, gpio_edge_e edge);
+
 /**
  * @brief   Unregisters the gpio event callback function attached to a given gpio listener.
  * @since_tizen @if MOBILE 2.3 @elseif WEARABLE 2.3.1 @endif
@@ -538,6 +579,45 @@ EXPORT_API int gpio_listener_read_data(gpio_listener_h listener, gpio_event_s *e
  */
 EXPORT_API int gpio_listener_set_interval(gpio_listener_h listener, unsigned int interval_ms);
 
+/**
+ * @brief   Switches a gpio listener to events delivered through a file descriptor.
+ * @details From then on, the events of the listener are queued instead of passed to its callback,
+ *          and the returned eventfd is readable while events are queued.
+ *          Add it to an epoll set or a GLib main loop, and call gpio_listener_drain() when it is readable,
+ *          so the events are handled on the thread of the loop, without a handoff from the thread receiving the messages of the service.@n
+ *          The queue holds 1024 events; when it is full, the oldest event is dropped.
+ *          The descriptor belongs to the listener and is closed when the listener is destroyed.
+ *          Calling this function again returns the same descriptor.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle
+ * @param[out]  fd          The file descriptor to poll for reading
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The eventfd cannot be created
+ *
+ * @see     gpio_listener_drain()
+ */
+EXPORT_API int gpio_listener_get_fd(gpio_listener_h listener, int *fd);
+
+/**
+ * @brief   Takes the queued events of a gpio listener in fd mode, without blocking.
+ * @details The events come oldest first. Once the queue is empty, the descriptor is no longer readable.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle, switched to fd mode by gpio_listener_get_fd()
+ * @param[out]  events      The events
+ * @param[in]   max_count   The number of entries in @c events
+ * @param[out]  count       The number of events taken, 0 if none was queued
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the listener is not in fd mode
+ */
+EXPORT_API int gpio_listener_drain(gpio_listener_h listener, gpio_event_s *events, unsigned int max_count, unsigned int *count);
+
 EXPORT_API int gpio_listener_set_data(gpio_listener_h listener, gpio_value_e data);
 
 #endif
@@ -548,6 +628,163 @@ EXPORT_API int gpio_listener_set_data(gpio_listener_h listener, gpio_value_e dat
 
 
 
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_CLOCK_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Switches the library between the real clock and a virtual clock.
+ * @details The clock is the one of the gpio service: its sampling deadlines and event timestamps follow the selected clock.
+ *          The virtual clock starts at the current time and only moves on gpio_clock_advance(),
+ *          so a scenario of several seconds runs as fast as its callbacks, with exact timestamps.
+ *          It should be selected before any listener is started.
+ *          Virtual time holds back the events of every client of the service, so the service only accepts it
+ *          when started with --virtual-clock, for tests, and then from one client at a time.
+ * @since_tizen 3.0
+ *
+ * @param[in]   enable  If @c true, the virtual clock; Otherwise the real clock
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_PERMISSION_DENIED    The service was not started with --virtual-clock,
+ *                                           or another client selected the virtual clock
+ * @retval  #GPIO_ERROR_IO_ERROR             The gpio service cannot be reached
+ */
+int gpio_clock_set_virtual(bool enable);
+
+/**
+ * @brief   Advances the virtual clock.
+ * @details Time moves from one deadline to the next, and the service samples every subscription due at a deadline
+ *          before time moves on. When this function returns, the callbacks of every event due up to the new time have run.
+ *          It must not be called from a callback.
+ * @since_tizen 3.0
+ *
+ * @param[in]   ns  The time to advance by, in nanoseconds
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    The virtual clock is not selected
+ * @retval  #GPIO_ERROR_PERMISSION_DENIED    Another client selected the virtual clock
+ * @retval  #GPIO_ERROR_IO_ERROR             The gpio service cannot be reached
+ * @see     gpio_clock_set_virtual()
+ */
+int gpio_clock_advance(unsigned long long ns);
+
+/**
+ * @brief   Gets the time of the clock in use, in nanoseconds from an arbitrary origin.
+ * @since_tizen 3.0
+ *
+ * @param[out]  ns  The time
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_clock_get_time(unsigned long long *ns);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_BUS_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Event bus reader handle.
+ * @details The gpio service publishes every change it sees on the ports it samples for the subscriptions
+ *          of any client to an event bus, a ring in shared memory with a single writer, read by any number of local processes.
+ *          A process that wants the events of a pin another client already listens to can read the bus instead
+ *          of creating its own listener.
+ *          Every reader has its own position in the ring; the writer never waits for readers,
+ *          and a reader too slow to keep up loses the oldest events, which it is told about.
+ *          Readers cost the publisher neither register reads nor messages.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_bus_reader_s *gpio_bus_reader_h;
+
+/**
+ * @brief   Event read from a bus, see gpio_bus_reader_read().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    unsigned long long sequence;   /**< Number of the event on the bus, one more than the previous one */
+    unsigned long long timestamp;  /**< Time of the sample, in milliseconds */
+    gpio_port_e port;              /**< The port */
+    uint32_t state;                /**< The state of the port */
+    uint32_t changed;              /**< The pins that changed since the previous event of the port,
+                                        0 for the first event of the port after the service started */
+} gpio_bus_event_s;
+
+/**
+ * @brief   Opens a reader of an event bus.
+ * @details The reader gets the events published from now on. It maps the bus read-only.
+ *          A publisher that restarts creates a new bus, which must be opened again.
+ * @since_tizen 3.0
+ *
+ * @param[in]   name    The name of the bus. If NULL, the bus of the gpio service.
+ * @param[out]  reader  The reader handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             There is no such bus
+ */
+int gpio_bus_reader_open(const char *name, gpio_bus_reader_h *reader);
+
+/**
+ * @brief   Closes a reader of an event bus.
+ * @since_tizen 3.0
+ *
+ * @param[in]   reader  The reader handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_bus_reader_close(gpio_bus_reader_h reader);
+
+/**
+ * @brief   Reads the next events of a bus, without blocking.
+ * @details When the writer lapped the reader, the reader goes on from the oldest event still in the ring,
+ *          and @c lost counts the events it missed. A reader handle must not be used by two threads at once.
+ * @since_tizen 3.0
+ *
+ * @param[in]   reader      The reader handle
+ * @param[out]  events      The events read, in order
+ * @param[in]   max_count   The number of entries in @c events
+ * @param[out]  count       The number of events read
+ * @param[out]  lost        The number of events missed since the previous call
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_bus_reader_read(gpio_bus_reader_h reader, gpio_bus_event_s *events, unsigned int max_count,
+		unsigned int *count, unsigned long long *lost);
+
+/**
+ * @brief   Waits until the reader has events to read.
+ * @since_tizen 3.0
+ *
+ * @param[in]   reader      The reader handle
+ * @param[in]   timeout_ms  The longest wait in milliseconds, 0 to only check, or -1 to wait forever
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Events are ready
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_NO_DATA              No event before the timeout
+ */
+int gpio_bus_reader_wait(gpio_bus_reader_h reader, int timeout_ms);
+
+/**
+ * @}
+ */
+
 #ifdef __cplusplus
 }
 #endif
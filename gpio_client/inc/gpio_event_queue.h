@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_EVENT_QUEUE_H__
+#define __GPIO_EVENT_QUEUE_H__
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <new>
+#include <atomic>
+#include <mutex>
+
+#include "gpio.h"
+
+/*
+ * Events of a listener in fd mode: the dispatching thread queues them
+ * instead of calling the callback, and the application drains them from
+ * its own loop. The eventfd is readable exactly while the queue holds
+ * events: a push onto an empty queue signals it, and the drain that
+ * empties the queue clears it, so the dispatcher makes one write per
+ * burst and never waits for the application.
+ *
+ * The queue is a ring of GPIO_EVENT_QUEUE_SIZE events; when it is full,
+ * the oldest event is dropped.
+ */
+
+#define GPIO_EVENT_QUEUE_SIZE 1024
+
+struct gpio_event_queue_s {
+	std::mutex lock;
+	std::atomic<int> fd; //-1 until the listener switches to fd mode
+	gpio_event_s *events;
+	unsigned int head; //oldest event
+	unsigned int count;
+
+	gpio_event_queue_s() : fd(-1), events(NULL), head(0), count(0) {}
+	~gpio_event_queue_s() {
+		if (fd >= 0)
+			close(fd);
+		delete[] events;
+	}
+};
+
+/* Switches to fd mode, if not done yet; returns the eventfd, or -1 */
+static inline int gpio_event_queue_open(struct gpio_event_queue_s *queue)
+{
+	std::lock_guard<std::mutex> lock(queue->lock);
+	int fd;
+
+	if (queue->fd >= 0)
+		return queue->fd;
+
+	queue->events = new(std::nothrow) gpio_event_s[GPIO_EVENT_QUEUE_SIZE];
+	if (!queue->events)
+		return -1;
+
+	fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fd < 0) {
+		delete[] queue->events;
+		queue->events = NULL;
+		return -1;
+	}
+	queue->fd.store(fd, std::memory_order_release);
+	return fd;
+}
+
+static inline bool gpio_event_queue_active(struct gpio_event_queue_s *queue)
+{
+	return queue->fd.load(std::memory_order_acquire) >= 0;
+}
+
+static inline void gpio_event_queue_push(struct gpio_event_queue_s *queue, const gpio_event_s *event)
+{
+	std::lock_guard<std::mutex> lock(queue->lock);
+	uint64_t one = 1;
+
+	if (queue->count == GPIO_EVENT_QUEUE_SIZE) {
+		queue->head = (queue->head + 1) % GPIO_EVENT_QUEUE_SIZE;
+		queue->count--;
+	}
+	queue->events[(queue->head + queue->count) % GPIO_EVENT_QUEUE_SIZE] = *event;
+
+	/* Only the first event of a burst signals, so the counter never saturates */
+	if (queue->count++ == 0)
+		(void)!write(queue->fd, &one, sizeof(one));
+}
+
+/* Moves up to @max_count events to @events, oldest first; returns how many */
+static inline unsigned int gpio_event_queue_drain(struct gpio_event_queue_s *queue,
+		gpio_event_s *events, unsigned int max_count)
+{
+	std::lock_guard<std::mutex> lock(queue->lock);
+	unsigned int n = 0;
+	uint64_t value;
+
+	while (n < max_count && queue->count) {
+		events[n++] = queue->events[queue->head];
+		queue->head = (queue->head + 1) % GPIO_EVENT_QUEUE_SIZE;
+		queue->count--;
+	}
+	if (!queue->count)
+		(void)!read(queue->fd, &value, sizeof(value));
+	return n;
+}
+
+#endif // __GPIO_EVENT_QUEUE_H__
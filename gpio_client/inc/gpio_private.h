@@ -17,6 +17,8 @@
 #include <thread>
 #include <atomic>
 
+#include "gpio_event_queue.h"
+
 #ifndef __GPIO_PRIVATE_H__
 #define __GPIO_PRIVATE_H__
 
@@ -30,16 +32,17 @@ struct gpio_listener_s {
 	gpio_pin_e pin;
 	gpio_direction_e direction;
 	gpio_value_e data;
+	gpio_edge_e edge;
 	int pause;
 	std::atomic<unsigned int> batch_latency;
 	unsigned int magic;
-	std::thread *read_thread;
 	std::atomic<bool> active; //if listener is started
 	gpio_h gpio;
 	gpio_event_cb callback;
 	void *user_data;
 	void *accu_callback;
 	void *accu_user_data;
+	struct gpio_event_queue_s queue; //events for gpio_listener_drain(), in fd mode
 };
 
 #ifdef __cplusplus
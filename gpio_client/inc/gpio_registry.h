@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_REGISTRY_H__
+#define __GPIO_REGISTRY_H__
+
+#include <stddef.h>
+
+#include "gpio_private.h"
+
+/*
+ * Listener registry with lock-free readers.
+ *
+ * The set of listeners is published as an immutable table, sorted by
+ * listener id. Writers copy the table, modify the copy and swap it in.
+ * Readers on the dispatch path only announce the epoch they entered in,
+ * so a table or listener that was unpublished is freed once every reader
+ * that could still see it has left its read section.
+ */
+
+struct gpio_registry_table_s {
+	size_t count;
+	gpio_listener_h listeners[1];
+};
+
+/* Reader side: never blocks, may be nested */
+void gpio_registry_read_lock(void);
+void gpio_registry_read_unlock(void);
+
+/* Must be called between gpio_registry_read_lock() and gpio_registry_read_unlock() */
+const struct gpio_registry_table_s *gpio_registry_table(void);
+gpio_listener_h gpio_registry_find(const struct gpio_registry_table_s *table, int id);
+
+/* Writer side: writers are serialized among themselves only */
+int gpio_registry_add(gpio_listener_h listener);
+
+/*
+ * Unpublishes @listener and deletes it once no reader can reach it.
+ * Waits for in-flight dispatches to finish, unless called from inside a
+ * read section (e.g. from a callback), where the deletion is deferred.
+ */
+int gpio_registry_remove(gpio_listener_h listener);
+
+/* Frees whatever retired memory is no longer reachable; never blocks */
+void gpio_registry_reclaim(void);
+
+#endif // __GPIO_REGISTRY_H__
@@ -22,9 +22,12 @@
 #include <unistd.h>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 #include "gpio.h"
 #include "gpio_private.h"
+#include "gpio_registry.h"
 #include <libgen.h>
 #include <memory>
 #include "gpio_log.h"
@@ -68,6 +71,11 @@ using std::map;
 
 #define GPIO_LISTENER_MAGIC 0xCAFECAFE
 
+#define GPIO_INTERVAL_MIN_MS 1
+#define GPIO_NS_PER_MS 1000000
+#define GPIO_PING_COUNT 4
+#define GPIO_PING_TIMEOUT_NS 100000000ULL
+
 #define CONVERT_AXIS_ENUM(X) ((X) < 3 ? (X) + 0x81 : (X) - 2)
 
 #define CONVERT_OPTION_PAUSE_POLICY(option) ((option) ^ 0b11)
@@ -84,7 +92,24 @@ static uint8_t gpio_isinit = 0;
 static int msg_queue_id;
 static pid_t p_num;
 
-map<gpio_pin_e, gpio_listener_h> listener_map;
+/* Round trip through the service measured at init, 0 if it did not answer */
+static uint64_t ipc_round_trip_ns = 0;
+
+/* Listeners live in the registry, where several of them may watch the same pin */
+static std::atomic<int> listener_count(0);
+
+/*
+ * The clock is the service's: clock requests are answered through the
+ * message listener, after every event due before the answer.
+ */
+static std::mutex clock_request_lock; //one clock request at a time
+static std::mutex clock_lock;
+static std::condition_variable clock_cond;
+static unsigned int clock_answers = 0;
+static int8_t clock_return = 0;
+static std::atomic<bool> clock_virtual(false);
+static std::atomic<uint64_t> clock_time_ns(0); //service time in the last answer
+static std::atomic<unsigned long long> clock_timestamp_ms(0);
 
 map<gpio_pin_e, gpio_direction_e> gpio_direction;
 map<gpio_pin_e, gpio_value_e> gpio_value;
@@ -127,6 +152,30 @@ inline int8_t msg_get_return (msg_data data) {
     return data.data_buff[2];
 }
 
+inline unsigned long long msg_get_timestamp(const msg_data &data) {
+    return *(uint64_t *)(data.data_buff+8);
+}
+
+inline void msg_set_interval(msg_data *data, unsigned int interval_ms) {
+    *(uint32_t *)(data->data_buff+8) = interval_ms;
+}
+
+inline int msg_get_id(const msg_data &data) {
+    return *(int32_t *)(data.data_buff+16);
+}
+
+inline void msg_set_id(msg_data *data, int id) {
+    *(int32_t *)(data->data_buff+16) = id;
+}
+
+inline void msg_set_clock(msg_data *data, uint64_t ns) {
+    *(uint64_t *)(data->data_buff+8) = ns;
+}
+
+inline uint64_t msg_get_clock_timestamp(const msg_data &data) {
+    return *(uint64_t *)(data.data_buff+24);
+}
+
 
 int send_message(const void *msgp) {
     if (-1 == msgsnd(msg_queue_id, msgp, sizeof(msg_data) - sizeof(long), 0)) {
@@ -154,6 +203,13 @@ static void message_listener() {
         }
         gpio_pin_e pin = msg_get_pin(data);
         gpio_msg_e msg_type = msg_get_type(data);
+
+        /* Dispatch never locks; listeners destroyed meanwhile are freed after it */
+        gpio_registry_read_lock();
+        const gpio_registry_table_s *table = gpio_registry_table();
+        size_t count = table ? table->count : 0;
+        gpio_listener_h listener;
+
         switch(msg_type) {
         case GPIO_OPEN_PIN:
             break;
@@ -162,47 +218,54 @@ static void message_listener() {
             break;
 
         case GPIO_SET_DIRECTION:
-            if (listener_map.find(pin) != listener_map.end() && listener_map[pin]) {
-                if (msg_get_return(data) != -1) listener_map[pin]->direction = msg_get_direction(data);
-            }
-            break;
-
         case GPIO_GET_DIRECTION: //Should not be called
-            if (listener_map.find(pin) != listener_map.end() && listener_map[pin]) {
-                 if (msg_get_return(data) != -1) listener_map[pin]->direction = msg_get_direction(data);
+            if (msg_get_return(data) == -1) break;
+            for (size_t i = 0; i < count; i++) {
+                if (table->listeners[i]->pin == pin) table->listeners[i]->direction = msg_get_direction(data);
             }
             break;
 
         case GPIO_SET_VALUE:
-            if (listener_map.find(pin) != listener_map.end() && listener_map[pin]) {
-                if (msg_get_return(data) != -1) listener_map[pin]->data = msg_get_value(data);
+        case GPIO_GET_VALUE:
+            if (msg_get_return(data) == -1) break;
+            for (size_t i = 0; i < count; i++) {
+                if (table->listeners[i]->pin == pin) table->listeners[i]->data = msg_get_value(data);
             }
             break;
 
-        case GPIO_GET_VALUE:
-            if (listener_map.find(pin) != listener_map.end() && listener_map[pin]) {
-				if (msg_get_return(data) == -1) break;
-                gpio_listener_h listener = listener_map[pin];
-                int prev_value = listener->data;
+        case GPIO_SUBSCRIBE:
+        case GPIO_UNSUBSCRIBE:
+            if (msg_get_return(data) == -1)
+                _D("Subscription request failed for listener %d", msg_get_id(data));
+            break;
+
+        case GPIO_EVENT:
+            /* The service only sends the edges the listener subscribed to */
+            if ((listener = gpio_registry_find(table, msg_get_id(data)))) {
                 listener->data = msg_get_value(data);
 
-		        if (prev_value != listener->data && listener->callback) {
-			        gpio_event_s *event = new gpio_event_s;
-			        event->timestamp =
-				        std::chrono::duration_cast<std::chrono::milliseconds>(
-					        std::chrono::system_clock::now().time_since_epoch()).count();
-			        event->value = listener->data;
-
-			        send_debug_message("Callback fired");
-			        gpio_event_cb
-			        (*listener->callback)(
-					        listener->gpio,
-					        event,
-					        listener->user_data);
-			        delete event;
-		        }
+                if (listener->active) {
+                    gpio_event_s event;
+                    event.timestamp = msg_get_timestamp(data);
+                    event.value = listener->data;
+                    if (gpio_event_queue_active(&listener->queue))
+                        gpio_event_queue_push(&listener->queue, &event);
+                    else if (listener->callback)
+                        (*listener->callback)(listener->gpio, &event, listener->user_data);
+                }
             }
             break;
+        case GPIO_SET_CLOCK:
+        case GPIO_ADVANCE_CLOCK:
+            {
+                std::lock_guard<std::mutex> lock(clock_lock);
+                clock_return = msg_get_return(data);
+                clock_time_ns = msg_get_timestamp(data);
+                clock_timestamp_ms = msg_get_clock_timestamp(data);
+                clock_answers++;
+            }
+            clock_cond.notify_all();
+            break;
         case 10:
           printf("Got debug message\n");
           break;
@@ -210,9 +273,58 @@ static void message_listener() {
             perror("undefined message");
             break;
         }
+        gpio_registry_read_unlock();
+        gpio_registry_reclaim();
     }
 }
 
+static uint64_t gpio_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Measures the round trip through the service before the message listener
+ * runs, with requests that have no effect: unsubscribing an unknown id.
+ */
+static void measure_round_trip() {
+    uint64_t total = 0;
+
+    for (int i = 0; i < GPIO_PING_COUNT; i++) {
+        msg_data data;
+        uint64_t start = gpio_now_ns();
+        bool answered = false;
+
+        msg_create(&data, GPIO_UNSUBSCRIBE, (gpio_pin_e)0);
+        msg_set_id(&data, GPIO_UNDEFINED_ID);
+        if (send_message(&data) < 0)
+            return;
+
+        while (gpio_now_ns() - start < GPIO_PING_TIMEOUT_NS) {
+            if (-1 != msgrcv(msg_queue_id, &data, sizeof(msg_data) - sizeof(long), p_num, IPC_NOWAIT)) {
+                answered = true;
+                break;
+            }
+            std::this_thread::yield();
+        }
+        if (!answered) {
+            _W("gpio service did not answer within %llu ns", GPIO_PING_TIMEOUT_NS);
+            return;
+        }
+        total += gpio_now_ns() - start;
+    }
+
+    ipc_round_trip_ns = total / GPIO_PING_COUNT;
+    _D("gpio service round trip : %llu ns", (unsigned long long)ipc_round_trip_ns);
+}
+
+/* An event cannot be delivered faster than one round trip through the service */
+static unsigned int gpio_min_interval() {
+    unsigned int interval = (ipc_round_trip_ns + GPIO_NS_PER_MS - 1) / GPIO_NS_PER_MS;
+
+    return interval < GPIO_INTERVAL_MIN_MS ? GPIO_INTERVAL_MIN_MS : interval;
+}
+
 static int init_gpio() {
     if (-1 == (msg_queue_id = msgget((key_t)913, IPC_CREAT | 0666))) {
         perror("msgget() failed.");
@@ -220,6 +332,7 @@ static int init_gpio() {
     }
     gpio_isinit = 1;
     p_num = getpid();
+    measure_round_trip();
     std::thread message_thread(message_listener);
     message_thread.detach();
     return 0;
@@ -238,51 +351,48 @@ static int request_pin_mode(gpio_pin_e pin) {
     return send_message(&data);
 }
 
-static int8_t request_pin_value(gpio_pin_e pin) {
+static int set_pin_value(gpio_pin_e pin, gpio_value_e value) {
     msg_data data;
-    msg_create(&data, GPIO_GET_VALUE, pin);
+    msg_create(&data, GPIO_SET_VALUE, pin, value);
     return send_message(&data);
 }
 
-
-static int set_pin_value(gpio_pin_e pin, gpio_value_e value) {
+/* Asks the service to sample the pin and to report the listener's edges only */
+static int subscribe_pin(gpio_listener_h listener) {
     msg_data data;
-    msg_create(&data, GPIO_SET_VALUE, pin, value);
+    unsigned int interval = listener->batch_latency;
+
+    msg_create(&data, GPIO_SUBSCRIBE, listener->pin, listener->edge);
+    msg_set_interval(&data, interval < gpio_min_interval() ? gpio_min_interval() : interval);
+    msg_set_id(&data, listener->id);
     return send_message(&data);
 }
 
-static void gpio_data_listener(gpio_listener_h listener) {
-	while(listener->active) {
-		std::this_thread::sleep_for(
-			std::chrono::nanoseconds(listener->batch_latency*1000*1000));
-		if (request_pin_value(listener->pin) < 0) {
-			_D("PIN ERROR");
-			return;
-		}
-	}
+static int unsubscribe_pin(gpio_listener_h listener) {
+    msg_data data;
+    msg_create(&data, GPIO_UNSUBSCRIBE, listener->pin);
+    msg_set_id(&data, listener->id);
+    return send_message(&data);
 }
 
 //finished
 static int gpio_connect(gpio_h gpio, gpio_listener_h listener)
 {
 	gpio_pin_e pin = (gpio_pin_e)gpio->pin;
-	int id = pin;
+	int id = listener_count++;
 
 	if (!listener)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	_D("called gpio_connect : listener[0x%x], gpio[0x%x]", listener, gpio);
 
-	if (listener_map.find(pin) != listener_map.end() && listener_map[pin]) {
-		_D("Listener associated with pin %d is destroyed\n", pin);
-		gpio_destroy_listener(listener_map[pin]);
-	}
-
-	listener_map[pin] = listener;
 	listener->id = id;
 	listener->pin = pin;
 	listener->direction = gpio->direction;
 
+	if (gpio_registry_add(listener) != GPIO_ERROR_NONE)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
 	_D("success gpio_connect: id[%d]", id);
 
 	return id;
@@ -326,6 +436,27 @@ int gpio_get_gpio_list(gpio_pin_e pin, gpio_h **list, int *gpio_count)
 	return GPIO_ERROR_NOT_SUPPORTED;
 }
 
+int gpio_get_min_interval(gpio_h gpio, int *min_interval)
+{
+	if (!gpio || !min_interval)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*min_interval = gpio_min_interval();
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_get_max_batch_count(gpio_h gpio, int *max_batch_count)
+{
+	if (!gpio || !max_batch_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* The service sends every event in its own message */
+	*max_batch_count = 0;
+
+	return GPIO_ERROR_NONE;
+}
+
 int gpio_is_wake_up(gpio_h gpio, bool *wakeup)
 {
 	return GPIO_ERROR_NONE;
@@ -347,6 +478,14 @@ int gpio_create_listener(gpio_h gpio, gpio_listener_h *listener)
 	if (!_listener)
 		return GPIO_ERROR_OUT_OF_MEMORY;
 
+	_listener->gpio = gpio;
+	_listener->active = false;
+	_listener->callback = NULL;
+	_listener->user_data = NULL;
+	_listener->edge = GPIO_EDGE_BOTH;
+	_listener->pause = GPIO_PAUSE_ALL;
+	_listener->batch_latency = GPIO_BATCH_LATENCY_DEFAULT;
+
 	error = gpio_connect(gpio, _listener);
 
 	if (error < 0) {
@@ -354,9 +493,6 @@ int gpio_create_listener(gpio_h gpio, gpio_listener_h *listener)
 		return GPIO_ERROR_IO_ERROR;
 	}
 
-	_listener->gpio = gpio;
-	_listener->pause = GPIO_PAUSE_ALL;
-	_listener->batch_latency = GPIO_BATCH_LATENCY_DEFAULT;
 	_listener->magic = GPIO_LISTENER_MAGIC;
 
 	*listener = (gpio_listener_h) _listener;
@@ -377,16 +513,11 @@ int gpio_destroy_listener(gpio_listener_h listener)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	gpio_listener_stop(listener);
-	//wait for batch latency+10ms for thread to finish
-	//TODO: replace this with safer code e.g. using conditional variable
-	std::this_thread::sleep_for(
-			std::chrono::nanoseconds((listener->batch_latency+10)*1000*1000));
-	
-	listener_map[listener->pin] = NULL;
 
 	listener->magic = 0;
 
-	delete (struct gpio_listener_s *)listener;
+	/* Deleted by the registry once no dispatch in flight can reach it */
+	gpio_registry_remove(listener);
 
 	_D("success gpio_destroy");
 
@@ -404,9 +535,9 @@ int gpio_listener_start(gpio_listener_h listener)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	if (listener->direction == GPIO_IN) {
+		if (subscribe_pin(listener) < 0)
+			return GPIO_ERROR_IO_ERROR;
 		listener->active = true;
-		listener->read_thread = new std::thread(gpio_data_listener, listener);
-		listener->read_thread->detach();
 	}
 
 	_D("success gpio_listener_start : pin[%x]", listener->pin);
@@ -424,8 +555,9 @@ int gpio_listener_stop(gpio_listener_h listener)
 	if (listener->magic != GPIO_LISTENER_MAGIC)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
-	if (listener->direction == GPIO_IN) {
+	if (listener->direction == GPIO_IN && listener->active) {
 		listener->active = false;
+		unsubscribe_pin(listener);
 	}
 
 	_D("success gpio_listener_stop");
@@ -451,6 +583,25 @@ int gpio_listener_set_event_cb(gpio_listener_h listener,
 	return GPIO_ERROR_NONE;
 }
 
+int gpio_listener_set_edge(gpio_listener_h listener, gpio_edge_e edge)
+{
+	_D("called gpio_listener_set_edge : listener[0x%x], edge[%d]", listener, edge);
+
+	if (!listener || (edge & ~(GPIO_EDGE_BOTH | GPIO_EDGE_LEVEL_HIGH | GPIO_EDGE_LEVEL_LOW)))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	listener->edge = edge;
+	if (listener->active && subscribe_pin(listener) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_D("success gpio_listener_set_edge");
+
+	return GPIO_ERROR_NONE;
+}
+
 int gpio_listener_unset_event_cb(gpio_listener_h listener)
 {
 	_D("called gpio_unregister_event : listener[0x%x]", listener);
@@ -480,6 +631,8 @@ int gpio_listener_set_interval(gpio_listener_h listener, unsigned int interval)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	listener->batch_latency = interval;
+	if (listener->active && subscribe_pin(listener) < 0)
+		return GPIO_ERROR_IO_ERROR;
 
 	_D("success gpio_set_interval");
 
@@ -511,7 +664,7 @@ int gpio_listener_read_data(gpio_listener_h listener, gpio_event_s *event)
 	_D("called gpio_read_data : listener[0x%x]", listener);
 
 	event->value = (gpio_value_e)listener->data;
-	event->timestamp =
+	event->timestamp = clock_virtual ? clock_timestamp_ms.load() :
 		std::chrono::duration_cast<std::chrono::milliseconds>(
 			std::chrono::system_clock::now().time_since_epoch()).count();
 	_D("success gpio_read_data");
@@ -519,6 +672,105 @@ int gpio_listener_read_data(gpio_listener_h listener, gpio_event_s *event)
 	return GPIO_ERROR_NONE;
 }
 
+int gpio_listener_get_fd(gpio_listener_h listener, int *fd)
+{
+	int _fd;
+
+	_D("called gpio_listener_get_fd : listener[0x%x]", listener);
+
+	if (!listener || !fd)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	_fd = gpio_event_queue_open(&listener->queue);
+	if (_fd < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	*fd = _fd;
+
+	_D("success gpio_listener_get_fd : fd[%d]", _fd);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_listener_drain(gpio_listener_h listener, gpio_event_s *events, unsigned int max_count, unsigned int *count)
+{
+	if (!listener || !events || !count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC || !gpio_event_queue_active(&listener->queue))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*count = gpio_event_queue_drain(&listener->queue, events, max_count);
+
+	return GPIO_ERROR_NONE;
+}
+
+/* Sends a clock request to the service and waits for its answer */
+static int request_clock(gpio_msg_e msg_type, uint8_t value, uint64_t ns)
+{
+	msg_data data;
+
+	if (!gpio_isinit) init_gpio();
+
+	std::lock_guard<std::mutex> request(clock_request_lock);
+	std::unique_lock<std::mutex> lock(clock_lock);
+	unsigned int answers = clock_answers;
+
+	msg_create(&data, msg_type, (gpio_pin_e)0, value);
+	msg_set_clock(&data, ns);
+	if (send_message(&data) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	clock_cond.wait(lock, [answers] { return clock_answers != answers; });
+	if (clock_return == GPIO_CLOCK_DENIED)
+		return GPIO_ERROR_PERMISSION_DENIED;
+	return clock_return < 0 ? GPIO_ERROR_INVALID_PARAMETER : GPIO_ERROR_NONE;
+}
+
+int gpio_clock_set_virtual(bool enable)
+{
+	int error;
+
+	_D("called gpio_clock_set_virtual : enable[%d]", enable);
+
+	error = request_clock(GPIO_SET_CLOCK, enable, 0);
+	if (error)
+		return error;
+	clock_virtual = enable;
+
+	_D("success gpio_clock_set_virtual");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_clock_advance(unsigned long long ns)
+{
+	int error;
+
+	_D("called gpio_clock_advance : ns[%llu]", ns);
+
+	error = request_clock(GPIO_ADVANCE_CLOCK, 0, ns);
+	if (error)
+		return error;
+
+	_D("success gpio_clock_advance : now[%llu]", (unsigned long long)clock_time_ns.load());
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_clock_get_time(unsigned long long *ns)
+{
+	if (!ns)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*ns = clock_virtual ? clock_time_ns.load() : gpio_now_ns();
+
+	return GPIO_ERROR_NONE;
+}
+
 const char * __gpio_get_name(gpio_pin_e pin) {
 	switch(pin) {
 		case GPX0_0: return "GPX0_0";
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <new>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_bus.h"
+#include "gpio_log.h"
+
+/*
+ * Reader side of the event bus of the gpio service, see gpio_bus.h.
+ * Reading takes no message: the service publishes whatever it samples.
+ */
+
+struct gpio_bus_reader_s {
+	const struct gpio_bus_header_s *header;
+	size_t size;
+	uint32_t slot_count; //as checked against the size of the mapping
+	uint64_t cursor; //sequence of the next event to read
+	uint64_t lost; //events overwritten before they were read
+};
+
+/* Maps the bus @name read-only, and checks its layout; NULL if it is not a bus */
+static const struct gpio_bus_header_s *bus_map(const char *name, size_t *size)
+{
+	struct gpio_bus_header_s *header;
+	struct stat st;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*header)) {
+		close(fd);
+		return NULL;
+	}
+
+	header = (struct gpio_bus_header_s *)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+		return NULL;
+
+	if (!gpio_bus_valid(header, st.st_size)) {
+		munmap(header, st.st_size);
+		return NULL;
+	}
+
+	*size = st.st_size;
+	return header;
+}
+
+int gpio_bus_reader_open(const char *name, gpio_bus_reader_h *reader)
+{
+	struct gpio_bus_reader_s *_reader;
+
+	_D("called gpio_bus_reader_open : name[%s]", name);
+
+	if (!reader)
+		return GPIO_ERROR_INVALID_PARAMETER;
+	if (!name)
+		name = GPIO_BUS_DEFAULT_NAME;
+
+	_reader = new(std::nothrow) struct gpio_bus_reader_s;
+	if (!_reader)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_reader->header = bus_map(name, &_reader->size);
+	if (!_reader->header) {
+		delete _reader;
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	/* Only the events published from now on */
+	_reader->slot_count = _reader->header->slot_count;
+	_reader->cursor = __atomic_load_n(&_reader->header->head, __ATOMIC_ACQUIRE);
+	_reader->lost = 0;
+
+	*reader = _reader;
+
+	_D("success gpio_bus_reader_open : reader[0x%x], slot_count[%u]", _reader, _reader->slot_count);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_bus_reader_close(gpio_bus_reader_h reader)
+{
+	_D("called gpio_bus_reader_close : reader[0x%x]", reader);
+
+	if (!reader)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	munmap((void *)reader->header, reader->size);
+	delete reader;
+
+	_D("success gpio_bus_reader_close");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_bus_reader_read(gpio_bus_reader_h reader, gpio_bus_event_s *events, unsigned int max_count,
+		unsigned int *count, unsigned long long *lost)
+{
+	const struct gpio_bus_header_s *header;
+	uint64_t head;
+	unsigned int n = 0;
+
+	if (!reader || (!events && max_count) || !count || !lost)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	header = reader->header;
+	head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+
+	while (n < max_count) {
+		struct gpio_bus_slot_s slot;
+		int ret;
+
+		if (head - reader->cursor > reader->slot_count) {
+			reader->lost += head - reader->slot_count - reader->cursor;
+			reader->cursor = head - reader->slot_count;
+		}
+		if (reader->cursor == head)
+			break;
+
+		ret = gpio_bus_get(header, reader->slot_count, reader->cursor, &slot);
+		if (ret > 0)
+			break;
+		if (ret < 0) {
+			/* Overwritten while copied: the writer is at least a lap ahead */
+			head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+			continue;
+		}
+
+		events[n].sequence = reader->cursor;
+		events[n].timestamp = slot.timestamp;
+		events[n].port = (gpio_port_e)slot.port;
+		events[n].state = slot.state;
+		events[n].changed = slot.changed;
+		n++;
+		reader->cursor++;
+	}
+
+	*count = n;
+	*lost = reader->lost;
+	reader->lost = 0;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_bus_reader_wait(gpio_bus_reader_h reader, int timeout_ms)
+{
+	const struct gpio_bus_header_s *header;
+	uint32_t futex;
+
+	if (!reader)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	header = reader->header;
+
+	/* The futex word is read first, so an event published after the check still wakes us */
+	futex = __atomic_load_n(&header->futex, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&header->head, __ATOMIC_ACQUIRE) != reader->cursor)
+		return GPIO_ERROR_NONE;
+	if (!timeout_ms)
+		return GPIO_ERROR_NO_DATA;
+
+	gpio_bus_sleep(header, futex, timeout_ms);
+
+	return __atomic_load_n(&header->head, __ATOMIC_ACQUIRE) != reader->cursor ?
+		GPIO_ERROR_NONE : GPIO_ERROR_NO_DATA;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_registry.h"
+#include "gpio_log.h"
+
+#define GPIO_REGISTRY_MAX_READERS 32
+#define GPIO_REGISTRY_QUIESCENT 0
+
+/* One cache line per reader, so readers do not contend with each other */
+struct alignas(64) gpio_registry_reader_s {
+	std::atomic<bool> used;
+	std::atomic<uint64_t> epoch; /* epoch the reader entered in, or GPIO_REGISTRY_QUIESCENT */
+};
+
+struct gpio_registry_retired_s {
+	struct gpio_registry_table_s *table;
+	gpio_listener_h listener;
+	uint64_t epoch;
+};
+
+static struct gpio_registry_reader_s registry_readers[GPIO_REGISTRY_MAX_READERS];
+static std::atomic<uint64_t> registry_epoch(1);
+static std::atomic<struct gpio_registry_table_s *> registry_table(NULL);
+
+/* Serializes writers; readers never take it */
+static std::mutex registry_writer_lock;
+static std::vector<gpio_registry_retired_s> registry_retired;
+
+/* Releases the reader slot of a thread when it exits */
+struct gpio_registry_slot_s {
+	int index;
+	int depth;
+
+	gpio_registry_slot_s() : index(-1), depth(0) {}
+	~gpio_registry_slot_s() {
+		if (index >= 0) {
+			registry_readers[index].epoch.store(GPIO_REGISTRY_QUIESCENT, std::memory_order_release);
+			registry_readers[index].used.store(false, std::memory_order_release);
+		}
+	}
+};
+
+static thread_local gpio_registry_slot_s registry_slot;
+
+static struct gpio_registry_table_s *registry_table_alloc(size_t count)
+{
+	struct gpio_registry_table_s *table;
+
+	table = (struct gpio_registry_table_s *)malloc(sizeof(*table) +
+			(count ? count - 1 : 0) * sizeof(gpio_listener_h));
+	if (table)
+		table->count = count;
+	return table;
+}
+
+static void registry_claim_slot(void)
+{
+	while (registry_slot.index < 0) {
+		for (int i = 0; i < GPIO_REGISTRY_MAX_READERS; i++) {
+			bool expected = false;
+			if (registry_readers[i].used.compare_exchange_strong(expected, true)) {
+				registry_slot.index = i;
+				return;
+			}
+		}
+		_W("All %d registry reader slots are in use", GPIO_REGISTRY_MAX_READERS);
+		std::this_thread::yield();
+	}
+}
+
+void gpio_registry_read_lock(void)
+{
+	if (registry_slot.depth++)
+		return;
+	registry_claim_slot();
+	registry_readers[registry_slot.index].epoch.store(registry_epoch.load());
+}
+
+void gpio_registry_read_unlock(void)
+{
+	if (--registry_slot.depth)
+		return;
+	registry_readers[registry_slot.index].epoch.store(GPIO_REGISTRY_QUIESCENT, std::memory_order_release);
+}
+
+const struct gpio_registry_table_s *gpio_registry_table(void)
+{
+	return registry_table.load();
+}
+
+gpio_listener_h gpio_registry_find(const struct gpio_registry_table_s *table, int id)
+{
+	size_t low = 0, high;
+
+	if (!table)
+		return NULL;
+
+	high = table->count;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if (table->listeners[mid]->id < id)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low < table->count && table->listeners[low]->id == id)
+		return table->listeners[low];
+	return NULL;
+}
+
+/* True once no reader can still hold anything unpublished before @epoch */
+static bool registry_grace_elapsed(uint64_t epoch)
+{
+	for (int i = 0; i < GPIO_REGISTRY_MAX_READERS; i++) {
+		uint64_t reader = registry_readers[i].epoch.load();
+		if (reader != GPIO_REGISTRY_QUIESCENT && reader < epoch)
+			return false;
+	}
+	return true;
+}
+
+/* Called with registry_writer_lock held */
+static void registry_reclaim_locked(void)
+{
+	std::vector<gpio_registry_retired_s>::iterator it = registry_retired.begin();
+
+	if (registry_slot.depth)
+		return;
+
+	while (it != registry_retired.end()) {
+		if (!registry_grace_elapsed(it->epoch)) {
+			++it;
+			continue;
+		}
+		free(it->table);
+		delete it->listener;
+		it = registry_retired.erase(it);
+	}
+}
+
+/* Called with registry_writer_lock held; returns the epoch after which @old is unreachable */
+static uint64_t registry_publish(struct gpio_registry_table_s *table,
+		struct gpio_registry_table_s *old, gpio_listener_h listener)
+{
+	gpio_registry_retired_s retired;
+
+	registry_table.store(table);
+	retired.table = old;
+	retired.listener = listener;
+	retired.epoch = registry_epoch.fetch_add(1) + 1;
+	registry_retired.push_back(retired);
+	return retired.epoch;
+}
+
+int gpio_registry_add(gpio_listener_h listener)
+{
+	std::lock_guard<std::mutex> lock(registry_writer_lock);
+	struct gpio_registry_table_s *old = registry_table.load();
+	size_t count = old ? old->count : 0;
+	struct gpio_registry_table_s *table;
+	size_t i, j = 0;
+
+	table = registry_table_alloc(count + 1);
+	if (!table)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	for (i = 0; i < count && old->listeners[i]->id < listener->id; i++)
+		table->listeners[j++] = old->listeners[i];
+	table->listeners[j++] = listener;
+	for (; i < count; i++)
+		table->listeners[j++] = old->listeners[i];
+
+	registry_publish(table, old, NULL);
+	registry_reclaim_locked();
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_registry_remove(gpio_listener_h listener)
+{
+	std::unique_lock<std::mutex> lock(registry_writer_lock);
+	struct gpio_registry_table_s *old = registry_table.load();
+	struct gpio_registry_table_s *table;
+	size_t i, j = 0;
+	uint64_t epoch;
+
+	if (!old || gpio_registry_find(old, listener->id) != listener)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	table = registry_table_alloc(old->count - 1);
+	if (!table)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	for (i = 0; i < old->count; i++) {
+		if (old->listeners[i] != listener)
+			table->listeners[j++] = old->listeners[i];
+	}
+
+	epoch = registry_publish(table, old, listener);
+
+	/* From inside a callback the caller's own dispatch still holds the listener */
+	if (registry_slot.depth)
+		return GPIO_ERROR_NONE;
+
+	lock.unlock();
+	while (!registry_grace_elapsed(epoch))
+		std::this_thread::yield();
+	lock.lock();
+	registry_reclaim_locked();
+
+	return GPIO_ERROR_NONE;
+}
+
+void gpio_registry_reclaim(void)
+{
+	std::unique_lock<std::mutex> lock(registry_writer_lock, std::try_to_lock);
+
+	if (lock.owns_lock())
+		registry_reclaim_locked();
+}
@@ -20,14 +20,18 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
 
 #include <sys/time.h>
 #include <limits.h>
 #include <math.h>
 
 #include <thread>
-#include <chrono>
 #include <map>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 
 #include <sys/types.h>
 #include <sys/ipc.h>
@@ -36,6 +40,8 @@
 #include <fcntl.h>
 
 #include "gpio.h"
+#include "gpio_clock.h"
+#include "gpio_bus.h"
 
 using std::map;
 
@@ -45,11 +51,35 @@ using std::map;
 #define GET_PORT(pin) ((pin) >> 3)
 #define GET_OFFSET(pin) ((pin) & 7)
 
+#define GPIO_NS_PER_MS 1000000
+#define GPIO_SAMPLER_IDLE_NS 1000000000ULL
+
 static uint8_t gpio_isinit = 0;
 static volatile uint32_t *gpio_base[2];
 
 map<gpio_pin_e, int> port_used;
 
+struct gpio_subscription_s {
+    gpio_pin_e pin;
+    gpio_edge_e edge;
+    unsigned int interval_ms;
+    uint32_t prev;
+    uint64_t due; //next sampling time in ns of gpio_clock_now_ns()
+};
+
+/* Subscriptions are keyed by (client pid, listener id) and sampled by subscription_sampler() */
+static map<std::pair<long, int>, gpio_subscription_s> subscriptions;
+static std::mutex subscription_lock;
+static std::condition_variable subscription_cond;
+
+/* Set by --virtual-clock; the client that selected the virtual clock, or 0 */
+static bool clock_allowed = false;
+static long clock_owner = 0;
+
+/* Event bus of the ports the sampler reads, for local readers; see gpio_bus.h */
+static gpio_bus_writer_s bus_writer;
+static map<gpio_port_e, uint32_t> bus_states;
+
 #ifdef GPIO_DUMMY
 map<gpio_pin_e, gpio_direction_e> gpio_direction;
 map<gpio_pin_e, gpio_value_e> gpio_value;
@@ -65,6 +95,32 @@ msg_data data;
  * data_buff[1]: message parameter (value/direction for SET, undefined otherwise)
  * data_buff[2]: return value (-1 for error, 0 for OK, 0/1 for GET)
  * (uint32_t*)(data_buff + 4): offset for pin
+ *
+ * GPIO_SUBSCRIBE carries the gpio_edge_e in data_buff[1] and the sampling
+ * interval in milliseconds in (uint32_t*)(data_buff + 8).
+ * GPIO_EVENT is sent to a subscriber only for edges it asked for; it carries
+ * the new value in data_buff[1] and the timestamp in milliseconds in
+ * (uint64_t*)(data_buff + 8).
+ * GPIO_SUBSCRIBE, GPIO_UNSUBSCRIBE and GPIO_EVENT identify the client's
+ * listener with (int32_t*)(data_buff + 16), so a client may subscribe
+ * several listeners to the same pin.
+ *
+ * GPIO_SET_CLOCK selects the virtual clock if data_buff[1] is set, the real
+ * one otherwise. GPIO_ADVANCE_CLOCK advances the virtual clock by
+ * (uint64_t*)(data_buff + 8) ns, and is answered once every event due up to
+ * the new time was sent. Both answers carry the time of the clock in ns in
+ * (uint64_t*)(data_buff + 8) and the matching event timestamp in
+ * milliseconds in (uint64_t*)(data_buff + 24).
+ * Virtual time holds back the events of every client, and advancing it
+ * blocks the message loop, so it is for a service started with
+ * --virtual-clock, for tests. Only the client that selected it may advance
+ * it or select the real clock again; other requests are answered with
+ * GPIO_CLOCK_DENIED. Once that client exited, the next request of any
+ * client brings the real clock back first.
+ *
+ * Besides the messages, the service publishes every change of a port its
+ * sampler reads to the GPIO_BUS_DEFAULT_NAME event bus, which any number
+ * of local processes read without a subscription of their own.
  */
 
 void msg_create(msg_data &data, long target, gpio_msg_e msg_type, gpio_pin_e pin, int return_value, int value=0) {
@@ -92,13 +148,45 @@ inline gpio_direction_e msg_get_direction(const msg_data &data) {
     return (gpio_direction_e)data.data_buff[1];
 }
 
+inline gpio_edge_e msg_get_edge(const msg_data &data) {
+    return (gpio_edge_e)data.data_buff[1];
+}
+
+inline unsigned int msg_get_interval(const msg_data &data) {
+    return *(uint32_t *)(data.data_buff+8);
+}
+
+inline int msg_get_id(const msg_data &data) {
+    return *(int32_t *)(data.data_buff+16);
+}
+
+inline void msg_set_id(msg_data &data, int id) {
+    *(int32_t *)(data.data_buff+16) = id;
+}
+
 inline void msg_set_return (msg_data &data, char value) {
     data.data_buff[2] = value;
 }
 
+inline void msg_set_timestamp(msg_data &data, uint64_t timestamp) {
+    *(uint64_t *)(data.data_buff+8) = timestamp;
+}
 
-void send_message(const void *msgp) {
-    if (-1 == msgsnd(msg_queue_id, msgp, sizeof(msg_data) - sizeof(long), 0)) {
+inline uint64_t msg_get_clock(const msg_data &data) {
+    return *(uint64_t *)(data.data_buff+8);
+}
+
+inline void msg_set_clock(msg_data &data, uint64_t time_ns, uint64_t timestamp_ms) {
+    *(uint64_t *)(data.data_buff+8) = time_ns;
+    *(uint64_t *)(data.data_buff+24) = timestamp_ms;
+}
+
+
+/* Sends a message; with IPC_NOWAIT in @flags, returns false instead of waiting for room in the queue */
+static bool msg_send(const void *msgp, int flags) {
+    if (-1 == msgsnd(msg_queue_id, msgp, sizeof(msg_data) - sizeof(long), flags)) {
+        if (errno == EAGAIN)
+            return false;
         perror("msgsnd() failed.");
         exit(1);
     }
@@ -107,6 +195,16 @@ void send_message(const void *msgp) {
     int pin = data->data_buff[1];
     printf("\tMSG SENT. To: %ld, type=%d, port = 0x%x, pin=0x%x, bufs=[%d %d]\n", data->data_type, msg_type, GET_PORT(pin), GET_OFFSET(pin), data->data_buff[1], data->data_buff[2]);
     printf("\t Buffer: %08x %08x\n", *(uint32_t *)(data->data_buff), *(uint32_t *)(data->data_buff+4));
+    return true;
+}
+
+void send_message(const void *msgp) {
+    msg_send(msgp, 0);
+}
+
+/* Whether client @pid has exited, so what it left in the service can go */
+static bool client_exited(long pid) {
+    return kill((pid_t)pid, 0) == -1 && errno == ESRCH;
 }
 
 
@@ -174,22 +272,31 @@ static int8_t get_pin_mode(gpio_pin_e pin) {
 #endif
 }
 
-static int8_t get_pin_value(gpio_pin_e pin) {
-    gpio_port_e port = (gpio_port_e)GET_PORT(pin);
-    uint8_t offset = GET_OFFSET(pin);
-
+static int8_t get_port_value(gpio_port_e port, uint32_t *value) {
     if (!gpio_isinit) {
         perror("GPIO is not initialized!!\n");
         return -1;
     }
 #ifndef GPIO_DUMMY
     volatile uint32_t *base = gpio_base[port > 0x100?0:1];
-    return !!(*(base + (port + 1)) & (1 << offset));
+    *value = *(base + (port + 1));
 #else
-    return gpio_value[pin];
+    *value = 0;
+    for (auto it = gpio_value.begin(); it != gpio_value.end(); ++it) {
+        if (GET_PORT(it->first) == port && it->second)
+            *value |= 1 << GET_OFFSET(it->first);
+    }
 #endif
+    return 0;
 }
 
+static int8_t get_pin_value(gpio_pin_e pin) {
+    uint32_t value;
+
+    if (get_port_value((gpio_port_e)GET_PORT(pin), &value) < 0)
+        return -1;
+    return !!(value & (1 << GET_OFFSET(pin)));
+}
 
 static int8_t set_pin_value(gpio_pin_e pin, gpio_value_e value) {
     if (get_pin_mode(pin) != GPIO_OUT) {
@@ -221,8 +328,211 @@ static int8_t set_pin_value(gpio_pin_e pin, gpio_value_e value) {
     return 0;
 }
 
+/*
+ * Returns the bits of a port snapshot that raise an event for @edge, given
+ * the previous snapshot of the same port. Every flag of @edge is widened to
+ * an all-ones or all-zeros mask, so all pins are evaluated without branches.
+ */
+static inline uint32_t gpio_edge_filter(gpio_edge_e edge, uint32_t prev, uint32_t snapshot) {
+    uint32_t changed = prev ^ snapshot;
+
+    return (changed & snapshot & -(uint32_t)(edge & 1)) |
+        (changed & ~snapshot & -(uint32_t)((edge >> 1) & 1)) |
+        (snapshot & -(uint32_t)((edge >> 2) & 1)) |
+        (~snapshot & -(uint32_t)((edge >> 3) & 1));
+}
+
+static int8_t subscribe(long client, int id, gpio_pin_e pin, gpio_edge_e edge, unsigned int interval_ms) {
+    std::lock_guard<std::mutex> lock(subscription_lock);
+    std::pair<long, int> key(client, id);
+    uint32_t snapshot;
+
+    if (subscriptions.find(key) == subscriptions.end() || subscriptions[key].pin != pin) {
+        if (get_port_value((gpio_port_e)GET_PORT(pin), &snapshot) < 0)
+            return -1;
+        subscriptions[key].prev = snapshot;
+    }
+    gpio_subscription_s &sub = subscriptions[key];
+    sub.pin = pin;
+    sub.edge = edge;
+    sub.interval_ms = interval_ms;
+    sub.due = gpio_clock_now_ns() + (uint64_t)interval_ms * GPIO_NS_PER_MS;
+    gpio_clock_notify(subscription_cond);
+    return 0;
+}
+
+static int8_t unsubscribe(long client, int id) {
+    std::lock_guard<std::mutex> lock(subscription_lock);
+
+    return subscriptions.erase(std::make_pair(client, id)) ? 0 : -1;
+}
+
+#define GPIO_PORT_CACHE_SIZE 8
+
+/* Port registers read during one sampler pass, shared by every subscription due in it */
+struct gpio_port_cache_s {
+    int count;
+    gpio_port_e port[GPIO_PORT_CACHE_SIZE];
+    uint32_t value[GPIO_PORT_CACHE_SIZE];
+};
+
+static int8_t get_cached_port_value(gpio_port_cache_s &cache, gpio_port_e port, uint32_t *value) {
+    for (int i = 0; i < cache.count; i++) {
+        if (cache.port[i] == port) {
+            *value = cache.value[i];
+            return 0;
+        }
+    }
+    if (get_port_value(port, value) < 0)
+        return -1;
+    if (cache.count < GPIO_PORT_CACHE_SIZE) {
+        cache.port[cache.count] = port;
+        cache.value[cache.count++] = *value;
+    }
+    return 0;
+}
+
+/* Creates the default bus afresh; readers of a previous run must open it again */
+static int bus_start() {
+    if (!gpio_bus_writer_open(&bus_writer, GPIO_BUS_DEFAULT_NAME, GPIO_BUS_SLOT_COUNT_DEFAULT)) {
+        perror("Bus creation failed.");
+        bus_writer.header = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Publishes the state of a port the sampler read, if it changed; called by the sampler only */
+static void bus_publish(gpio_port_e port, uint32_t state, uint64_t timestamp_ms) {
+    auto it = bus_states.find(port);
+    uint32_t changed = 0;
+
+    if (!bus_writer.header)
+        return;
+    if (it != bus_states.end()) {
+        changed = it->second ^ state;
+        if (!changed)
+            return;
+    }
+    bus_states[port] = state;
+    gpio_bus_put(&bus_writer, timestamp_ms, port, state, changed);
+}
+
+/*
+ * Drops the subscriptions of clients that exited without unsubscribing,
+ * and the events queued for them, which nobody would read to make room
+ * in the queue; called with subscription_lock held.
+ */
+static void purge_subscriptions() {
+    msg_data stale;
+
+    for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+        long client = it->first.first;
+
+        if (!client_exited(client)) {
+            ++it;
+            continue;
+        }
+        it = subscriptions.erase(it);
+        while (msgrcv(msg_queue_id, &stale, sizeof(msg_data) - sizeof(long), client, IPC_NOWAIT) != -1)
+            ;
+    }
+}
+
+/*
+ * Samples every subscription when it is due, and only messages the edges
+ * its subscriber asked for. A port is read once per pass, however many
+ * subscriptions share it.
+ *
+ * Events are sent once the pass released subscription_lock, and without
+ * waiting: an event that finds the queue full is dropped, so a client
+ * that stopped reading cannot stall the sampler, nor SUBSCRIBE and
+ * UNSUBSCRIBE behind it. Subscriptions of exited clients are purged about
+ * every GPIO_SAMPLER_IDLE_NS.
+ */
+static void subscription_sampler() {
+    msg_data event_data;
+    std::vector<msg_data> pending; //events of the pass, sent after it
+    unsigned long long dropped = 0;
+    uint64_t purge_due = 0;
+    std::unique_lock<std::mutex> lock(subscription_lock);
+
+    gpio_clock_enter();
+    while (1) {
+        uint64_t now = gpio_clock_now_ns();
+        uint64_t wake = now + GPIO_SAMPLER_IDLE_NS;
+        uint64_t timestamp = gpio_clock_timestamp_ms();
+        gpio_port_cache_s cache;
+
+        if (now >= purge_due) {
+            purge_subscriptions();
+            purge_due = now + GPIO_SAMPLER_IDLE_NS;
+        }
+
+        cache.count = 0;
+        pending.clear();
+        for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it) {
+            gpio_subscription_s &sub = it->second;
+            uint32_t bit = 1 << GET_OFFSET(sub.pin);
+            uint32_t snapshot;
+
+            if (sub.due <= now) {
+                sub.due = now + (uint64_t)sub.interval_ms * GPIO_NS_PER_MS;
+                if (get_cached_port_value(cache, (gpio_port_e)GET_PORT(sub.pin), &snapshot) == 0) {
+                    uint32_t events = gpio_edge_filter(sub.edge, sub.prev, snapshot) & bit;
+                    sub.prev = snapshot;
+                    if (events) {
+                        msg_create(event_data, it->first.first, GPIO_EVENT, sub.pin, 0, !!(snapshot & bit));
+                        msg_set_timestamp(event_data, timestamp);
+                        msg_set_id(event_data, it->first.second);
+                        pending.push_back(event_data);
+                    }
+                }
+            }
+            if (sub.due < wake)
+                wake = sub.due;
+        }
+        for (int i = 0; i < cache.count; i++)
+            bus_publish(cache.port[i], cache.value[i], timestamp);
+
+        if (!pending.empty()) {
+            lock.unlock();
+            for (size_t i = 0; i < pending.size(); i++) {
+                /* Logged at powers of two, as a LEVEL subscription may drop an event every sample */
+                if (!msg_send(&pending[i], IPC_NOWAIT) && !(++dropped & (dropped - 1)))
+                    printf("Event queue full, event to %ld dropped (%llu so far)\n", pending[i].data_type, dropped);
+            }
+            lock.lock();
+
+            /* Subscriptions may have changed meanwhile, without waking a sampler that was not waiting */
+            continue;
+        }
+        gpio_clock_wait_until(lock, subscription_cond, wake);
+    }
+}
+
+/* Goes back to the real clock if the client that selected the virtual one exited without doing so */
+static void clock_check_owner() {
+    if (clock_owner && client_exited(clock_owner)) {
+        printf("Clock owner %ld exited, back to the real clock\n", clock_owner);
+        gpio_clock_set_virtual(false);
+        clock_owner = 0;
+    }
+}
+
+/* Whether client @pid may select the virtual clock, or the real one if @virtual_time is false */
+static bool clock_request_allowed(long pid, bool virtual_time) {
+    if (clock_owner)
+        return pid == clock_owner;
+    return clock_allowed || !virtual_time;
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--virtual-clock"))
+            clock_allowed = true;
+    }
 
-int main() {
     init_gpio();
     
     if (-1 == (msg_queue_id = msgget((key_t)913, IPC_CREAT | 0666))) {
@@ -230,6 +540,13 @@ int main() {
         exit(1);
     }   
 
+    /* Readers only miss the bus, clients still get their events */
+    bus_start();
+
+    gpio_clock_hold();
+    std::thread sampler_thread(subscription_sampler);
+    sampler_thread.detach();
+
     msg_data return_data;
     while (1) {
         if (-1 == msgrcv(msg_queue_id, &data, sizeof(msg_data) - sizeof(long), 1, 0)) {
@@ -241,6 +558,9 @@ int main() {
         printf("MSG received. from: %ld, type=%d, port = 0x%x, pin=0x%x, bufs=[%d %d]\n", data.data_num, msg_type, GET_PORT(pin), GET_OFFSET(pin), data.data_buff[1], data.data_buff[2]);
         printf(" Buffer: %08x %08x\n", *(uint32_t *)(data.data_buff), *(uint32_t *)(data.data_buff+4));
         int8_t res;
+
+        /* Virtual time holds back every client, so it must not outlive its owner */
+        clock_check_owner();
         switch(msg_type) {
         case GPIO_OPEN_PIN:
             if (!port_used[pin]) {
@@ -287,6 +607,44 @@ int main() {
             send_message(&return_data);
             break;
 
+        case GPIO_SUBSCRIBE:
+            res = subscribe(data.data_num, msg_get_id(data), pin, msg_get_edge(data), msg_get_interval(data));
+            msg_create(return_data, data.data_num, msg_type, pin, res, msg_get_edge(data));
+            msg_set_id(return_data, msg_get_id(data));
+            send_message(&return_data);
+            break;
+
+        case GPIO_UNSUBSCRIBE:
+            res = unsubscribe(data.data_num, msg_get_id(data));
+            msg_create(return_data, data.data_num, msg_type, pin, res);
+            msg_set_id(return_data, msg_get_id(data));
+            send_message(&return_data);
+            break;
+
+        case GPIO_SET_CLOCK:
+            if (!clock_request_allowed(data.data_num, msg_get_value(data) != LOW)) {
+                res = GPIO_CLOCK_DENIED;
+            } else {
+                res = gpio_clock_set_virtual(msg_get_value(data) != LOW) == GPIO_ERROR_NONE ? 0 : -1;
+                if (!res)
+                    clock_owner = msg_get_value(data) != LOW ? data.data_num : 0;
+            }
+            msg_create(return_data, data.data_num, msg_type, pin, res, msg_get_value(data));
+            msg_set_clock(return_data, gpio_clock_now_ns(), gpio_clock_timestamp_ms());
+            send_message(&return_data);
+            break;
+
+        case GPIO_ADVANCE_CLOCK:
+            /* Blocks until the sampler has sent every event due up to the new time */
+            if (clock_owner != data.data_num)
+                res = clock_owner ? GPIO_CLOCK_DENIED : -1;
+            else
+                res = gpio_clock_advance(msg_get_clock(data)) == GPIO_ERROR_NONE ? 0 : -1;
+            msg_create(return_data, data.data_num, msg_type, pin, res);
+            msg_set_clock(return_data, gpio_clock_now_ns(), gpio_clock_timestamp_ms());
+            send_message(&return_data);
+            break;
+
         default:
             perror("undefined message");
             data.data_buff[BUFF_SIZE-1] = 0;
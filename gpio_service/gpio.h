@@ -26,9 +26,17 @@ typedef enum {
     GPIO_SET_DIRECTION,
     GPIO_GET_DIRECTION,
     GPIO_SET_VALUE,
-    GPIO_GET_VALUE
+    GPIO_GET_VALUE,
+    GPIO_SUBSCRIBE,
+    GPIO_UNSUBSCRIBE,
+    GPIO_EVENT,
+    GPIO_SET_CLOCK = 11, //10 is taken by debug messages
+    GPIO_ADVANCE_CLOCK
 } gpio_msg_e;
 
+/* Answer of a clock request the service does not take from this client */
+#define GPIO_CLOCK_DENIED -2
+
 typedef enum {
     GPIO_IN = 0,
     GPIO_OUT = 1
@@ -39,6 +47,15 @@ typedef enum {
     HIGH = 1
 } gpio_value_e;
 
+typedef enum {
+    GPIO_EDGE_NONE = 0,
+    GPIO_EDGE_RISING = 1,
+    GPIO_EDGE_FALLING = 2,
+    GPIO_EDGE_BOTH = 3,
+    GPIO_EDGE_LEVEL_HIGH = 4,
+    GPIO_EDGE_LEVEL_LOW = 8
+} gpio_edge_e;
+
 typedef enum {
   GPX0 = 0x300,
   GPX1 = 0x308,
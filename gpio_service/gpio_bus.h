@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_BUS_H__
+#define __GPIO_BUS_H__
+
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*
+ * Event bus in a POSIX shared memory object: a gpio_bus_header_s, then
+ * slot_count gpio_bus_slot_s used as a ring, slot_count a power of two.
+ *
+ * There is a single writer. Event s goes to slot s % slot_count, whose
+ * seq is 2s + 1 while the writer fills it and 2s + 2 once it is done,
+ * then head moves to s + 1. A reader copies a slot and checks seq did
+ * not change meanwhile, so the writer never waits for anyone: a reader
+ * that falls more than slot_count events behind finds its slots
+ * overwritten and skips to the oldest event still there.
+ *
+ * The writer creates the ring afresh, mode 0644, and keeps slot_count
+ * and head in a gpio_bus_writer_s of its own: it only ever writes the
+ * ring, so nothing another process can write steers where it writes.
+ * Readers map the ring read-only; after the writer restarts, they must
+ * open the new ring.
+ *
+ * Readers with nothing to read sleep on the futex word of the ring,
+ * which the writer bumps on every event. Readers cannot write the ring
+ * to count themselves as waiters, so the writer makes the wake-up call
+ * on every event; events are port changes, and a wake-up nobody waits
+ * for is a cheap system call.
+ */
+
+#define GPIO_BUS_MAGIC 0x42535047 //"GPSB"
+#define GPIO_BUS_VERSION 2
+#define GPIO_BUS_DEFAULT_NAME "/gpio_bus"
+#define GPIO_BUS_SLOT_COUNT_DEFAULT 4096
+#define GPIO_BUS_SLOT_COUNT_MAX (1U << 24)
+
+struct gpio_bus_header_s {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t slot_count;
+    uint32_t futex;
+    uint64_t head; //sequence of the next event
+    uint8_t pad[40]; //slots start on their own cache line
+};
+
+struct gpio_bus_slot_s {
+    uint64_t seq;
+    uint64_t timestamp; //ms
+    uint32_t port;
+    uint32_t state;
+    uint32_t changed; //pins that changed since the previous event of the port
+    uint32_t reserved;
+};
+
+struct gpio_bus_writer_s {
+    struct gpio_bus_header_s *header;
+    size_t size;
+    uint32_t slot_count;
+    uint64_t head;
+};
+
+static inline size_t gpio_bus_size(uint32_t slot_count)
+{
+    return sizeof(struct gpio_bus_header_s) + (size_t)slot_count * sizeof(struct gpio_bus_slot_s);
+}
+
+static inline struct gpio_bus_slot_s *gpio_bus_slots(struct gpio_bus_header_s *header)
+{
+    return (struct gpio_bus_slot_s *)(header + 1);
+}
+
+static inline bool gpio_bus_valid(const struct gpio_bus_header_s *header, size_t size)
+{
+    return size >= sizeof(*header) && header->magic == GPIO_BUS_MAGIC &&
+        header->version == GPIO_BUS_VERSION && header->slot_count &&
+        header->slot_count <= GPIO_BUS_SLOT_COUNT_MAX &&
+        !(header->slot_count & (header->slot_count - 1)) && size >= gpio_bus_size(header->slot_count);
+}
+
+/* Writer side: creates the ring @name of @slot_count slots, replacing any object of that name; false on failure */
+static inline bool gpio_bus_writer_open(struct gpio_bus_writer_s *writer, const char *name, uint32_t slot_count)
+{
+    void *addr;
+    int fd;
+
+    if (!slot_count || slot_count > GPIO_BUS_SLOT_COUNT_MAX || (slot_count & (slot_count - 1)))
+        return false;
+
+    /* Readers of a replaced ring keep their mapping of the old one */
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return false;
+
+    writer->size = gpio_bus_size(slot_count);
+    if (fchmod(fd, 0644) < 0 || ftruncate(fd, writer->size) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    addr = mmap(NULL, writer->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+
+    /* The object is zero filled: every slot reads as not written yet */
+    writer->header = (struct gpio_bus_header_s *)addr;
+    writer->slot_count = slot_count;
+    writer->head = 0;
+    writer->header->version = GPIO_BUS_VERSION;
+    writer->header->slot_count = slot_count;
+    __atomic_store_n(&writer->header->magic, GPIO_BUS_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* The ring stays, so readers drain it */
+static inline void gpio_bus_writer_close(struct gpio_bus_writer_s *writer)
+{
+    munmap(writer->header, writer->size);
+    writer->header = NULL;
+}
+
+static inline void gpio_bus_put(struct gpio_bus_writer_s *writer, uint64_t timestamp,
+        uint32_t port, uint32_t state, uint32_t changed)
+{
+    uint64_t seq = writer->head++;
+    struct gpio_bus_slot_s *slot = gpio_bus_slots(writer->header) + (seq & (writer->slot_count - 1));
+
+    __atomic_store_n(&slot->seq, 2 * seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->timestamp = timestamp;
+    slot->port = port;
+    slot->state = state;
+    slot->changed = changed;
+    __atomic_store_n(&slot->seq, 2 * seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&writer->header->head, seq + 1, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&writer->header->futex, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, &writer->header->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Reader side: 0 when event @seq was copied, 1 if it is not written yet, -1 if it was overwritten */
+static inline int gpio_bus_get(const struct gpio_bus_header_s *header, uint32_t slot_count, uint64_t seq,
+        struct gpio_bus_slot_s *event)
+{
+    const struct gpio_bus_slot_s *slot = (const struct gpio_bus_slot_s *)(header + 1) + (seq & (slot_count - 1));
+    uint64_t begin = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+    if (begin < 2 * seq + 2)
+        return 1;
+    if (begin > 2 * seq + 2)
+        return -1;
+
+    event->timestamp = slot->timestamp;
+    event->port = slot->port;
+    event->state = slot->state;
+    event->changed = slot->changed;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == begin ? 0 : -1;
+}
+
+/* Sleeps until an event is published after @futex was read, or @timeout_ms passed; -1 waits forever */
+static inline void gpio_bus_sleep(const struct gpio_bus_header_s *header, uint32_t futex, int timeout_ms)
+{
+    struct timespec timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+
+    /* FUTEX_WAIT only reads the word, so it works on the read-only mapping of the ring */
+    syscall(SYS_futex, &header->futex, FUTEX_WAIT, futex, timeout_ms < 0 ? NULL : &timeout, NULL, 0);
+}
+
+#endif // __GPIO_BUS_H__
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "gpio.h"
+#include "gpio_clock.h"
+
+#define GPIO_NS_PER_MS 1000000
+
+/*
+ * Virtual time only moves in gpio_clock_advance(). A thread waiting for a
+ * deadline parks on clock_cond with a gpio_clock_waiter_s on its stack, so
+ * an advance can wake exactly the waiters that became due.
+ *
+ * To make an advance deterministic, every thread that was woken, or is
+ * about to start, is counted as busy until it waits again or exits. An
+ * advance only moves time once nothing is busy, one deadline at a time.
+ */
+struct gpio_clock_waiter_s {
+    uint64_t deadline_ns;
+    const std::condition_variable *cond; //the caller's, only used as a key
+    bool fired; //woken by the advance, counted as busy
+    bool kicked; //woken by gpio_clock_notify(), counted as busy
+};
+
+static std::mutex clock_lock;
+/* Never destroyed: waiters stay parked on it when the process exits with the clock virtual */
+static std::condition_variable &clock_cond = *new std::condition_variable;
+static std::vector<gpio_clock_waiter_s *> clock_waiters;
+static unsigned int clock_busy = 0;
+
+static std::atomic<bool> clock_virtual(false);
+static std::atomic<uint64_t> virtual_now_ns(0);
+static uint64_t virtual_base_ns = 0; //virtual time when it was enabled
+static unsigned long long virtual_base_ms = 0; //timestamp when it was enabled
+
+/* Releases the busy count of the thread when it waits again or exits */
+struct gpio_clock_thread_s {
+    bool held;
+
+    ~gpio_clock_thread_s() {
+        if (held) {
+            std::lock_guard<std::mutex> lock(clock_lock);
+            clock_busy--;
+            clock_cond.notify_all();
+        }
+    }
+};
+
+static thread_local gpio_clock_thread_s clock_thread = { false };
+
+/* Called with clock_lock held */
+static void clock_release_locked(void)
+{
+    if (clock_thread.held) {
+        clock_thread.held = false;
+        clock_busy--;
+        clock_cond.notify_all();
+    }
+}
+
+static uint64_t real_now_ns(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned long long real_timestamp_ms(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void real_wait_until(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns)
+{
+    if (clock_thread.held) {
+        std::lock_guard<std::mutex> clock(clock_lock);
+        clock_release_locked();
+    }
+    cond.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline_ns)));
+}
+
+static uint64_t virtual_now(void)
+{
+    return virtual_now_ns.load(std::memory_order_acquire);
+}
+
+static unsigned long long virtual_timestamp_ms(void)
+{
+    return virtual_base_ms + (virtual_now() - virtual_base_ns) / GPIO_NS_PER_MS;
+}
+
+static void virtual_wait_until(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns)
+{
+    gpio_clock_waiter_s waiter = { deadline_ns, &cond, false, false };
+    std::unique_lock<std::mutex> clock(clock_lock);
+
+    /* Already due: the thread keeps running, and keeps its busy count */
+    if (deadline_ns <= virtual_now())
+        return;
+
+    clock_release_locked();
+    clock_waiters.push_back(&waiter);
+
+    /* The caller's state is only changed under its lock, taken before clock_lock: no wake-up is lost */
+    lock.unlock();
+    clock_cond.wait(clock, [&waiter] {
+        return waiter.fired || waiter.kicked || !clock_virtual.load();
+    });
+    clock_waiters.erase(std::remove(clock_waiters.begin(), clock_waiters.end(), &waiter),
+            clock_waiters.end());
+    if (waiter.fired || waiter.kicked)
+        clock_thread.held = true;
+    clock.unlock();
+    lock.lock();
+}
+
+static const struct gpio_clock_ops_s real_clock = {
+    real_now_ns,
+    real_timestamp_ms,
+    real_wait_until,
+};
+
+static const struct gpio_clock_ops_s virtual_clock = {
+    virtual_now,
+    virtual_timestamp_ms,
+    virtual_wait_until,
+};
+
+static std::atomic<const struct gpio_clock_ops_s *> clock_ops(&real_clock);
+
+uint64_t gpio_clock_now_ns(void)
+{
+    return clock_ops.load(std::memory_order_acquire)->now_ns();
+}
+
+unsigned long long gpio_clock_timestamp_ms(void)
+{
+    return clock_ops.load(std::memory_order_acquire)->timestamp_ms();
+}
+
+void gpio_clock_wait_until(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns)
+{
+    clock_ops.load(std::memory_order_acquire)->wait_until(lock, cond, deadline_ns);
+}
+
+void gpio_clock_notify(std::condition_variable &cond)
+{
+    if (clock_virtual.load()) {
+        std::lock_guard<std::mutex> lock(clock_lock);
+        bool woken = false;
+
+        for (size_t i = 0; i < clock_waiters.size(); i++) {
+            gpio_clock_waiter_s *waiter = clock_waiters[i];
+
+            if (waiter->cond == &cond && !waiter->fired && !waiter->kicked) {
+                waiter->kicked = true;
+                clock_busy++;
+                woken = true;
+            }
+        }
+        if (woken)
+            clock_cond.notify_all();
+    }
+    cond.notify_all();
+}
+
+void gpio_clock_hold(void)
+{
+    std::lock_guard<std::mutex> lock(clock_lock);
+
+    clock_busy++;
+}
+
+void gpio_clock_enter(void)
+{
+    clock_thread.held = true;
+}
+
+void gpio_clock_release(void)
+{
+    std::lock_guard<std::mutex> lock(clock_lock);
+
+    clock_busy--;
+    clock_cond.notify_all();
+}
+
+int gpio_clock_set_virtual(bool enable)
+{
+    {
+        std::lock_guard<std::mutex> lock(clock_lock);
+
+        if (enable == clock_virtual.load())
+            return GPIO_ERROR_NONE;
+
+        if (enable) {
+            /* Virtual time goes on from the real clock, so deadlines already taken stay meaningful */
+            virtual_base_ns = real_now_ns();
+            virtual_base_ms = real_timestamp_ms();
+            virtual_now_ns.store(virtual_base_ns, std::memory_order_release);
+            clock_virtual = true;
+            clock_ops = &virtual_clock;
+        } else {
+            clock_virtual = false;
+            clock_ops = &real_clock;
+        }
+    }
+    clock_cond.notify_all();
+
+    return GPIO_ERROR_NONE;
+}
+
+int gpio_clock_advance(unsigned long long ns)
+{
+    std::unique_lock<std::mutex> lock(clock_lock);
+    uint64_t target;
+
+    if (!clock_virtual.load())
+        return GPIO_ERROR_INVALID_PARAMETER;
+
+    /* The advancing thread may itself have been woken by the clock */
+    clock_release_locked();
+
+    target = virtual_now() + ns;
+    while (1) {
+        uint64_t next = target;
+        bool due = false;
+
+        clock_cond.wait(lock, [] { return clock_busy == 0 || !clock_virtual.load(); });
+        if (!clock_virtual.load())
+            return GPIO_ERROR_INVALID_PARAMETER;
+
+        for (size_t i = 0; i < clock_waiters.size(); i++) {
+            if (!clock_waiters[i]->fired && !clock_waiters[i]->kicked)
+                next = std::min(next, clock_waiters[i]->deadline_ns);
+        }
+        virtual_now_ns.store(std::max(next, virtual_now()), std::memory_order_release);
+
+        for (size_t i = 0; i < clock_waiters.size(); i++) {
+            gpio_clock_waiter_s *waiter = clock_waiters[i];
+
+            if (!waiter->fired && !waiter->kicked && waiter->deadline_ns <= virtual_now()) {
+                waiter->fired = true;
+                clock_busy++;
+                due = true;
+            }
+        }
+        if (!due)
+            break;
+        clock_cond.notify_all();
+    }
+
+    return GPIO_ERROR_NONE;
+}
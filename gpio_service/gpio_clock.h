@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_CLOCK_H__
+#define __GPIO_CLOCK_H__
+
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Time source of the service: the steady and system clocks, or a virtual
+ * clock that only moves on gpio_clock_advance(), driven by clients with
+ * GPIO_SET_CLOCK and GPIO_ADVANCE_CLOCK. Deadlines are in ns of
+ * gpio_clock_now_ns(); a thread waiting for one must be woken with
+ * gpio_clock_notify(), not by the condition itself.
+ */
+struct gpio_clock_ops_s {
+    uint64_t (*now_ns)(void);
+    unsigned long long (*timestamp_ms)(void); //time of events
+    void (*wait_until)(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns);
+};
+
+uint64_t gpio_clock_now_ns(void);
+unsigned long long gpio_clock_timestamp_ms(void);
+void gpio_clock_wait_until(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns);
+void gpio_clock_notify(std::condition_variable &cond);
+
+/*
+ * A thread started by the service is busy for gpio_clock_advance() until
+ * its first wait: the starter calls gpio_clock_hold() before creating it,
+ * or gpio_clock_release() if that fails, and the thread gpio_clock_enter().
+ */
+void gpio_clock_hold(void);
+void gpio_clock_enter(void);
+void gpio_clock_release(void);
+
+int gpio_clock_set_virtual(bool enable);
+
+/* Returns once everything due up to the new time has run */
+int gpio_clock_advance(unsigned long long ns);
+
+#endif // __GPIO_CLOCK_H__
@@ -106,8 +106,38 @@ typedef struct {
 
 typedef gpio_t* gpio_h;
 
+/**
+ * @brief   Sets the value of a pin, as seen by the library, without touching the hardware.
+ * @details The port of the pin becomes virtual: reads return the injected values instead of the register,
+ *          and the listeners of the port are sampled right away, whatever their interval.
+ *          The port stays virtual until gpio_inject_detach().
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin     The pin
+ * @param[in]   value   The value the pin takes
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Too many virtual ports
+ * @see     gpio_inject_detach()
+ */
 int gpio_inject_data(gpio_pin_e pin, gpio_value_e value);
 
+/**
+ * @brief   Stops injecting data to the port of a pin.
+ * @details The port reads its register again, unless a replay still feeds it,
+ *          and the listeners of the port are sampled right away.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin     A pin of the port
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    No data was injected to the port
+ * @see     gpio_inject_data()
+ */
+int gpio_inject_detach(gpio_pin_e pin);
+
 
 /**
  * @brief   Checks whether a given gpio type is supported in the current device.
@@ -146,6 +176,7 @@ int gpio_is_supported(gpio_pin_e pin, bool *supported);
  * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
  * @retval  #GPIO_ERROR_NOT_SUPPORTED        The gpio type is not supported in the current device
  * @retval  #GPIO_ERROR_PERMISSION_DENIED    Permission denied
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed, and the port of the pin is not virtual
  *
  * @see     gpio_get_gpio_list()
  */
@@ -332,6 +363,22 @@ typedef enum
     GPIO_PAUSE_ALL = 3,               /**< The gpio pauses in all the above cases */
 } gpio_pause_e;
 
+/**
+ * @brief   Enumeration for the edges reported by a gpio listener.
+ * @details Edge and level flags can be combined. A listener reports #GPIO_EDGE_BOTH by default.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_EDGE_NONE = 0,          /**< No event is reported */
+    GPIO_EDGE_RISING = 1,        /**< The pin changed from low to high */
+    GPIO_EDGE_FALLING = 2,       /**< The pin changed from high to low */
+    GPIO_EDGE_BOTH = 3,          /**< The pin changed in either direction */
+    GPIO_EDGE_LEVEL_HIGH = 4,    /**< Every sample in which the pin is high */
+    GPIO_EDGE_LEVEL_LOW = 8,     /**< Every sample in which the pin is low */
+} gpio_edge_e;
+
+
 
 /**
  * @brief   Called when a gpio event occurs.
@@ -449,6 +496,23 @@ int gpio_listener_stop(gpio_listener_h listener);
  */
 int gpio_listener_set_event_cb(gpio_listener_h listener, unsigned int interval_ms, gpio_event_cb callback, void *data);
 
+/**
+ * @brief   Selects which edges of the gpio are delivered via a given gpio listener.
+ * @details Samples that do not match @c edge are dropped by the sampler,
+ *          before any callback is invoked or any message is sent to the gpio service.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle
+ * @param[in]   edge        A combination of #gpio_edge_e flags
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ *
+ * @see gpio_listener_set_event_cb()
+ */
+int gpio_listener_set_edge(gpio_listener_h listener, gpio_edge_e edge);
+
 /**
  * @brief   Unregisters the gpio event callback function attached to a given gpio listener.
  * @since_tizen @if MOBILE 2.3 @elseif WEARABLE 2.3.1 @endif
@@ -519,6 +583,95 @@ int gpio_listener_read_data(gpio_listener_h listener, gpio_event_s *event);
  */
 int gpio_listener_set_interval(gpio_listener_h listener, unsigned int interval_ms);
 
+/**
+ * @brief   Lets the update interval of a gpio listener follow the activity of the gpio.
+ * @details While the gpio stays unchanged, the interval doubles after every sample, up to @c max_interval_ms.
+ *          As soon as the gpio changes, the interval drops back to @c fast_interval_ms.
+ *          The intervals are bounded by @c min_interval_ms and @c max_interval_ms,
+ *          and by the value reported by gpio_get_min_interval().@n
+ *          Calling gpio_listener_set_interval() switches the listener back to a fixed interval.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener            A listener handle
+ * @param[in]   fast_interval_ms    The interval used right after a change, in milliseconds
+ * @param[in]   min_interval_ms     The lower bound of the interval, in milliseconds
+ * @param[in]   max_interval_ms     The upper bound of the interval, in milliseconds
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ *
+ * @see     gpio_listener_set_interval()
+ * @see     gpio_get_min_interval()
+ */
+int gpio_listener_set_adaptive_interval(gpio_listener_h listener, unsigned int fast_interval_ms,
+		unsigned int min_interval_ms, unsigned int max_interval_ms);
+
+/**
+ * @brief   Samples the gpio of a listener on a thread of its own, at a period shorter than a millisecond.
+ * @details The shared sampler cannot wake more often than the value reported by gpio_get_min_interval().
+ *          In fast mode, the thread of the listener sleeps until shortly before each sample and spins the rest,
+ *          so its edges, decoded frames and measurements are timed to @c period_us, and its interval is ignored.
+ *          Events and frames are then delivered from that thread.
+ *          Changes of a port fed by gpio_inject_data() or a replay are still delivered as they happen.@n
+ *          A decoder set by gpio_listener_set_decoder() turns fast mode on by itself, at the period it needs,
+ *          unless @c period_us is shorter. A period of 0 leaves fast mode, unless a decoder needs it.
+ * @since_tizen 3.0
+ *
+ * @remarks Leaving fast mode waits for the thread of the listener to exit, except from a callback,
+ *          where the thread exits on its own once the callback returns.
+ *
+ * @param[in]   listener    A listener handle
+ * @param[in]   period_us   The sampling period in microseconds, from 10 to 1000, or 0
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The thread cannot be started
+ *
+ * @see     gpio_listener_set_decoder()
+ */
+int gpio_listener_set_fast_sampling(gpio_listener_h listener, unsigned int period_us);
+
+/**
+ * @brief   Switches a gpio listener to events delivered through a file descriptor.
+ * @details From then on, the events of the listener are queued instead of passed to its callback,
+ *          and the returned eventfd is readable while events are queued.
+ *          Add it to an epoll set or a GLib main loop, and call gpio_listener_drain() when it is readable,
+ *          so the events are handled on the thread of the loop, without a handoff from the sampling thread.@n
+ *          The queue holds 1024 events; when it is full, the oldest event is dropped.
+ *          The descriptor belongs to the listener and is closed when the listener is destroyed.
+ *          Calling this function again returns the same descriptor.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle
+ * @param[out]  fd          The file descriptor to poll for reading
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The eventfd cannot be created
+ *
+ * @see     gpio_listener_drain()
+ */
+int gpio_listener_get_fd(gpio_listener_h listener, int *fd);
+
+/**
+ * @brief   Takes the queued events of a gpio listener in fd mode, without blocking.
+ * @details The events come oldest first. Once the queue is empty, the descriptor is no longer readable.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle, switched to fd mode by gpio_listener_get_fd()
+ * @param[out]  events      The events
+ * @param[in]   max_count   The number of entries in @c events
+ * @param[out]  count       The number of events taken, 0 if none was queued
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the listener is not in fd mode
+ */
+int gpio_listener_drain(gpio_listener_h listener, gpio_event_s *events, unsigned int max_count, unsigned int *count);
+
 int gpio_listener_set_data(gpio_listener_h listener, gpio_value_e data);
 
 #endif
@@ -526,6 +679,2070 @@ int gpio_listener_set_data(gpio_listener_h listener, gpio_value_e data);
  * @}
  */
 
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_CAPTURE_MODULE
+ * @{
+ */
+
+/**
+ * @brief   GPIO capture handle.
+ * @details A capture samples whole port registers at a fixed rate, like a logic analyzer.
+ *          Every pin of a captured port takes one bit per sample,
+ *          packed 64 samples to a 64-bit word, in a buffer allocated up front.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_capture_s *gpio_capture_h;
+
+/**
+ * @brief   Creates a capture of one or more ports.
+ * @since_tizen 3.0
+ *
+ * @param[in]   ports           The ports to sample
+ * @param[in]   port_count      The number of ports in @c ports
+ * @param[in]   sample_rate     The number of samples per second
+ * @param[in]   sample_count    The number of samples the buffer holds
+ * @param[out]  capture         The capture handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be mapped
+ *
+ * @see     gpio_capture_destroy()
+ */
+int gpio_capture_create(const gpio_port_e *ports, int port_count,
+		unsigned int sample_rate, unsigned int sample_count, gpio_capture_h *capture);
+
+/**
+ * @brief   Destroys a capture, stopping it first if needed.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_capture_destroy(gpio_capture_h capture);
+
+/**
+ * @brief   Starts sampling from the beginning of the buffer.
+ * @details Without a trigger, sampling stops by itself once the buffer is full.@n
+ *          With a trigger, the buffer is used as a ring, and sampling stops by itself
+ *          once the post-trigger samples are taken.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the capture is already running
+ * @retval  #GPIO_ERROR_IO_ERROR             The sampling thread cannot be started
+ */
+int gpio_capture_start(gpio_capture_h capture);
+
+/**
+ * @brief   Stops sampling and keeps the samples taken so far.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_capture_stop(gpio_capture_h capture);
+
+/**
+ * @brief   Reads the samples of one pin.
+ * @details Nothing is kept in memory while streaming, see gpio_capture_set_stream().@n
+ *          Bit @c i%64 of @c words[i/64] holds sample @c i, as the raw data register bit.@n
+ *          Once triggered, the samples are those of the trigger window, see gpio_capture_get_trigger();
+ *          otherwise they are the latest samples the buffer holds.@n
+ *          While the capture runs, only whole words of samples are visible.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture         A capture handle
+ * @param[in]   pin             A pin of one of the captured ports
+ * @param[out]  words           The buffer to copy the samples to
+ * @param[in]   word_count      The number of words in @c words
+ * @param[out]  sample_count    The number of samples copied
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the pin is not captured
+ */
+int gpio_capture_read(gpio_capture_h capture, gpio_pin_e pin,
+		uint64_t *words, unsigned int word_count, unsigned int *sample_count);
+
+/**
+ * @brief   Arms a trigger on an edge of a pin.
+ * @details Only #GPIO_EDGE_RISING, #GPIO_EDGE_FALLING and #GPIO_EDGE_BOTH are accepted.
+ *          #GPIO_EDGE_NONE disarms the trigger.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle, not running
+ * @param[in]   pin         A pin of one of the captured ports
+ * @param[in]   edge        The edge to trigger on
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ *
+ * @see     gpio_capture_set_trigger_window()
+ */
+int gpio_capture_set_trigger_edge(gpio_capture_h capture, gpio_pin_e pin, gpio_edge_e edge);
+
+/**
+ * @brief   Arms a trigger on a pattern of a port.
+ * @details The trigger hits on the first sample where the pins in @c mask equal those in @c pattern.
+ *          A @c mask of 0xff matches the whole port.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle, not running
+ * @param[in]   port        One of the captured ports
+ * @param[in]   mask        The pins to compare
+ * @param[in]   pattern     The expected values of those pins
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ *
+ * @see     gpio_capture_set_trigger_window()
+ */
+int gpio_capture_set_trigger_pattern(gpio_capture_h capture, gpio_port_e port,
+		uint8_t mask, uint8_t pattern);
+
+/**
+ * @brief   Sets how many samples are kept around the trigger.
+ * @details The window holds @c pre_count samples before the trigger, the trigger sample
+ *          and @c post_count samples after it. By default the window is centered on the trigger.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle, not running
+ * @param[in]   pre_count   The number of samples before the trigger
+ * @param[in]   post_count  The number of samples after the trigger
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the window exceeds the buffer
+ */
+int gpio_capture_set_trigger_window(gpio_capture_h capture,
+		unsigned int pre_count, unsigned int post_count);
+
+/**
+ * @brief   Gets whether the trigger hit, and where.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture         A capture handle
+ * @param[out]  triggered       If the trigger hit, @c true; Otherwise @c false
+ * @param[out]  trigger_index   The index of the trigger sample among those read by gpio_capture_read(),
+ *                              set only if @c triggered is @c true
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_capture_get_trigger(gpio_capture_h capture, bool *triggered, unsigned int *trigger_index);
+
+/**
+ * @brief   Accounting of a capture stream, see gpio_capture_get_stream_stats().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    unsigned long long blocks_written;   /**< Blocks persisted */
+    unsigned long long blocks_dropped;   /**< Blocks lost because the writer lagged behind, or after a write error */
+    unsigned long long samples_dropped;  /**< Samples in the dropped blocks */
+    unsigned long long bytes_written;    /**< Bytes persisted, the stream header included */
+    unsigned int max_pending;            /**< Most blocks ever waiting for the writer */
+    int error;                           /**< errno of the write that failed, 0 if none did */
+} gpio_capture_stream_stats_s;
+
+/**
+ * @brief   Streams the samples of a capture to a file instead of keeping them in memory.
+ * @details The sampling thread fills blocks of @c block_samples samples, and a writer thread
+ *          persists them with large sequential writes, through io_uring where the library is built with it.
+ *          Sampling then goes on until gpio_capture_stop(), or until the post-trigger samples are taken.@n
+ *          When all @c block_count blocks wait for the writer, the samples of the next block are dropped,
+ *          which the stream records in the following block and gpio_capture_get_stream_stats() reports.@n
+ *          The caller keeps the ownership of @c fd. A negative @c fd stops streaming.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture         A capture handle, not running
+ * @param[in]   fd              The file to write to
+ * @param[in]   block_samples   The number of samples per block, rounded up to a multiple of 64.
+ *                              If 0, 65536.
+ * @param[in]   block_count     The number of blocks, at least 2. If 0, 4.
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ */
+int gpio_capture_set_stream(gpio_capture_h capture, int fd,
+		unsigned int block_samples, unsigned int block_count);
+
+/**
+ * @brief   Gets the accounting of the stream of a capture.
+ * @details The values are those of the current or last run.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle
+ * @param[out]  stats       The stream accounting
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the capture does not stream
+ */
+int gpio_capture_get_stream_stats(gpio_capture_h capture, gpio_capture_stream_stats_s *stats);
+
+/**
+ * @brief   Edge statistics of a pin, see gpio_capture_get_edge_stats().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    unsigned long long rising;   /**< Changes from low to high */
+    unsigned long long falling;  /**< Changes from high to low */
+    unsigned long long high;     /**< Samples at high; the duty cycle is @c high over the sample count */
+} gpio_capture_edge_stats_s;
+
+/**
+ * @brief   Counts the edges and the high samples of a pin.
+ * @details @c words holds the samples as gpio_capture_read() returns them, or as a stream block stores them.
+ *          Sample 0 is not an edge. The count runs on vector instructions where the CPU has them,
+ *          so buffers of billions of samples are analyzed at close to memory speed.
+ * @since_tizen 3.0
+ *
+ * @param[in]   words           The samples, bit @c i%64 of @c words[i/64] holding sample @c i
+ * @param[in]   sample_count    The number of samples
+ * @param[out]  stats           The statistics
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_capture_get_edge_stats(const uint64_t *words, unsigned long long sample_count,
+		gpio_capture_edge_stats_s *stats);
+
+/**
+ * @brief   Finds the edges of a pin.
+ * @details The position of an edge is the first sample after the change.
+ *          To get the edges in several calls, pass the last position returned plus one as @c from.
+ * @since_tizen 3.0
+ *
+ * @param[in]   words           The samples, as for gpio_capture_get_edge_stats()
+ * @param[in]   sample_count    The number of samples
+ * @param[in]   edge            #GPIO_EDGE_RISING, #GPIO_EDGE_FALLING or #GPIO_EDGE_BOTH
+ * @param[in]   from            The first sample to look at
+ * @param[out]  positions       The positions of the edges found, in order
+ * @param[in]   max_count       The number of entries in @c positions
+ * @param[out]  count           The number of edges found, less than @c max_count once the samples are exhausted
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_capture_find_edges(const uint64_t *words, unsigned long long sample_count, gpio_edge_e edge,
+		unsigned long long from, unsigned long long *positions, unsigned int max_count, unsigned int *count);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_SUMMARY_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Summary handle.
+ * @details A summary describes the samples of a pin at several resolutions:
+ *          for windows of 1024 samples, then of every power of two above, whether the pin was high,
+ *          whether it was low, and how many edges the window holds.
+ *          Range queries and edge searches then take O(log n), however long the capture.@n
+ *          The functions that take the samples as @c words are exact, those samples being
+ *          the ones summarized, in the same numbering. Without them, the answers are rounded out to whole windows.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_summary_s *gpio_summary_h;
+
+/**
+ * @brief   What a pin did over a range of samples, see gpio_summary_get_range().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    bool high;                  /**< The pin was high at least once */
+    bool low;                   /**< The pin was low at least once */
+    unsigned long long edges;   /**< Changes of the pin, rising and falling */
+} gpio_summary_range_s;
+
+/**
+ * @brief   Creates an empty summary.
+ * @since_tizen 3.0
+ *
+ * @param[out]  summary     The summary handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ */
+int gpio_summary_create(gpio_summary_h *summary);
+
+/**
+ * @brief   Destroys a summary.
+ * @details The summaries of a capture belong to it, and are destroyed with it.
+ * @since_tizen 3.0
+ *
+ * @param[in]   summary     A summary handle created by gpio_summary_create()
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_summary_destroy(gpio_summary_h summary);
+
+/**
+ * @brief   Extends a summary with the next samples of the pin.
+ * @details The samples are numbered on from those already summarized.
+ *          Only the last append may end within a 64-bit word.
+ * @since_tizen 3.0
+ *
+ * @param[in]   summary         A summary handle
+ * @param[in]   words           The samples, as for gpio_capture_get_edge_stats()
+ * @param[in]   sample_count    The number of samples
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the summary ends within a word
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ */
+int gpio_summary_append(gpio_summary_h summary, const uint64_t *words, unsigned long long sample_count);
+
+/**
+ * @brief   Gets the number of samples summarized.
+ * @details Samples a stream dropped are counted too, as neither high nor low.
+ * @since_tizen 3.0
+ *
+ * @param[in]   summary         A summary handle
+ * @param[out]  sample_count    The number of samples
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_summary_get_sample_count(gpio_summary_h summary, unsigned long long *sample_count);
+
+/**
+ * @brief   Gets what a pin did over samples [@c start, @c end).
+ * @details The edges counted are those at positions in the range, the position of an edge
+ *          being the first sample after the change, as for gpio_capture_find_edges().
+ * @since_tizen 3.0
+ *
+ * @param[in]   summary     A summary handle
+ * @param[in]   words       The samples summarized, or NULL to round the range out to whole windows
+ * @param[in]   start       The first sample
+ * @param[in]   end         The sample after the last one, at most the number of samples summarized
+ * @param[out]  range       What the pin did
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_summary_get_range(gpio_summary_h summary, const uint64_t *words,
+		unsigned long long start, unsigned long long end, gpio_summary_range_s *range);
+
+/**
+ * @brief   Finds the next edge of a pin.
+ * @details Without @c words, @c position is the start of the first window from the one holding @c from
+ *          that has an edge, or @c from itself if that window does, its edges possibly all before @c from.
+ * @since_tizen 3.0
+ *
+ * @param[in]   summary     A summary handle
+ * @param[in]   words       The samples summarized, or NULL
+ * @param[in]   from        The first sample to look at
+ * @param[out]  position    The position of the edge
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_NO_DATA              No edge from @c from on
+ */
+int gpio_summary_find_edge(gpio_summary_h summary, const uint64_t *words,
+		unsigned long long from, unsigned long long *position);
+
+/**
+ * @brief   Renders an overview of samples [@c start, @c end), one bucket per column.
+ * @details The range is split into @c bucket_count buckets of equal size, each filled as by gpio_summary_get_range().
+ *          A bucket both high and low, or with edges, is drawn as activity.
+ * @since_tizen 3.0
+ *
+ * @param[in]   summary         A summary handle
+ * @param[in]   words           The samples summarized, or NULL
+ * @param[in]   start           The first sample
+ * @param[in]   end             The sample after the last one, at most the number of samples summarized
+ * @param[out]  buckets         What the pin did in each bucket
+ * @param[in]   bucket_count    The number of buckets, at most @c end - @c start
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_summary_render(gpio_summary_h summary, const uint64_t *words,
+		unsigned long long start, unsigned long long end, gpio_summary_range_s *buckets, unsigned int bucket_count);
+
+/**
+ * @brief   Gets the summary of a pin of a capture.
+ * @details With a stream set, the writer thread extends the summaries as it persists blocks,
+ *          so they can be queried while sampling goes on, samples numbered as in the stream.
+ *          Otherwise the capture must be stopped, and the summary is built on the first call after a run,
+ *          samples numbered as gpio_capture_read() returns them.@n
+ *          The summary belongs to the capture.
+ * @since_tizen 3.0
+ *
+ * @param[in]   capture     A capture handle
+ * @param[in]   pin         A pin of one of the captured ports
+ * @param[out]  summary     The summary of the pin
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the capture runs without a stream
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ */
+int gpio_capture_get_summary(gpio_capture_h capture, gpio_pin_e pin, gpio_summary_h *summary);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_EDGELOG_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Edge log writer handle.
+ * @details An edge log stores the history of ports as their changes only:
+ *          every record holds a varint time delta, the port and the mask of the pins that changed.
+ *          A checkpoint with the full state is written every few records and indexed at the end of the file,
+ *          so a reader can seek to any time without decoding the whole log.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_edgelog_writer_s *gpio_edgelog_writer_h;
+
+/**
+ * @brief   Edge log reader handle.
+ * @details The log is memory mapped, and queries only decode the records after the closest checkpoint.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_edgelog_s *gpio_edgelog_h;
+
+/**
+ * @brief   Edge delivered by gpio_edgelog_foreach_edge().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    unsigned long long timestamp;  /**< Time of the change, in nanoseconds */
+    gpio_port_e port;              /**< Port that changed */
+    uint8_t changed;               /**< Mask of the pins that changed */
+    uint8_t state;                 /**< State of the port after the change */
+} gpio_edgelog_record_s;
+
+/**
+ * @brief   Called for every edge in a time range.
+ * @since_tizen 3.0
+ *
+ * @param[in]   record      The edge
+ * @param[in]   user_data   The user data passed to gpio_edgelog_foreach_edge()
+ *
+ * @return  @c true to continue with the next edge, otherwise @c false to stop
+ */
+typedef bool (*gpio_edgelog_cb)(const gpio_edgelog_record_s *record, void *user_data);
+
+/**
+ * @brief   Creates an edge log file.
+ * @since_tizen 3.0
+ *
+ * @param[in]   path            The file to create
+ * @param[in]   ports           The ports the log records
+ * @param[in]   port_count      The number of ports in @c ports, at most 255
+ * @param[in]   initial_state   The state of each port at @c start_ns, or @c NULL for all 0
+ * @param[in]   start_ns        The time the log starts at, in nanoseconds
+ * @param[in]   index_interval  The number of records between checkpoints. If 0, 1024.
+ * @param[out]  writer          The writer handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be written
+ *
+ * @see     gpio_edgelog_writer_close()
+ */
+int gpio_edgelog_writer_create(const char *path, const gpio_port_e *ports, int port_count,
+		const uint8_t *initial_state, unsigned long long start_ns,
+		unsigned int index_interval, gpio_edgelog_writer_h *writer);
+
+/**
+ * @brief   Records the state of a port.
+ * @details Nothing is written if the state did not change.
+ * @since_tizen 3.0
+ *
+ * @param[in]   writer          A writer handle
+ * @param[in]   timestamp_ns    The time of the state, not before the previous one
+ * @param[in]   port            One of the ports of the log
+ * @param[in]   state           The state of the port
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the time goes backwards
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be written
+ */
+int gpio_edgelog_writer_append(gpio_edgelog_writer_h writer, unsigned long long timestamp_ns,
+		gpio_port_e port, uint8_t state);
+
+/**
+ * @brief   Writes the index and closes an edge log.
+ * @details The log can only be read once closed. The handle is released even on failure.
+ * @since_tizen 3.0
+ *
+ * @param[in]   writer      A writer handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be written
+ */
+int gpio_edgelog_writer_close(gpio_edgelog_writer_h writer);
+
+/**
+ * @brief   Opens an edge log for reading.
+ * @since_tizen 3.0
+ *
+ * @param[in]   path    The file to open
+ * @param[out]  log     The reader handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the file is not a closed edge log
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be mapped
+ */
+int gpio_edgelog_open(const char *path, gpio_edgelog_h *log);
+
+/**
+ * @brief   Closes an edge log opened for reading.
+ * @since_tizen 3.0
+ *
+ * @param[in]   log     A reader handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_edgelog_close(gpio_edgelog_h log);
+
+/**
+ * @brief   Gets the time span and the number of records of an edge log.
+ * @since_tizen 3.0
+ *
+ * @param[in]   log             A reader handle
+ * @param[out]  start_ns        The time the log starts at
+ * @param[out]  end_ns          The time of the last record, or @c start_ns if there is none
+ * @param[out]  record_count    The number of records
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_edgelog_get_range(gpio_edgelog_h log, unsigned long long *start_ns,
+		unsigned long long *end_ns, unsigned long long *record_count);
+
+/**
+ * @brief   Gets the ports an edge log records.
+ * @since_tizen 3.0
+ *
+ * @param[in]   log         A reader handle
+ * @param[out]  ports       The array to copy the ports to
+ * @param[in]   max_count   The number of entries in @c ports
+ * @param[out]  port_count  The number of ports of the log, which may exceed @c max_count
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_edgelog_get_ports(gpio_edgelog_h log, gpio_port_e *ports, int max_count, int *port_count);
+
+/**
+ * @brief   Gets the state of a port at the start of an edge log, before any change it records.
+ * @details This is the initial state given to gpio_edgelog_writer_create().
+ * @since_tizen 3.0
+ *
+ * @param[in]   log     A reader handle
+ * @param[in]   port    One of the ports of the log
+ * @param[out]  state   The initial state of the port
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_edgelog_get_initial_state(gpio_edgelog_h log, gpio_port_e port, uint8_t *state);
+
+/**
+ * @brief   Gets the state of a port at a given time.
+ * @details Changes recorded at @c timestamp_ns are included.
+ * @since_tizen 3.0
+ *
+ * @param[in]   log             A reader handle
+ * @param[in]   port            One of the ports of the log
+ * @param[in]   timestamp_ns    The time, in nanoseconds
+ * @param[out]  state           The state of the port
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The log is corrupted
+ */
+int gpio_edgelog_get_port_state(gpio_edgelog_h log, gpio_port_e port,
+		unsigned long long timestamp_ns, uint8_t *state);
+
+/**
+ * @brief   Gets the value of a pin at a given time.
+ * @since_tizen 3.0
+ *
+ * @param[in]   log             A reader handle
+ * @param[in]   pin             A pin of one of the ports of the log
+ * @param[in]   timestamp_ns    The time, in nanoseconds
+ * @param[out]  value           The value of the pin
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The log is corrupted
+ *
+ * @see     gpio_edgelog_get_port_state()
+ */
+int gpio_edgelog_get_value(gpio_edgelog_h log, gpio_pin_e pin,
+		unsigned long long timestamp_ns, gpio_value_e *value);
+
+/**
+ * @brief   Calls a callback for every edge between two times, both included.
+ * @since_tizen 3.0
+ *
+ * @param[in]   log         A reader handle
+ * @param[in]   start_ns    The start of the range, in nanoseconds
+ * @param[in]   end_ns      The end of the range, in nanoseconds
+ * @param[in]   callback    The callback to call
+ * @param[in]   user_data   The user data to pass to the callback
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The log is corrupted
+ */
+int gpio_edgelog_foreach_edge(gpio_edgelog_h log, unsigned long long start_ns,
+		unsigned long long end_ns, gpio_edgelog_cb callback, void *user_data);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_REPLAY_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Replay handle.
+ * @details A replay plays a recorded trace through the listeners, off the hardware:
+ *          the ports of the trace become virtual, as with gpio_inject_data(),
+ *          and every change is delivered by the sampler with the trace time, in milliseconds, as the event time.
+ *          The ports are virtual from the creation of the replay, so listeners can be started before it.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_replay_s *gpio_replay_h;
+
+/**
+ * @brief   Creates a replay of an edge log.
+ * @since_tizen 3.0
+ *
+ * @param[in]   path    The edge log, see gpio_edgelog_writer_create()
+ * @param[out]  replay  The replay handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the file is not an edge log
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory, or too many virtual ports
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be read
+ */
+int gpio_replay_create_from_edgelog(const char *path, gpio_replay_h *replay);
+
+/**
+ * @brief   Creates a replay of a synthetic waveform.
+ * @details The waveform is a text file with one "<time_ns> <pin> <value>" line per change, in time order.
+ *          Pins are numbered as #gpio_pin_e, in decimal or in hexadecimal with a 0x prefix,
+ *          and text after a '#' is ignored. Every port starts at 0.
+ * @since_tizen 3.0
+ *
+ * @param[in]   path    The waveform file
+ * @param[out]  replay  The replay handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or a malformed line
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory, or too many virtual ports
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be read
+ */
+int gpio_replay_create_from_waveform(const char *path, gpio_replay_h *replay);
+
+/**
+ * @brief   Destroys a replay, stopping it first if needed.
+ * @details The ports of the trace are read from the registers again.
+ * @since_tizen 3.0
+ *
+ * @param[in]   replay  A replay handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_replay_destroy(gpio_replay_h replay);
+
+/**
+ * @brief   Sets the speed of a replay.
+ * @since_tizen 3.0
+ *
+ * @param[in]   replay  A replay handle, not running
+ * @param[in]   speed   The trace time played per unit of wall time: 1.0 for real time, 10.0 for ten times faster.
+ *                      If 0, the changes are played as fast as the listeners take them.
+ *                      Negative, infinite or NaN speeds are invalid.
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_replay_set_speed(gpio_replay_h replay, double speed);
+
+/**
+ * @brief   Plays a replay from the start of the trace.
+ * @details The replay stops by itself at the end of the trace.
+ * @since_tizen 3.0
+ *
+ * @param[in]   replay  A replay handle, not running
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Too many virtual ports
+ * @retval  #GPIO_ERROR_IO_ERROR             The replay thread cannot be started
+ */
+int gpio_replay_start(gpio_replay_h replay);
+
+/**
+ * @brief   Stops a replay.
+ * @since_tizen 3.0
+ *
+ * @param[in]   replay  A replay handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_replay_stop(gpio_replay_h replay);
+
+/**
+ * @brief   Gets whether a replay is still playing, and how many changes it played.
+ * @since_tizen 3.0
+ *
+ * @param[in]   replay      A replay handle
+ * @param[out]  running     If playing, @c true; Otherwise @c false
+ * @param[out]  event_count The number of changes played by the current or last run
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_replay_get_progress(gpio_replay_h replay, bool *running, unsigned long long *event_count);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_CLOCK_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Switches the library between the real clock and a virtual clock.
+ * @details Sampling deadlines, replay pacing and event timestamps all follow the selected clock.
+ *          The virtual clock starts at the current time and only moves on gpio_clock_advance(),
+ *          so a scenario of several seconds runs as fast as its callbacks, with exact timestamps.
+ *          It should be selected before any listener or replay is started.
+ * @since_tizen 3.0
+ *
+ * @param[in]   enable  If @c true, the virtual clock; Otherwise the real clock
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ */
+int gpio_clock_set_virtual(bool enable);
+
+/**
+ * @brief   Advances the virtual clock.
+ * @details Time moves from one deadline to the next, and every sampling or replay step due at a deadline
+ *          runs, callbacks included, before time moves on. When this function returns,
+ *          everything due up to the new time has run.
+ *          It must not be called from a callback.
+ * @since_tizen 3.0
+ *
+ * @param[in]   ns  The time to advance by, in nanoseconds
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    The virtual clock is not selected
+ * @see     gpio_clock_set_virtual()
+ */
+int gpio_clock_advance(unsigned long long ns);
+
+/**
+ * @brief   Gets the time of the clock in use, in nanoseconds from an arbitrary origin.
+ * @since_tizen 3.0
+ *
+ * @param[out]  ns  The time
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_clock_get_time(unsigned long long *ns);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_BUS_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Event bus reader handle.
+ * @details An event bus carries the port changes a sampler sees to any number of local processes,
+ *          through a ring in shared memory with a single writer.
+ *          Every reader has its own position in the ring; the writer never waits for readers,
+ *          and a reader too slow to keep up loses the oldest events, which it is told about.
+ *          Readers cost the publisher neither register reads nor messages.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_bus_reader_s *gpio_bus_reader_h;
+
+/**
+ * @brief   Event read from a bus, see gpio_bus_reader_read().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    unsigned long long sequence;   /**< Number of the event on the bus, one more than the previous one */
+    unsigned long long timestamp;  /**< Time of the sample, in milliseconds */
+    gpio_port_e port;              /**< The port */
+    uint32_t state;                /**< The state of the port */
+    uint32_t changed;              /**< The pins that changed since the previous event of the port,
+                                        0 for the first event of the port after the publisher started */
+} gpio_bus_event_s;
+
+/**
+ * @brief   Starts publishing what the sampler of this process reads to an event bus.
+ * @details Every change the sampler sees on a port, for the listeners or injected data, becomes an event.
+ *          Only sampled ports are published, at the rate of their listeners.
+ *          The bus is created afresh, readable by every user and writable by this process only,
+ *          replacing any bus of that name: readers of a previous publisher must open it again.
+ *          The bus stays when publishing stops.
+ * @since_tizen 3.0
+ *
+ * @param[in]   name        The name of the shared memory object, starting with '/'. If NULL, the default bus.
+ * @param[in]   slot_count  The number of events the ring holds, a power of two up to 16777216. If 0, 4096.
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The shared memory object cannot be created, or one of that name cannot be replaced
+ */
+int gpio_bus_start(const char *name, unsigned int slot_count);
+
+/**
+ * @brief   Stops publishing to the event bus.
+ * @since_tizen 3.0
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ */
+int gpio_bus_stop(void);
+
+/**
+ * @brief   Opens a reader of an event bus.
+ * @details The reader gets the events published from now on. It maps the bus read-only.
+ *          A publisher that restarts creates a new bus, which must be opened again.
+ * @since_tizen 3.0
+ *
+ * @param[in]   name    The name of the bus. If NULL, the default bus, which the gpio service publishes to.
+ * @param[out]  reader  The reader handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             There is no such bus
+ */
+int gpio_bus_reader_open(const char *name, gpio_bus_reader_h *reader);
+
+/**
+ * @brief   Closes a reader of an event bus.
+ * @since_tizen 3.0
+ *
+ * @param[in]   reader  The reader handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_bus_reader_close(gpio_bus_reader_h reader);
+
+/**
+ * @brief   Reads the next events of a bus, without blocking.
+ * @details When the writer lapped the reader, the reader goes on from the oldest event still in the ring,
+ *          and @c lost counts the events it missed. A reader handle must not be used by two threads at once.
+ * @since_tizen 3.0
+ *
+ * @param[in]   reader      The reader handle
+ * @param[out]  events      The events read, in order
+ * @param[in]   max_count   The number of entries in @c events
+ * @param[out]  count       The number of events read
+ * @param[out]  lost        The number of events missed since the previous call
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_bus_reader_read(gpio_bus_reader_h reader, gpio_bus_event_s *events, unsigned int max_count,
+		unsigned int *count, unsigned long long *lost);
+
+/**
+ * @brief   Waits until the reader has events to read.
+ * @since_tizen 3.0
+ *
+ * @param[in]   reader      The reader handle
+ * @param[in]   timeout_ms  The longest wait in milliseconds, 0 to only check, or -1 to wait forever
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Events are ready
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_NO_DATA              No event before the timeout
+ */
+int gpio_bus_reader_wait(gpio_bus_reader_h reader, int timeout_ms);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_PWM_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Drives a pin with a software PWM signal.
+ * @details All PWM pins, and scheduled writes, are driven by a single thread, with real-time priority
+ *          when the process is allowed to, which sleeps until right before the next edge and spins the rest of the way.
+ *          Pins of a port that change at the same instant are written together, and periods start on
+ *          multiples of the period, so pins set to the same frequency rise together.
+ *          The pin is set to output. A new pin starts at its next period; a pin already driven
+ *          switches to the new settings at the start of its next period, without a glitch.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin             The pin
+ * @param[in]   frequency_hz    The frequency, from 0.01 to 100000 Hz
+ * @param[in]   duty            The part of each period the pin is HIGH, from 0 to 1.
+ *                              0 and 1 hold the pin LOW or HIGH without edges.
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ * @see     gpio_pwm_unset()
+ */
+int gpio_pwm_set(gpio_pin_e pin, double frequency_hz, double duty);
+
+/**
+ * @brief   Stops driving a pin with PWM, and leaves it LOW.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin     The pin
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    The pin is not driven with PWM
+ */
+int gpio_pwm_unset(gpio_pin_e pin);
+
+/**
+ * @brief   Gets the PWM settings of a pin, as last set.
+ * @details The frequency is the one of the whole number of nanoseconds the period was rounded to.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin             The pin
+ * @param[out]  frequency_hz    The frequency
+ * @param[out]  duty            The duty cycle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the pin is not driven with PWM
+ */
+int gpio_pwm_get(gpio_pin_e pin, double *frequency_hz, double *duty);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_OUTPUT_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Write to do at a given time, see gpio_output_schedule().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    gpio_pin_e pin;                 /**< The pin */
+    gpio_value_e value;             /**< The value to write */
+    unsigned long long time_ns;     /**< When to write, on the clock of gpio_clock_get_time() */
+} gpio_output_edge_s;
+
+/**
+ * @brief   Report of a scheduled write once done, see gpio_output_read_reports().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    gpio_pin_e pin;                 /**< The pin */
+    gpio_value_e value;             /**< The value written */
+    unsigned long long time_ns;     /**< When the write was scheduled */
+    long long error_ns;             /**< The time of the write minus the scheduled time */
+} gpio_output_report_s;
+
+/**
+ * @brief   Schedules writes to output pins.
+ * @details The writes are done by the thread that drives PWM pins, so the caller does not wait for any of them.
+ *          Writes due at the same time on a port are merged into one write of its data register;
+ *          two writes to a pin at the same time are done in the order they were scheduled.
+ *          A write already due is done right away. The pins are set to output.
+ *          Every write done gets a report, see gpio_output_read_reports().
+ * @since_tizen 3.0
+ *
+ * @param[in]   edges       The writes, in any order
+ * @param[in]   edge_count  The number of writes
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or a pin is driven with PWM
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ * @see     gpio_clock_get_time()
+ */
+int gpio_output_schedule(const gpio_output_edge_s *edges, unsigned int edge_count);
+
+/**
+ * @brief   Cancels the scheduled writes to a pin that are not done yet.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin             The pin
+ * @param[out]  cancel_count    The number of writes canceled, or NULL
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ */
+int gpio_output_cancel(gpio_pin_e pin, unsigned int *cancel_count);
+
+/**
+ * @brief   Reads the reports of the scheduled writes done, oldest first.
+ * @details The last 1024 reports are kept; older ones are dropped, and counted in @c lost.
+ * @since_tizen 3.0
+ *
+ * @param[out]  reports     The reports
+ * @param[in]   max_count   The number of entries in @c reports
+ * @param[out]  count       The number of reports read
+ * @param[out]  lost        The number of reports dropped since the previous call
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_output_read_reports(gpio_output_report_s *reports, unsigned int max_count,
+		unsigned int *count, unsigned long long *lost);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_PATTERN_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Pattern player handle.
+ * @details A pattern is a file of port values played one per sample period to the data register of a port,
+ *          from a dedicated thread that sleeps until shortly before each sample and spins the rest.
+ *          The file is mapped, not loaded: a prefetch thread keeps the next samples in memory
+ *          ahead of playback and releases those played.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_pattern_s *gpio_pattern_h;
+
+/**
+ * @brief   Accounting of a pattern playback, see gpio_pattern_get_stats().
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    bool running;                          /**< If the pattern is playing */
+    unsigned long long sample_count;       /**< Samples in the pattern */
+    unsigned long long samples_played;     /**< Samples played so far, updated every 1024 samples while running */
+    unsigned long long samples_late;       /**< Samples written more than one period late */
+    unsigned long long samples_underrun;   /**< Samples played before the prefetcher had them in memory */
+} gpio_pattern_stats_s;
+
+/**
+ * @brief   Writes a pattern file.
+ * @since_tizen 3.0
+ *
+ * @param[in]   path            The file to create
+ * @param[in]   port            The port to play the pattern to
+ * @param[in]   mask            The pins driven by the pattern; the other pins of the port are left alone
+ * @param[in]   sample_rate     The number of samples per second
+ * @param[in]   values          The values, one per sample, bit @c i for pin @c i of the port, 1 for HIGH
+ * @param[in]   sample_count    The number of values
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or a port that is not a #gpio_port_e value
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be written
+ */
+int gpio_pattern_write(const char *path, gpio_port_e port, uint8_t mask, unsigned int sample_rate,
+		const uint8_t *values, unsigned long long sample_count);
+
+/**
+ * @brief   Opens a pattern file for playback.
+ * @since_tizen 3.0
+ *
+ * @param[in]   path        The pattern file
+ * @param[out]  pattern     The pattern handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the file is not a pattern
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The file cannot be mapped, or the registers cannot be accessed
+ * @see     gpio_pattern_close()
+ */
+int gpio_pattern_open(const char *path, gpio_pattern_h *pattern);
+
+/**
+ * @brief   Closes a pattern, stopping it first if needed.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pattern     The pattern handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_pattern_close(gpio_pattern_h pattern);
+
+/**
+ * @brief   Plays a pattern from its first sample.
+ * @details The pins of the mask are set to output. Playback stops by itself after the last sample.
+ *          A late sample is still written, so the pattern is never shortened; the samples after it catch up.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pattern     The pattern handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the pattern is already playing
+ * @retval  #GPIO_ERROR_IO_ERROR             The pins or the threads cannot be set up
+ */
+int gpio_pattern_start(gpio_pattern_h pattern);
+
+/**
+ * @brief   Stops playing a pattern.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pattern     The pattern handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_pattern_stop(gpio_pattern_h pattern);
+
+/**
+ * @brief   Gets the accounting of the current or last playback of a pattern.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pattern     The pattern handle
+ * @param[out]  stats       The accounting
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_pattern_get_stats(gpio_pattern_h pattern, gpio_pattern_stats_s *stats);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_SPI_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Software SPI master handle.
+ * @details The bus is bit-banged from the calling thread. Each half clock is one store of a precomputed
+ *          image of the clock port, MOSI included when it is on the same port; otherwise MOSI takes
+ *          one more store. The other pins of those ports must not change during a transfer.
+ *          A handle must not be used by two threads at once.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_spi_s *gpio_spi_h;
+
+/**
+ * @brief   Enumeration for SPI modes, as clock polarity * 2 + clock phase.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_SPI_MODE_0 = 0,    /**< Clock idles LOW, data sampled on the rising edge */
+    GPIO_SPI_MODE_1,        /**< Clock idles LOW, data sampled on the falling edge */
+    GPIO_SPI_MODE_2,        /**< Clock idles HIGH, data sampled on the falling edge */
+    GPIO_SPI_MODE_3,        /**< Clock idles HIGH, data sampled on the rising edge */
+} gpio_spi_mode_e;
+
+/**
+ * @brief   Enumeration for the order of the bits of a byte on the bus.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_SPI_BIT_ORDER_MSB = 0,    /**< Most significant bit first */
+    GPIO_SPI_BIT_ORDER_LSB,        /**< Least significant bit first */
+} gpio_spi_bit_order_e;
+
+/**
+ * @brief   Creates a software SPI master, in mode 0, MSB first, as fast as possible.
+ * @details The clock and MOSI pins are set to output.
+ * @since_tizen 3.0
+ *
+ * @param[in]   sclk    The clock pin
+ * @param[in]   mosi    The data output pin
+ * @param[out]  spi     The SPI handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ * @see     gpio_spi_destroy()
+ */
+int gpio_spi_create(gpio_pin_e sclk, gpio_pin_e mosi, gpio_spi_h *spi);
+
+/**
+ * @brief   Destroys a software SPI master.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi     The SPI handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_spi_destroy(gpio_spi_h spi);
+
+/**
+ * @brief   Sets the data input pin, needed to receive. The pin is set to input.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi     The SPI handle
+ * @param[in]   miso    The data input pin
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or a pin already used by the bus
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ */
+int gpio_spi_set_miso(gpio_spi_h spi, gpio_pin_e miso);
+
+/**
+ * @brief   Sets the chip select pin, active LOW during each transfer. The pin is set to output, HIGH.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi     The SPI handle
+ * @param[in]   cs      The chip select pin
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or a pin already used by the bus
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ */
+int gpio_spi_set_cs(gpio_spi_h spi, gpio_pin_e cs);
+
+/**
+ * @brief   Sets the SPI mode.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi     The SPI handle
+ * @param[in]   mode    The mode
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_spi_set_mode(gpio_spi_h spi, gpio_spi_mode_e mode);
+
+/**
+ * @brief   Sets the order of the bits of each byte.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi         The SPI handle
+ * @param[in]   bit_order   The bit order
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_spi_set_bit_order(gpio_spi_h spi, gpio_spi_bit_order_e bit_order);
+
+/**
+ * @brief   Sets the clock frequency.
+ * @details The clock is timed on the steady clock, spinning through half clocks shorter than the wake-up jitter.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi             The SPI handle
+ * @param[in]   frequency_hz    The clock frequency, or 0 for as fast as the registers go
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_spi_set_frequency(gpio_spi_h spi, unsigned int frequency_hz);
+
+/**
+ * @brief   Exchanges bytes with the selected peripheral, in full duplex.
+ * @details The chip select, if set, is held LOW for the whole transfer.
+ * @since_tizen 3.0
+ *
+ * @param[in]   spi     The SPI handle
+ * @param[in]   tx      The bytes to send, or NULL to send zeros
+ * @param[out]  rx      The bytes received, or NULL to discard them
+ * @param[in]   length  The number of bytes
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or @c rx without a data input pin
+ */
+int gpio_spi_transfer(gpio_spi_h spi, const uint8_t *tx, uint8_t *rx, unsigned int length);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_I2C_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Software I2C master handle.
+ * @details The bus is bit-banged from the calling thread. Both lines are open drain: a line is driven
+ *          LOW by setting its pin to output, and released by setting it back to input, so the bus
+ *          needs its pull-up resistors. The other pins of those ports must not change direction
+ *          during a transfer. A handle must not be used by two threads at once.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_i2c_s *gpio_i2c_h;
+
+/**
+ * @brief   Enumeration for the outcome of an I2C transaction.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_I2C_STATUS_OK = 0,     /**< Every byte was acknowledged */
+    GPIO_I2C_STATUS_NACK,       /**< The address or a written byte was not acknowledged */
+    GPIO_I2C_STATUS_TIMEOUT,    /**< A slave held the clock LOW longer than the stretch timeout */
+    GPIO_I2C_STATUS_BUS_BUSY,   /**< A line was LOW before the start condition */
+} gpio_i2c_status_e;
+
+/**
+ * @brief   Structure for one segment of an I2C transaction: the address, then the bytes of one direction.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    uint16_t address;       /**< The 7-bit slave address */
+    bool read;              /**< true to read from the slave, false to write to it */
+    uint8_t *buffer;        /**< The bytes to write, or the buffer for the bytes read */
+    unsigned int length;    /**< The number of bytes */
+} gpio_i2c_segment_s;
+
+/**
+ * @brief   Structure for an I2C transaction: its segments, joined by repeated starts, and ended by a stop.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    const gpio_i2c_segment_s *segments;     /**< The segments */
+    unsigned int segment_count;             /**< The number of segments */
+    gpio_i2c_status_e status;               /**< Set by gpio_i2c_transfer() */
+    unsigned int stretch_count;             /**< Set by gpio_i2c_transfer(): the clock pulses a slave stretched */
+} gpio_i2c_transaction_s;
+
+/**
+ * @brief   Creates a software I2C master, at 400 kHz, with a stretch timeout of 10 ms.
+ * @details Both pins are set to input, releasing the lines.
+ * @since_tizen 3.0
+ *
+ * @param[in]   scl     The clock pin
+ * @param[in]   sda     The data pin
+ * @param[out]  i2c     The I2C handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ * @see     gpio_i2c_destroy()
+ */
+int gpio_i2c_create(gpio_pin_e scl, gpio_pin_e sda, gpio_i2c_h *i2c);
+
+/**
+ * @brief   Destroys a software I2C master.
+ * @since_tizen 3.0
+ *
+ * @param[in]   i2c     The I2C handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_i2c_destroy(gpio_i2c_h i2c);
+
+/**
+ * @brief   Sets the clock frequency.
+ * @details The clock is timed by spinning on the steady clock, against deadlines, so the time spent
+ *          accessing the registers is part of each wait rather than added to it.
+ * @since_tizen 3.0
+ *
+ * @param[in]   i2c             The I2C handle
+ * @param[in]   frequency_hz    The clock frequency, up to 1 MHz
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_i2c_set_frequency(gpio_i2c_h i2c, unsigned int frequency_hz);
+
+/**
+ * @brief   Sets how long a slave may hold the clock LOW before the transaction fails.
+ * @since_tizen 3.0
+ *
+ * @param[in]   i2c         The I2C handle
+ * @param[in]   timeout_us  The timeout, in microseconds
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_i2c_set_stretch_timeout(gpio_i2c_h i2c, unsigned int timeout_us);
+
+/**
+ * @brief   Runs transactions back to back.
+ * @details Each transaction gets its own status; a failed one ends with a stop, when the clock is free,
+ *          and the next one still runs. The last byte of each read segment is not acknowledged.
+ * @since_tizen 3.0
+ *
+ * @param[in]       i2c                 The I2C handle
+ * @param[in,out]   transactions        The transactions
+ * @param[in]       transaction_count   The number of transactions
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Every transaction succeeded
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             At least one transaction failed, see its status
+ */
+int gpio_i2c_transfer(gpio_i2c_h i2c, gpio_i2c_transaction_s *transactions, unsigned int transaction_count);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_DECODER_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Enumeration for the protocol decoders a gpio listener can run.
+ * @details The IR decoders expect the active LOW output of a demodulating IR receiver.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_DECODER_NONE = 0,    /**< No decoder, the listener reports edges */
+    GPIO_DECODER_NEC,         /**< NEC IR remote control protocol, with repeat codes */
+    GPIO_DECODER_RC5,         /**< Philips RC5 IR remote control protocol, with the extended command bit */
+    GPIO_DECODER_UART,        /**< Asynchronous serial, 8 data bits, no parity, 1 stop bit, idle HIGH */
+} gpio_decoder_e;
+
+/**
+ * @brief   Structure for a frame decoded by a gpio listener.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    gpio_decoder_e decoder;             /**< The decoder of the frame */
+    unsigned long long timestamp_ns;    /**< Start of the frame, in ns of the library clock */
+    uint32_t address;                   /**< NEC: the 8-bit address, or 16 bits for extended NEC. RC5: the 5-bit address */
+    uint32_t command;                   /**< NEC: the 8-bit command. RC5: the 7-bit command. UART: the byte */
+    bool repeat;                        /**< NEC: a repeat code, with the address and command of the last frame */
+    bool toggle;                        /**< RC5: the toggle bit, which changes on every key press */
+} gpio_frame_s;
+
+/**
+ * @brief   Called from the sampling thread of a gpio listener when it decoded a frame.
+ * @since_tizen 3.0
+ *
+ * @param[in] gpio      The corresponding gpio handle
+ * @param[in] frame     The frame
+ * @param[in] data      The user data passed to gpio_listener_set_decoder()
+ */
+typedef void (*gpio_frame_cb)(gpio_h gpio, const gpio_frame_s *frame, void *data);
+
+/**
+ * @brief   Runs a protocol decoder on the samples of a gpio listener.
+ * @details The decoder runs on every sample of the pin, and the listener then only reports
+ *          the decoded frames: its edge events are no longer delivered, neither to its callback nor to its queue.
+ *          Frames that do not decode are dropped.@n
+ *          Edges are timed to the sample that saw them, so the decoder puts the listener in fast mode,
+ *          sampling eight times per shortest pulse: every 70 us for NEC, 111 us for RC5, an eighth of the bit
+ *          for UART, see gpio_listener_set_fast_sampling(). Between frames, once the pin held its level longer
+ *          than any pulse of a frame, it is sampled only as often as the first edge of the next frame needs,
+ *          sleeping instead of spinning: every millisecond or so for NEC, about every 200 us for RC5, less
+ *          the wake-up jitter. A UART must see its start bit within a quarter bit, so it keeps spinning,
+ *          and a core busy, unless that is longer than the wake-up jitter plus 100 us: about 1200 baud or less.
+ *          A port fed by gpio_inject_data() or a replay delivers each change with its own time.
+ *          Setting #GPIO_DECODER_NONE goes back to edge events, and leaves the fast mode the decoder needed.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle
+ * @param[in]   decoder     The decoder
+ * @param[in]   param       The baud rate for #GPIO_DECODER_UART, ignored otherwise
+ * @param[in]   callback    The function called with each frame, ignored with #GPIO_DECODER_NONE
+ * @param[in]   data        The user data to be passed to @c callback
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_NOT_SUPPORTED        The baud rate needs a sampling period shorter than 10 us
+ * @retval  #GPIO_ERROR_IO_ERROR             The sampling thread cannot be started
+ */
+int gpio_listener_set_decoder(gpio_listener_h listener, gpio_decoder_e decoder, unsigned int param,
+		gpio_frame_cb callback, void *data);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_MEASUREMENT_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Structure for the statistics of one kind of pulse time.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    unsigned int count;             /**< The number of values in the window, 0 if none was measured yet */
+    unsigned long long min_ns;      /**< The shortest value */
+    unsigned long long max_ns;      /**< The longest value */
+    double mean_ns;                 /**< The mean value */
+} gpio_measurement_stats_s;
+
+/**
+ * @brief   Structure for the pulse measurement of a gpio listener.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    gpio_measurement_stats_s high;      /**< HIGH times, from a rising to the next falling edge */
+    gpio_measurement_stats_s low;       /**< LOW times, from a falling to the next rising edge */
+    gpio_measurement_stats_s period;    /**< Periods, from a rising to the next rising edge */
+    double frequency_hz;                /**< The inverse of the mean period, 0 without periods */
+    double duty;                        /**< The mean HIGH time over the mean period, 0 without periods */
+    unsigned long long resolution_ns;   /**< The coarsest sampling period the edges were seen at, each up to that late,
+                                             0 if all were delivered by gpio_inject_data() or a replay */
+} gpio_measurement_s;
+
+/**
+ * @brief   Measures the pulses seen by a gpio listener.
+ * @details The sampler times every edge of the pin, in ns of the library clock, and keeps the last @c window
+ *          HIGH times, LOW times and periods, which gpio_listener_get_measurement() summarizes. No callback is
+ *          involved, and the events of the listener are delivered as before.@n
+ *          Edges are timed to the sample that saw them, so the resolution is the sampling interval,
+ *          or the period of gpio_listener_set_fast_sampling() for pulses shorter than a few milliseconds,
+ *          and is reported in @c resolution_ns. A port fed by gpio_inject_data() or a replay delivers each
+ *          change with its own time.
+ *          Setting a window drops the values kept so far; a window of 0 stops measuring.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener    A listener handle
+ * @param[in]   window      The number of values of each kind to keep, or 0
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ */
+int gpio_listener_set_measurement(gpio_listener_h listener, unsigned int window);
+
+/**
+ * @brief   Gets the statistics of the pulses a gpio listener measured.
+ * @since_tizen 3.0
+ *
+ * @param[in]   listener        A listener handle
+ * @param[out]  measurement     The statistics over the window
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_NO_DATA              The listener does not measure
+ */
+int gpio_listener_get_measurement(gpio_listener_h listener, gpio_measurement_s *measurement);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_ENCODER_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Quadrature encoder handle.
+ * @details An encoder samples its two pins with a single read of their port, at a fixed rate,
+ *          on a thread of its own, and counts every state change: four counts per cycle.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_encoder_s *gpio_encoder_h;
+
+/**
+ * @brief   Structure for the state of a quadrature encoder.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    long long position;                 /**< Counts, up when A leads B */
+    double velocity;                    /**< Counts per second over the last velocity window */
+    unsigned long long invalid_count;   /**< Samples where both pins changed: steps were missed, the sample rate is too low */
+    unsigned long long late_count;      /**< Samples taken more than one period late */
+    unsigned long long sample_count;    /**< Samples taken */
+} gpio_encoder_state_s;
+
+/**
+ * @brief   Creates a quadrature encoder, and starts counting from 0.
+ * @details Both pins are set to input. The sampling thread sleeps until shortly before each sample and spins the rest,
+ *          so it only keeps a core busy at rates where samples are closer together than the wake-up jitter.
+ * @since_tizen 3.0
+ *
+ * @param[in]   pin_a           The pin of channel A
+ * @param[in]   pin_b           The pin of channel B, on the same port as @c pin_a
+ * @param[in]   sample_rate     The number of samples per second
+ * @param[out]  encoder         The encoder handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or pins on different ports
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed, or the sampling thread cannot be started
+ * @see     gpio_encoder_destroy()
+ */
+int gpio_encoder_create(gpio_pin_e pin_a, gpio_pin_e pin_b, unsigned int sample_rate, gpio_encoder_h *encoder);
+
+/**
+ * @brief   Stops and destroys a quadrature encoder.
+ * @since_tizen 3.0
+ *
+ * @param[in]   encoder     The encoder handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_encoder_destroy(gpio_encoder_h encoder);
+
+/**
+ * @brief   Sets the window the velocity is measured over, 10 ms by default.
+ * @since_tizen 3.0
+ *
+ * @param[in]   encoder     The encoder handle
+ * @param[in]   window_ms   The window, in milliseconds
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_encoder_set_velocity_window(gpio_encoder_h encoder, unsigned int window_ms);
+
+/**
+ * @brief   Reads the state of a quadrature encoder.
+ * @details The read never blocks the sampling thread, and can be made from any thread.
+ *          The state is updated on every count, and at the end of every velocity window.
+ * @since_tizen 3.0
+ *
+ * @param[in]   encoder     The encoder handle
+ * @param[out]  state       The state
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_encoder_read(gpio_encoder_h encoder, gpio_encoder_state_s *state);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_KEYPAD_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Matrix keypad scanner handle.
+ * @details The rows are outputs on one port, and the columns inputs with pull-ups on one port.
+ *          A scan drives each row LOW in turn with one write of the row port, and reads every column
+ *          with one read of the column port, so a 4x4 keypad takes 10 register accesses per scan.
+ *          The other pins of the row port must not change during a scan.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_keypad_s *gpio_keypad_h;
+
+/**
+ * @brief   Structure for a key event of a keypad.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    int row;                            /**< The index of the row in the rows of the keypad */
+    int column;                         /**< The index of the column in the columns of the keypad */
+    bool pressed;                       /**< true when the key went down, false when it went up */
+    unsigned long long timestamp_ns;    /**< The scan that completed the debounce, in ns of the library clock */
+} gpio_keypad_event_s;
+
+/**
+ * @brief   Called from the scanning thread when a key goes down or up.
+ * @details The keypad must not be stopped or destroyed from the callback.
+ * @since_tizen 3.0
+ *
+ * @param[in] keypad    The keypad handle
+ * @param[in] event     The key event
+ * @param[in] data      The user data passed to gpio_keypad_set_event_cb()
+ */
+typedef void (*gpio_keypad_event_cb)(gpio_keypad_h keypad, const gpio_keypad_event_s *event, void *data);
+
+/**
+ * @brief   Creates a matrix keypad scanner, scanning 200 times per second with a debounce of 20 ms.
+ * @details The rows are set to output, HIGH, and the columns to input.
+ * @since_tizen 3.0
+ *
+ * @param[in]   rows            The row pins, all on one port
+ * @param[in]   row_count       The number of rows, up to 8
+ * @param[in]   columns         The column pins, all on one port
+ * @param[in]   column_count    The number of columns, up to 8
+ * @param[out]  keypad          The keypad handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, rows or columns on several ports, or a pin used twice
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed
+ * @see     gpio_keypad_destroy()
+ */
+int gpio_keypad_create(const gpio_pin_e *rows, int row_count, const gpio_pin_e *columns, int column_count,
+		gpio_keypad_h *keypad);
+
+/**
+ * @brief   Stops and destroys a matrix keypad scanner.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad  The keypad handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_keypad_destroy(gpio_keypad_h keypad);
+
+/**
+ * @brief   Sets the number of scans per second.
+ * @details The debounce time is converted to a number of scans at this rate.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad      The keypad handle
+ * @param[in]   scan_rate   The number of scans per second
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_keypad_set_scan_rate(gpio_keypad_h keypad, unsigned int scan_rate);
+
+/**
+ * @brief   Sets how long a key must read the same state before it changes, for each key on its own.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad          The keypad handle
+ * @param[in]   debounce_ms     The debounce time in milliseconds, rounded up to whole scans, at least one
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_keypad_set_debounce(gpio_keypad_h keypad, unsigned int debounce_ms);
+
+/**
+ * @brief   Sets the function called when a key goes down or up, or NULL for none.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad      The keypad handle
+ * @param[in]   callback    The callback function
+ * @param[in]   data        The user data to be passed to @c callback
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_keypad_set_event_cb(gpio_keypad_h keypad, gpio_keypad_event_cb callback, void *data);
+
+/**
+ * @brief   Starts scanning, on a thread of the keypad.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad  The keypad handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ * @retval  #GPIO_ERROR_IO_ERROR             The scanning thread cannot be started
+ */
+int gpio_keypad_start(gpio_keypad_h keypad);
+
+/**
+ * @brief   Stops scanning. Keys keep their state until scanning starts again.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad  The keypad handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_keypad_stop(gpio_keypad_h keypad);
+
+/**
+ * @brief   Gets the keys that are down, after debouncing.
+ * @since_tizen 3.0
+ *
+ * @param[in]   keypad      The keypad handle
+ * @param[out]  pressed     Bit row * 8 + column is set while the key is down
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_keypad_get_state(gpio_keypad_h keypad, unsigned long long *pressed);
+
+/**
+ * @}
+ */
+
+/**
+ * @addtogroup CAPI_SYSTEM_GPIO_MOTION_MODULE
+ * @{
+ */
+
+/**
+ * @brief   Step/direction motion handle.
+ * @details A motion drives a stepper driver through a step pin and a direction pin. Every move is
+ *          planned when it is queued: the time of each of its steps is computed up front, so the
+ *          timing thread of the motion only waits for each time and pulses the step pin.
+ *          Queued moves play back to back, each starting where the previous one ended.
+ * @since_tizen 3.0
+ */
+typedef struct gpio_motion_s *gpio_motion_h;
+
+/**
+ * @brief   Enumeration for the shape of the acceleration of a move.
+ * @since_tizen 3.0
+ */
+typedef enum
+{
+    GPIO_MOTION_PROFILE_TRAPEZOID = 0,  /**< Constant acceleration: the rate changes linearly */
+    GPIO_MOTION_PROFILE_S_CURVE,        /**< The rate follows a half cosine, without a jump of acceleration at either end of a ramp */
+} gpio_motion_profile_e;
+
+/**
+ * @brief   Structure for a move of a motion.
+ * @details The rate ramps from @c start_rate up to @c max_rate, cruises, and ramps down to @c end_rate.
+ *          A move too short to reach @c max_rate turns around at the highest rate it can reach.
+ *          To chain moves without a stop, make the end rate of a move the start rate of the next one.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    long long steps;                    /**< The number of steps, negative to move backward */
+    double start_rate;                  /**< Steps per second at the start of the move */
+    double max_rate;                    /**< Highest steps per second */
+    double end_rate;                    /**< Steps per second at the end of the move */
+    double acceleration;                /**< Steps per second squared, the peak for an S-curve; 0 moves at @c max_rate throughout */
+    gpio_motion_profile_e profile;      /**< The shape of the ramps */
+} gpio_motion_move_s;
+
+/**
+ * @brief   Structure for the statistics of a motion.
+ * @since_tizen 3.0
+ */
+typedef struct
+{
+    long long position;                 /**< Steps made, forward minus backward */
+    unsigned long long step_count;      /**< Steps made in either direction */
+    unsigned long long move_count;      /**< Moves played to the end */
+    unsigned int queued_moves;          /**< Moves waiting after the one being played */
+    bool busy;                          /**< true while a move is being played or waiting */
+    unsigned long long max_late_ns;     /**< Largest delay of a step pulse after its planned time */
+    double mean_late_ns;                /**< Mean delay of the step pulses after their planned times */
+    double planned_rate;                /**< Mean steps per second of the last move played to the end, as planned */
+    double achieved_rate;               /**< Mean steps per second of the last move played to the end, as pulsed */
+} gpio_motion_stats_s;
+
+/**
+ * @brief   Creates a step/direction motion, and starts its timing thread.
+ * @details Both pins are set to output, the step pin LOW and the direction pin HIGH, for forward.
+ *          The thread sleeps until shortly before each step and spins the rest, with real-time priority
+ *          when the process may use it.
+ * @since_tizen 3.0
+ *
+ * @param[in]   step        The step pin, pulsed HIGH once per step
+ * @param[in]   dir         The direction pin, HIGH to move forward
+ * @param[out]  motion      The motion handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or the same pin twice
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ * @retval  #GPIO_ERROR_IO_ERROR             The registers cannot be accessed, or the timing thread cannot be started
+ * @see     gpio_motion_destroy()
+ */
+int gpio_motion_create(gpio_pin_e step, gpio_pin_e dir, gpio_motion_h *motion);
+
+/**
+ * @brief   Stops and destroys a step/direction motion, dropping the moves not played yet.
+ * @since_tizen 3.0
+ *
+ * @param[in]   motion  The motion handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_motion_destroy(gpio_motion_h motion);
+
+/**
+ * @brief   Sets the timing the driver requires, by default a 2 us step pulse, and 1 us of direction setup and hold.
+ * @since_tizen 3.0
+ *
+ * @param[in]   motion          The motion handle
+ * @param[in]   pulse_ns        How long the step pin stays HIGH, in ns
+ * @param[in]   dir_setup_ns    The least time from a direction change to the next step, in ns
+ * @param[in]   dir_hold_ns     The least time from the end of a step to a direction change, in ns
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_motion_set_timing(gpio_motion_h motion, unsigned int pulse_ns, unsigned int dir_setup_ns,
+		unsigned int dir_hold_ns);
+
+/**
+ * @brief   Plans a move, and queues it after the moves already queued.
+ * @details The planning runs in the calling thread, and takes memory for one timestamp per step.
+ *          A move that reverses the direction starts late enough for the direction hold and setup times.
+ * @since_tizen 3.0
+ *
+ * @param[in]   motion  The motion handle
+ * @param[in]   move    The move
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter, or a move too short to go from its start rate to its end rate
+ * @retval  #GPIO_ERROR_OUT_OF_MEMORY        Out of memory
+ */
+int gpio_motion_queue(gpio_motion_h motion, const gpio_motion_move_s *move);
+
+/**
+ * @brief   Drops the queued moves, and ends the move being played before its next step.
+ * @details The motion stops at once, without ramping down.
+ * @since_tizen 3.0
+ *
+ * @param[in]   motion  The motion handle
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_motion_stop(gpio_motion_h motion);
+
+/**
+ * @brief   Gets the position and the timing statistics of a motion.
+ * @since_tizen 3.0
+ *
+ * @param[in]   motion  The motion handle
+ * @param[out]  stats   The statistics
+ *
+ * @return  #GPIO_ERROR_NONE on success, otherwise a negative error value
+ * @retval  #GPIO_ERROR_NONE                 Successful
+ * @retval  #GPIO_ERROR_INVALID_PARAMETER    Invalid parameter
+ */
+int gpio_motion_get_stats(gpio_motion_h motion, gpio_motion_stats_s *stats);
+
+/**
+ * @}
+ */
+
 
 
 
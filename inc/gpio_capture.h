@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_CAPTURE_H__
+#define __GPIO_CAPTURE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "gpio.h"
+
+/*
+ * High-rate capture of whole ports.
+ *
+ * The sampling thread stores one byte per port and sample in a staging
+ * block of GPIO_CAPTURE_WORD_BITS samples. Once the block is full it is
+ * transposed into one 64-bit word per pin, so the buffer holds, for each
+ * port and pin, a plane of words where bit i of word w is sample 64w+i.
+ *
+ * With a trigger armed the planes are used as a ring and sampling goes
+ * on until the post-trigger count is reached. Each plane has one spare
+ * word, so the word being filled never overwrites the window to keep.
+ *
+ * With a stream set, the words go to fixed-size blocks instead, which a
+ * writer thread persists, see gpio_capture_stream.cpp.
+ */
+
+#define GPIO_CAPTURE_WORD_BITS 64
+#define GPIO_CAPTURE_PORT_PINS 8
+
+/*
+ * Trigger on the port at @port_index, evaluated on every sample:
+ * hits when (cur & mask) == value and, unless changed is 0,
+ * one of the changed bits differs from the previous sample.
+ */
+struct gpio_capture_trigger_s {
+	bool armed;
+	int port_index;
+	uint8_t mask;
+	uint8_t value;
+	uint8_t changed;
+	uint8_t always; //0xff when changed is 0
+};
+
+struct gpio_capture_stream_s;
+
+struct gpio_capture_s {
+	int port_count;
+	gpio_port_e *ports;
+	volatile uint32_t **data; //data register of each port
+	uint64_t period_ns;
+
+	unsigned int capacity; //samples kept per pin, a multiple of GPIO_CAPTURE_WORD_BITS
+	unsigned int word_count; //words per pin, one more than capacity needs
+	uint64_t *words; //[port][pin][word]
+	uint8_t *staging; //[port][GPIO_CAPTURE_WORD_BITS]
+
+	struct gpio_capture_trigger_s trigger;
+	unsigned int pre_count;
+	unsigned int post_count;
+
+	uint64_t taken; //samples taken, owned by the sampling thread
+	std::atomic<uint64_t> committed; //samples visible to readers
+	std::atomic<bool> triggered;
+	uint64_t trigger_at; //sample that hit the trigger, valid once triggered
+	uint64_t late; //samples taken more than one period late
+
+	struct gpio_capture_stream_s *stream; //NULL unless streaming
+	gpio_summary_h *summaries; //[port][pin], NULL until first needed
+
+	std::atomic<bool> running;
+	std::thread thread;
+};
+
+/* Plane of @pin on the port at @port_index */
+static inline uint64_t *gpio_capture_plane(struct gpio_capture_s *capture, int port_index, int pin)
+{
+	return capture->words + ((size_t)port_index * GPIO_CAPTURE_PORT_PINS + pin) * capture->word_count;
+}
+
+static inline bool gpio_capture_trigger_hit(const struct gpio_capture_trigger_s *trigger,
+		uint8_t prev, uint8_t cur)
+{
+	return !((cur & trigger->mask) ^ trigger->value) &&
+		(((prev ^ cur) & trigger->changed) | trigger->always);
+}
+
+/*
+ * Transposes an 8x8 bit matrix held in a word, one row per byte:
+ * bit j of byte i moves to bit i of byte j.
+ */
+static inline uint64_t gpio_capture_transpose8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+	return x;
+}
+
+/* Edges of word @w of a plane: bit i is set if sample 64w+i differs from the one before */
+static inline uint64_t gpio_capture_edge_word(const uint64_t *words, size_t w)
+{
+	uint64_t carry = w ? words[w - 1] >> 63 : words[0] & 1;
+
+	return words[w] ^ ((words[w] << 1) | carry);
+}
+
+/*
+ * Stream format: a gpio_capture_stream_header_s, the uint32_t port of
+ * each captured port padded to 8 bytes, then blocks. Each block is a
+ * gpio_capture_block_header_s followed by the pin planes of the block,
+ * laid out as in memory with block_samples / 64 words per plane.
+ * A block may be partially filled, and blocks the writer could not keep
+ * up with are missing, counted in the dropped field of the next block.
+ */
+#define GPIO_CAPTURE_STREAM_MAGIC 0x42435047 //"GPCB"
+#define GPIO_CAPTURE_STREAM_VERSION 1
+
+struct gpio_capture_stream_header_s {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t port_count;
+	uint64_t period_ns;
+	uint32_t block_samples;
+	uint32_t reserved;
+};
+
+struct gpio_capture_block_header_s {
+	uint64_t first_sample;
+	uint32_t sample_count;
+	uint32_t dropped; //blocks dropped right before this one
+};
+
+struct gpio_capture_stream_s {
+	int fd;
+	unsigned int block_words; //words per plane in a block
+	unsigned int block_count;
+	size_t block_size; //bytes of a block, header included
+	uint8_t *blocks; //block_count blocks, then a spare one that takes the samples of dropped blocks
+
+	/* Owned by the sampling thread */
+	uint8_t *filling;
+	uint64_t filling_first;
+	uint32_t dropped;
+
+	std::atomic<uint64_t> produced; //blocks queued for the writer
+	std::atomic<uint64_t> consumed; //blocks the writer is done with
+	std::atomic<bool> closing;
+	std::mutex lock;
+	std::condition_variable cond;
+	std::thread writer;
+	int64_t offset; //file offset of the next write, -1 when writing at the file position
+	gpio_summary_h *summaries; //those of the capture, extended by the writer
+	unsigned int plane_count;
+
+	std::atomic<uint64_t> blocks_written;
+	std::atomic<uint64_t> blocks_dropped;
+	std::atomic<uint64_t> samples_dropped;
+	std::atomic<uint64_t> bytes_written;
+	std::atomic<unsigned int> max_pending;
+	std::atomic<int> error;
+};
+
+/*
+ * Packs the staged samples into word @word of each pin plane,
+ * the plane of port index p and pin i starting at planes + (8p + i) * stride.
+ */
+void gpio_capture_pack(struct gpio_capture_s *capture, uint64_t *planes, size_t stride, size_t word);
+
+/* Counts of a run of pin plane words, see gpio_capture_edges.cpp */
+struct gpio_capture_edge_counts_s {
+	uint64_t rising;
+	uint64_t falling;
+	uint64_t high;
+};
+
+/*
+ * Edge kernels, scalar or vectorized. count() adds the edges and high
+ * samples of @word_count whole words; scan() returns the first word from
+ * @from on holding an edge, or @word_count if none does.
+ */
+struct gpio_capture_edge_ops_s {
+	const char *name;
+	void (*count)(const uint64_t *words, size_t word_count, struct gpio_capture_edge_counts_s *counts);
+	size_t (*scan)(const uint64_t *words, size_t from, size_t word_count);
+};
+
+extern const struct gpio_capture_edge_ops_s gpio_capture_edge_scalar;
+
+/* The fastest kernels the CPU runs */
+const struct gpio_capture_edge_ops_s *gpio_capture_edge_ops(void);
+
+/* Summary side, see gpio_summary.cpp */
+void gpio_summary_reset(gpio_summary_h summary);
+
+/* Marks the samples up to @sample, excluded, as missing */
+void gpio_summary_skip(gpio_summary_h summary, unsigned long long sample);
+
+/* Stream side, called by the capture */
+int gpio_capture_stream_begin(struct gpio_capture_s *capture);
+void gpio_capture_stream_store(struct gpio_capture_s *capture, uint64_t word);
+void gpio_capture_stream_end(struct gpio_capture_s *capture);
+void gpio_capture_stream_destroy(struct gpio_capture_s *capture);
+
+/* Creates the summaries of the capture, if not done yet */
+int gpio_capture_summaries_init(struct gpio_capture_s *capture);
+
+#endif // __GPIO_CAPTURE_H__
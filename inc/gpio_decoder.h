@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_DECODER_H__
+#define __GPIO_DECODER_H__
+
+#include <stdint.h>
+
+#include "gpio.h"
+
+/*
+ * Protocol decoders run by the sampler on the pin of a listener.
+ *
+ * The sampler feeds every sample of the pin, with its time in ns of the
+ * library clock; the listener samples in fast mode, at no more than
+ * gpio_decoder_period_ns(). The framework turns the samples into pulses: when the
+ * level changes, the level that just ended is handed to pulse() with
+ * its start and end; otherwise idle() is told how long the current level
+ * has lasted, for decoders whose frames can end without an edge. Either
+ * returns true when it completed a frame, at most one per sample.
+ *
+ * A decoder is an ops table and a state in the union below; adding one
+ * takes an entry in gpio_decoder.cpp and a #gpio_decoder_e value.
+ */
+
+struct gpio_decoder_s;
+
+struct gpio_decoder_ops_s {
+	gpio_decoder_e type;
+	void (*reset)(struct gpio_decoder_s *decoder);
+	bool (*pulse)(struct gpio_decoder_s *decoder, bool level, uint64_t start_ns, uint64_t end_ns,
+			gpio_frame_s *frame);
+	bool (*idle)(struct gpio_decoder_s *decoder, bool level, uint64_t since_ns, uint64_t now_ns,
+			gpio_frame_s *frame);
+};
+
+struct gpio_decoder_nec_s {
+	int step;
+	unsigned int bits;
+	uint32_t value;
+	uint64_t start_ns; //of the leader
+	bool valid; //a frame was decoded, so a repeat code can refer to it
+	uint32_t address;
+	uint32_t command;
+};
+
+struct gpio_decoder_rc5_s {
+	unsigned int halves; //half bits of the frame so far
+	uint32_t levels; //bit i is the level of half bit i
+	uint64_t start_ns;
+};
+
+struct gpio_decoder_uart_s {
+	bool receiving;
+	unsigned int slot; //next bit to sample: start bit, 8 data bits, stop bit
+	unsigned int bits; //bit i is the level sampled in slot i
+	uint64_t start_ns; //falling edge of the start bit
+};
+
+struct gpio_decoder_s {
+	const struct gpio_decoder_ops_s *ops;
+	uint64_t bit_ns; //shortest pulse: bit time, half bit time for RC5, bit mark for NEC
+	uint64_t quiet_ns; //a level held longer is not within a frame
+	uint64_t lateness_ns; //how late the first edge of a frame may be seen
+	bool primed; //level and since hold the first sample
+	bool level;
+	uint64_t since_ns; //time of the last change
+	union {
+		struct gpio_decoder_nec_s nec;
+		struct gpio_decoder_rc5_s rc5;
+		struct gpio_decoder_uart_s uart;
+	};
+};
+
+/* NULL with GPIO_DECODER_NONE, an unknown type or bad @param, or out of memory */
+struct gpio_decoder_s *gpio_decoder_create(gpio_decoder_e type, unsigned int param);
+void gpio_decoder_destroy(struct gpio_decoder_s *decoder);
+
+/* Longest sampling period that still times the pulses of @decoder */
+uint64_t gpio_decoder_period_ns(const struct gpio_decoder_s *decoder);
+
+/*
+ * Between frames, once the pin held a level for gpio_decoder_quiet_ns(),
+ * it only needs a sample every gpio_decoder_lateness_ns(), wake-up
+ * jitter included: the first edge of the next frame can be that late.
+ */
+uint64_t gpio_decoder_quiet_ns(const struct gpio_decoder_s *decoder);
+uint64_t gpio_decoder_lateness_ns(const struct gpio_decoder_s *decoder);
+
+/* Feeds a sample of the pin; true when @frame was filled */
+bool gpio_decoder_feed(struct gpio_decoder_s *decoder, bool level, uint64_t now_ns, gpio_frame_s *frame);
+
+#endif // __GPIO_DECODER_H__
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_EDGELOG_H__
+#define __GPIO_EDGELOG_H__
+
+#include <stdint.h>
+
+/*
+ * Edge log file format, all fields little endian and unaligned:
+ *
+ *   header       gpio_edgelog_header_s, then uint32_t port[port_count]
+ *                and uint8_t state[port_count], the states at start_ns
+ *   records      varint time delta in ns from the previous record,
+ *                uint8_t port index, uint8_t mask of the bits that changed
+ *   checkpoint   before every index_interval-th record: uint64_t time of
+ *                the previous record, uint64_t ordinal of the next record
+ *                and uint8_t state[port_count] after the previous record
+ *   index        gpio_edgelog_index_s for every checkpoint
+ *   trailer      gpio_edgelog_trailer_s
+ *
+ * A reader binary searches the index, seeks to the checkpoint and
+ * decodes at most index_interval records from there.
+ */
+
+#define GPIO_EDGELOG_MAGIC 0x4c455047 //"GPEL"
+#define GPIO_EDGELOG_INDEX_MAGIC 0x49455047 //"GPEI"
+#define GPIO_EDGELOG_VERSION 1
+#define GPIO_EDGELOG_MAX_PORTS 255
+#define GPIO_EDGELOG_VARINT_MAX 10
+
+struct gpio_edgelog_header_s {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t port_count;
+	uint32_t index_interval;
+	uint32_t reserved;
+	uint64_t start_ns;
+};
+
+struct gpio_edgelog_index_s {
+	uint64_t time_ns;
+	uint64_t offset; //of the checkpoint
+};
+
+struct gpio_edgelog_trailer_s {
+	uint64_t index_offset;
+	uint64_t record_count;
+	uint64_t end_ns; //time of the last record, start_ns if none
+	uint32_t index_count;
+	uint32_t magic;
+};
+
+static inline size_t gpio_edgelog_varint_put(uint8_t *buffer, uint64_t value)
+{
+	size_t size = 0;
+
+	while (value >= 0x80) {
+		buffer[size++] = (uint8_t)value | 0x80;
+		value >>= 7;
+	}
+	buffer[size++] = (uint8_t)value;
+	return size;
+}
+
+/* Returns the bytes read, 0 if the varint runs past @end */
+static inline size_t gpio_edgelog_varint_get(const uint8_t *buffer, const uint8_t *end, uint64_t *value)
+{
+	uint64_t result = 0;
+	size_t size = 0;
+
+	while (buffer + size < end && size < GPIO_EDGELOG_VARINT_MAX) {
+		uint8_t byte = buffer[size];
+
+		result |= (uint64_t)(byte & 0x7f) << (7 * size);
+		size++;
+		if (!(byte & 0x80)) {
+			*value = result;
+			return size;
+		}
+	}
+	return 0;
+}
+
+#endif // __GPIO_EDGELOG_H__
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_MEASURE_H__
+#define __GPIO_MEASURE_H__
+
+#include <stdint.h>
+#include <new>
+#include <atomic>
+#include <mutex>
+
+#include "gpio.h"
+
+/*
+ * Pulse measurement of a listener: the sampler hands every change of the
+ * pin to gpio_measure_edge() with its time in ns, and how late that time
+ * can be: the sampling period it was seen at. The change turns into a
+ * HIGH time at a falling edge, a LOW time and a period at a rising edge.
+ * Each kind goes to a ring of the last window values, and the statistics
+ * are computed from the rings when queried, so the sampler only stores.
+ *
+ * The sampler stores under the pass lock, which serializes it, and never
+ * waits on a reader: readers compute under a sequence count, and compute
+ * again if it moved. seq is odd while the sampler stores. lock only keeps
+ * the rings from being replaced under a reader; the window is set under
+ * the pass lock too.
+ */
+
+enum {
+	GPIO_MEASURE_HIGH = 0,
+	GPIO_MEASURE_LOW,
+	GPIO_MEASURE_PERIOD,
+	GPIO_MEASURE_KINDS,
+};
+
+struct gpio_measure_ring_s {
+	unsigned int head; //next value to write
+	unsigned int count;
+};
+
+struct gpio_measure_s {
+	std::mutex lock;
+	std::atomic<uint64_t> seq;
+	std::atomic<unsigned int> window; //0 while off
+	uint64_t *values; //[kind][window]
+	struct gpio_measure_ring_s rings[GPIO_MEASURE_KINDS];
+	bool risen; //rise_ns holds an edge
+	bool fallen;
+	uint64_t rise_ns; //last rising edge
+	uint64_t fall_ns;
+	uint64_t resolution_ns; //coarsest sampling period of the edges since the window was set
+
+	gpio_measure_s() : seq(0), window(0), values(NULL), risen(false), fallen(false), resolution_ns(0) {}
+	~gpio_measure_s() {
+		delete[] values;
+	}
+};
+
+/* Keeps the last @window values of each kind, dropping those kept so far; 0 turns measuring off; under the pass lock */
+static inline int gpio_measure_set_window(struct gpio_measure_s *measure, unsigned int window)
+{
+	std::lock_guard<std::mutex> lock(measure->lock);
+	uint64_t *values = NULL;
+
+	if (window) {
+		values = new(std::nothrow) uint64_t[(size_t)window * GPIO_MEASURE_KINDS];
+		if (!values)
+			return -1;
+	}
+
+	delete[] measure->values;
+	measure->values = values;
+	for (int k = 0; k < GPIO_MEASURE_KINDS; k++) {
+		measure->rings[k].head = 0;
+		measure->rings[k].count = 0;
+	}
+	measure->risen = false;
+	measure->fallen = false;
+	measure->resolution_ns = 0;
+	measure->window.store(window, std::memory_order_release);
+	return 0;
+}
+
+static inline bool gpio_measure_active(struct gpio_measure_s *measure)
+{
+	return measure->window.load(std::memory_order_acquire) != 0;
+}
+
+static inline void gpio_measure_put(struct gpio_measure_s *measure, int kind, uint64_t value)
+{
+	struct gpio_measure_ring_s *ring = &measure->rings[kind];
+	unsigned int window = measure->window.load(std::memory_order_relaxed);
+
+	measure->values[(size_t)kind * window + ring->head] = value;
+	ring->head = (ring->head + 1) % window;
+	if (ring->count < window)
+		ring->count++;
+}
+
+/* The pin changed to @level at @now_ns, seen by a sample taken every @resolution_ns, 0 if timed exactly */
+static inline void gpio_measure_edge(struct gpio_measure_s *measure, bool level, uint64_t now_ns,
+		uint64_t resolution_ns)
+{
+	uint64_t seq = measure->seq.load(std::memory_order_relaxed);
+
+	if (!measure->values)
+		return;
+
+	measure->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	if (resolution_ns > measure->resolution_ns)
+		measure->resolution_ns = resolution_ns;
+
+	if (level) {
+		if (measure->fallen)
+			gpio_measure_put(measure, GPIO_MEASURE_LOW, now_ns - measure->fall_ns);
+		if (measure->risen)
+			gpio_measure_put(measure, GPIO_MEASURE_PERIOD, now_ns - measure->rise_ns);
+		measure->risen = true;
+		measure->rise_ns = now_ns;
+	} else {
+		if (measure->risen)
+			gpio_measure_put(measure, GPIO_MEASURE_HIGH, now_ns - measure->rise_ns);
+		measure->fallen = true;
+		measure->fall_ns = now_ns;
+	}
+	measure->seq.store(seq + 2, std::memory_order_release);
+}
+
+static inline void gpio_measure_stats(struct gpio_measure_s *measure, int kind, gpio_measurement_stats_s *stats)
+{
+	const struct gpio_measure_ring_s *ring = &measure->rings[kind];
+	const uint64_t *values = measure->values + (size_t)kind * measure->window.load(std::memory_order_relaxed);
+	unsigned int count = ring->count; //never above the window, even if the sampler stores meanwhile
+	uint64_t sum = 0;
+
+	stats->count = count;
+	stats->min_ns = count ? UINT64_MAX : 0;
+	stats->max_ns = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		if (values[i] < stats->min_ns)
+			stats->min_ns = values[i];
+		if (values[i] > stats->max_ns)
+			stats->max_ns = values[i];
+		sum += values[i];
+	}
+	stats->mean_ns = count ? (double)sum / count : 0;
+}
+
+/* Statistics of the values kept, -1 if measuring is off */
+static inline int gpio_measure_get(struct gpio_measure_s *measure, gpio_measurement_s *measurement)
+{
+	std::lock_guard<std::mutex> lock(measure->lock);
+	uint64_t begin;
+
+	if (!measure->values)
+		return -1;
+
+	/* Computes again if the sampler stored meanwhile */
+	do {
+		begin = measure->seq.load(std::memory_order_acquire);
+		gpio_measure_stats(measure, GPIO_MEASURE_HIGH, &measurement->high);
+		gpio_measure_stats(measure, GPIO_MEASURE_LOW, &measurement->low);
+		gpio_measure_stats(measure, GPIO_MEASURE_PERIOD, &measurement->period);
+		measurement->resolution_ns = measure->resolution_ns;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((begin & 1) || measure->seq.load(std::memory_order_relaxed) != begin);
+
+	measurement->frequency_hz = measurement->period.mean_ns ? 1e9 / measurement->period.mean_ns : 0;
+	measurement->duty = measurement->period.mean_ns ? measurement->high.mean_ns / measurement->period.mean_ns : 0;
+	return 0;
+}
+
+#endif // __GPIO_MEASURE_H__
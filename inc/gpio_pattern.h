@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GPIO_PATTERN_H__
+#define __GPIO_PATTERN_H__
+
+#include <stdint.h>
+
+/*
+ * Pattern file format, all fields little endian:
+ *
+ *   header   gpio_pattern_header_s
+ *   values   uint8_t value[sample_count], bit i for pin i of the port,
+ *            1 for HIGH; only the pins of the mask are driven
+ *
+ * The values are played one per period, straight from a read-only
+ * mapping of the file.
+ */
+
+#define GPIO_PATTERN_MAGIC 0x54504750 //"GPPT"
+#define GPIO_PATTERN_VERSION 1
+
+struct gpio_pattern_header_s {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size; //offset of the values
+	uint32_t port;
+	uint32_t mask;
+	uint64_t period_ns;
+	uint64_t sample_count;
+};
+
+#endif // __GPIO_PATTERN_H__
@@ -15,7 +15,13 @@
  */
 #include <gpio.h>
 #include <thread>
+#include <chrono>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "gpio_event_queue.h"
+#include "gpio_measure.h"
 
 #ifndef __GPIO_PRIVATE_H__
 #define __GPIO_PRIVATE_H__
@@ -25,23 +31,188 @@ extern "C"
 {
 #endif
 
+#define GET_PORT(pin) ((pin) >> 3)
+#define GET_OFFSET(pin) ((pin) & 7)
+
+#define GPIO_NS_PER_SEC 1000000000ULL
+#define GPIO_NS_PER_MS 1000000ULL
+#define GPIO_NS_PER_US 1000ULL
+
+struct gpio_decoder_s;
+
 struct gpio_listener_s {
 	int id;
 	gpio_pin_e pin;
 	gpio_direction_e direction;
 	gpio_value_e data;
+	gpio_edge_e edge;
 	int pause;
 	std::atomic<unsigned int> batch_latency;
+	bool adaptive; //if the interval follows the activity of the pin; the interval fields are under the pass lock
+	unsigned int interval_fast; //adaptive interval bounds in ms
+	unsigned int interval_max;
+	unsigned int interval; //current adaptive interval in ms
 	unsigned int magic;
-	std::thread *read_thread;
 	std::atomic<bool> active; //if listener is started
+	uint32_t prev; //port snapshot the last edges were computed from
+	std::atomic<uint64_t> due; //next sampling time in ns
 	gpio_h gpio;
 	gpio_event_cb callback;
 	void *user_data;
 	void *accu_callback;
 	void *accu_user_data;
+	struct gpio_event_queue_s queue; //events for gpio_listener_drain(), in fd mode
+	struct gpio_decoder_s *decoder; //NULL unless frames are decoded; swapped under the sampler pass lock
+	gpio_frame_cb frame_callback;
+	void *frame_user_data;
+	struct gpio_measure_s measure; //pulse statistics for gpio_listener_get_measurement()
+	unsigned int fast_period_us; //set by gpio_listener_set_fast_sampling(), 0 if not
+	std::atomic<uint64_t> fast_period_ns; //in effect, decoder included; 0 while the shared sampler samples the pin
+	std::atomic<uint64_t> fast_idle_ns; //period between decoded frames, slept without spinning; 0 to keep fast_period_ns
+	std::atomic<uint64_t> fast_quiet_ns; //time without an edge after which the pin is between frames
+	bool fast_running; //under fast_lock
+	bool fast_exited; //under fast_lock, once fast_thread is past its last sample and only needs joining
+	std::mutex fast_lock;
+	std::condition_variable fast_cond;
+	std::thread fast_thread;
+};
+
+/* Direct register layer, implemented in gpio.cpp */
+int gpio_port_init(void);
+int gpio_port_read(gpio_port_e port, uint32_t *value);
+int gpio_port_write(gpio_port_e port, uint32_t value);
+int gpio_pin_set_direction(gpio_pin_e pin, gpio_direction_e direction);
+
+/*
+ * Joins the fast mode thread of a listener the registry is about to
+ * delete. Returns false while that thread has not exited yet, as when the
+ * listener was destroyed from a callback: the deletion is retried later.
+ */
+bool gpio_listener_reap(gpio_listener_h listener);
+
+/* Whether @port is a port of gpio_port_e; check ports read from files before taking their registers */
+bool gpio_port_valid(gpio_port_e port);
+
+/* Data register of @port for tight loops, NULL before gpio_port_init() */
+volatile uint32_t *gpio_port_data(gpio_port_e port);
+
+/*
+ * Configuration register of @port, NULL before gpio_port_init(): 4 bits
+ * per pin, the lowest one set for output, as set_pin_mode() does
+ */
+volatile uint32_t *gpio_port_config(gpio_port_e port);
+
+/*
+ * Image of a data register with the pins of @high driven HIGH and those
+ * of @low driven LOW. As in set_pin_value(), a pin is driven HIGH by
+ * clearing its bit, and LOW by setting it.
+ */
+static inline uint32_t gpio_data_drive(uint32_t image, uint32_t high, uint32_t low)
+{
+	return (image | low) & ~high;
+}
+
+/*
+ * Virtual ports: while attached, reads of the port return its value
+ * instead of the register. Attachments are counted, so each user detaches
+ * only what it attached; gpio_virtual_port_set() changes the value of a
+ * port already attached. gpio_sampler_feed() then delivers the change to
+ * the listeners of the port, with @timestamp_ms as the event time.
+ */
+int gpio_virtual_port_attach(gpio_port_e port, uint32_t value);
+void gpio_virtual_port_set(gpio_port_e port, uint32_t value);
+void gpio_virtual_port_detach(gpio_port_e port);
+void gpio_sampler_feed(gpio_port_e port, unsigned long long timestamp_ms);
+
+/*
+ * Publishes a port state the sampler read to the event bus, if one was
+ * started, see gpio_bus.cpp. Only changes are published; callers are
+ * serialized by the sampler.
+ */
+void gpio_bus_publish(gpio_port_e port, uint32_t state, unsigned long long timestamp_ms);
+
+/*
+ * Time source of the library, see gpio_clock.cpp: the steady and system
+ * clocks, or a virtual clock that only moves on gpio_clock_advance().
+ * Deadlines are in ns of gpio_clock_now_ns(); a thread waiting for one
+ * must be woken with gpio_clock_notify(), not by the condition itself.
+ * Calibration and captures time the hardware and keep the steady clock.
+ */
+struct gpio_clock_ops_s {
+	uint64_t (*now_ns)(void);
+	unsigned long long (*timestamp_ms)(void); //time of events
+	void (*wait_until)(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns);
 };
 
+uint64_t gpio_clock_now_ns(void);
+unsigned long long gpio_clock_timestamp_ms(void);
+void gpio_clock_wait_until(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, uint64_t deadline_ns);
+void gpio_clock_notify(std::condition_variable &cond);
+bool gpio_clock_is_virtual(void);
+
+/*
+ * A thread started by the library is busy for gpio_clock_advance() until
+ * its first wait: the starter calls gpio_clock_hold() before creating it,
+ * or gpio_clock_release() if that fails, and the thread gpio_clock_enter().
+ */
+void gpio_clock_hold(void);
+void gpio_clock_enter(void);
+void gpio_clock_release(void);
+
+/* Capabilities of the board measured at init, see gpio_calibration.cpp */
+struct gpio_calibration_s {
+	uint32_t read_ns; //cost of one data register read
+	uint32_t write_ns; //cost of one data register write
+	uint32_t clock_ns; //cost of one clock reading
+	uint32_t wakeup_jitter_ns; //worst lateness of a timed sleep
+	uint32_t ipc_ns; //round trip through the gpio service, 0 if not measured
+};
+
+extern struct gpio_calibration_s gpio_calibration;
+
+void gpio_calibrate(void);
+
+/* Threads that time the hardware keep the steady clock, whatever gpio_clock_now_ns() follows */
+static inline uint64_t gpio_steady_now_ns(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#define GPIO_SLEEP_MIN_NS 100000ULL //shorter waits are spun
+
+/*
+ * Waits for @due_ns of gpio_steady_now_ns(): sleeps until the wake-up
+ * jitter before it, then spins the rest, so a period shorter than the
+ * jitter is only spun. Returns the time it was reached at.
+ */
+static inline uint64_t gpio_steady_wait_until(uint64_t due_ns)
+{
+	uint64_t early = gpio_calibration.wakeup_jitter_ns;
+	uint64_t now = gpio_steady_now_ns();
+
+	if (due_ns > now + early + GPIO_SLEEP_MIN_NS)
+		std::this_thread::sleep_for(std::chrono::nanoseconds(due_ns - early - now));
+	while ((now = gpio_steady_now_ns()) < due_ns)
+		;
+	return now;
+}
+
+/*
+ * Returns the bits of a port snapshot that raise an event for @edge, given
+ * the previous snapshot of the same port. Every flag of @edge is widened to
+ * an all-ones or all-zeros mask, so all pins are evaluated without branches.
+ */
+static inline uint32_t gpio_edge_filter(gpio_edge_e edge, uint32_t prev, uint32_t snapshot)
+{
+	uint32_t changed = prev ^ snapshot;
+
+	return (changed & snapshot & -(uint32_t)(edge & 1)) |
+		(changed & ~snapshot & -(uint32_t)((edge >> 1) & 1)) |
+		(snapshot & -(uint32_t)((edge >> 2) & 1)) |
+		(~snapshot & -(uint32_t)((edge >> 3) & 1));
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,24 +21,25 @@
 #include <limits.h>
 #include <unistd.h>
 #include <thread>
-#include <chrono>
 
 #include "gpio.h"
 #include "gpio_private.h"
+#include "gpio_registry.h"
+#include "gpio_decoder.h"
 #include <libgen.h>
 #include <memory>
 #include "gpio_log.h"
 
 #include <map>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
 
 using std::map;
 
 #define GPIO0   0x13400000
 #define GPIO3   0x14010000
 
-#define GET_PORT(pin) ((pin) >> 3)
-#define GET_OFFSET(pin) ((pin) & 7)
-
 #define RETURN_VAL_IF(expr, err) \
 	do { \
 		if (expr) { \
@@ -59,6 +60,12 @@ using std::map;
 
 #define GPIO_LISTENER_MAGIC 0xCAFECAFE
 
+#define GPIO_SAMPLER_IDLE_NS 1000000000ULL
+#define GPIO_INTERVAL_MIN_MS 1
+#define GPIO_FAST_PERIOD_MIN_US 10
+#define GPIO_FAST_PERIOD_MAX_US 1000
+#define GPIO_VIRTUAL_PORTS 8
+
 #define CONVERT_AXIS_ENUM(X) ((X) < 3 ? (X) + 0x81 : (X) - 2)
 
 #define CONVERT_OPTION_PAUSE_POLICY(option) ((option) ^ 0b11)
@@ -73,15 +80,107 @@ using std::map;
 static uint8_t gpio_isinit = 0;
 static volatile uint32_t *gpio_base[2];
 
-map<int, gpio_listener_h> listener_map;
+/* Listeners live in the registry; sampler_lock only guards the sampler's sleep */
+static std::mutex sampler_lock;
+static std::condition_variable sampler_cond;
+static bool sampler_running = false;
+static bool sampler_kicked = false;
+static std::atomic<int> listener_count(0);
+
+/* Serializes sampler passes; recursive, as a callback may inject data and feed a nested pass */
+static std::recursive_mutex sampler_pass_lock;
+
+/* Serializes changes of the fast mode of listeners, and of their decoders which it depends on */
+static std::mutex fast_mode_lock;
+
+/*
+ * Ports fed by gpio_inject_data() or a replay instead of the registers.
+ * Slots are only ever appended, so readers scan them without a lock.
+ * A port stays virtual while any replay, or injection, holds it attached.
+ */
+struct gpio_virtual_port_s {
+	gpio_port_e port;
+	std::atomic<bool> attached;
+	std::atomic<uint32_t> value;
+	int refs; //attachments, under virtual_port_lock
+	bool injected; //one of them is gpio_inject_data()'s
+};
+
+static gpio_virtual_port_s virtual_ports[GPIO_VIRTUAL_PORTS];
+static std::atomic<int> virtual_port_count(0);
+static std::mutex virtual_port_lock;
 
 map<gpio_pin_e, gpio_direction_e> gpio_direction;
 map<gpio_pin_e, gpio_value_e> gpio_value;
 
+static gpio_virtual_port_s *find_virtual_port(gpio_port_e port) {
+    int count = virtual_port_count.load(std::memory_order_acquire);
 
-int gpio_inject_data(gpio_pin_e pin, gpio_value_e value) {
-  gpio_value[pin] = value;
+    for (int i = 0; i < count; i++) {
+        if (virtual_ports[i].port == port)
+            return &virtual_ports[i];
+    }
+    return NULL;
+}
+
+/* Takes one more attachment of @port, set to @value; called with virtual_port_lock held */
+static gpio_virtual_port_s *virtual_port_attach(gpio_port_e port, uint32_t value) {
+    gpio_virtual_port_s *virtual_port = find_virtual_port(port);
+
+    if (!virtual_port) {
+        int count = virtual_port_count.load();
+
+        if (count == GPIO_VIRTUAL_PORTS) {
+            _E("No room for virtual port 0x%x", port);
+            return NULL;
+        }
+        virtual_port = &virtual_ports[count];
+        virtual_port->port = port;
+        virtual_port->refs = 0;
+        virtual_port->injected = false;
+        virtual_port->attached = false;
+        virtual_port_count.store(count + 1, std::memory_order_release);
+    }
+    virtual_port->refs++;
+    virtual_port->value.store(value, std::memory_order_release);
+    virtual_port->attached.store(true, std::memory_order_release);
+    return virtual_port;
+}
+
+/* Drops one attachment of @port; called with virtual_port_lock held */
+static void virtual_port_detach(gpio_virtual_port_s *virtual_port) {
+    if (virtual_port->refs > 0 && --virtual_port->refs == 0)
+        virtual_port->attached.store(false, std::memory_order_release);
+}
+
+int gpio_virtual_port_attach(gpio_port_e port, uint32_t value) {
+    std::lock_guard<std::mutex> lock(virtual_port_lock);
+
+    return virtual_port_attach(port, value) ? 0 : -1;
+}
+
+void gpio_virtual_port_set(gpio_port_e port, uint32_t value) {
+    gpio_virtual_port_s *virtual_port = find_virtual_port(port);
 
+    if (virtual_port)
+        virtual_port->value.store(value, std::memory_order_release);
+}
+
+void gpio_virtual_port_detach(gpio_port_e port) {
+    std::lock_guard<std::mutex> lock(virtual_port_lock);
+    gpio_virtual_port_s *virtual_port = find_virtual_port(port);
+
+    if (virtual_port)
+        virtual_port_detach(virtual_port);
+}
+
+static bool virtual_port_attached(gpio_port_e port) {
+    gpio_virtual_port_s *virtual_port;
+
+    if (!virtual_port_count.load(std::memory_order_relaxed))
+        return false;
+    virtual_port = find_virtual_port(port);
+    return virtual_port && virtual_port->attached.load(std::memory_order_acquire);
 }
 
 static int init_gpio() {
@@ -94,18 +193,23 @@ static int init_gpio() {
 
     gpio_base[0] = (uint32_t*)mmap(0, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
                                 GPIO0);
-    if (gpio_base[0] < 0){
+    if ((void *)gpio_base[0] == MAP_FAILED){
         printf("Mmap failed.\n");
+        close(fd);
         return -1;
     }
 
     gpio_base[1] = (uint32_t*)mmap(0, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
                                 GPIO3);
-    if (gpio_base[1] < 0){
+    if ((void *)gpio_base[1] == MAP_FAILED){
         printf("Mmap failed.\n");
+        munmap((void *)gpio_base[0], getpagesize());
+        close(fd);
         return -1;
     }
+    close(fd);
     gpio_isinit = 1;
+    gpio_calibrate();
     return 0;
 }
 
@@ -113,7 +217,11 @@ static int8_t set_pin_mode(gpio_pin_e pin, gpio_direction_e mode) {
     gpio_port_e port = (gpio_port_e)GET_PORT(pin);
     uint8_t offset = GET_OFFSET(pin) << 2;
 
-    if (!gpio_isinit) init_gpio();
+    /* A virtual port has no register, so pins on it work off the hardware */
+    if (virtual_port_attached(port))
+        return 0;
+    if (!gpio_isinit && init_gpio() < 0)
+        return -1;
 
     volatile uint32_t *base = gpio_base[port > 0x100?0:1];
     if (mode) {
@@ -137,16 +245,26 @@ static int8_t get_pin_mode(gpio_pin_e pin) {
     return !!(*(base + port) & (1 << offset));
 }
 
-static int8_t get_pin_value(gpio_pin_e pin) {
-    gpio_port_e port = (gpio_port_e)GET_PORT(pin);
-    uint8_t offset = GET_OFFSET(pin);
-
+static int8_t get_port_value(gpio_port_e port, uint32_t *value) {
+    if (virtual_port_attached(port)) {
+        *value = find_virtual_port(port)->value.load(std::memory_order_acquire);
+        return 0;
+    }
     if (!gpio_isinit) {
         _D("GPIO is not initialized!!\n");
         return -1;
     }
     volatile uint32_t *base = gpio_base[port > 0x100?0:1];
-    return !!(*(base + (port + 1)) & (1 << offset));
+    *value = *(base + (port + 1));
+    return 0;
+}
+
+static int8_t get_pin_value(gpio_pin_e pin) {
+    uint32_t value;
+
+    if (get_port_value((gpio_port_e)GET_PORT(pin), &value) < 0)
+        return -1;
+    return !!(value & (1 << GET_OFFSET(pin)));
 }
 
 
@@ -174,57 +292,477 @@ static int8_t set_pin_value(gpio_pin_e pin, gpio_value_e value) {
     return 0;
 }
 
-static void gpio_data_listener(gpio_listener_h listener) {
-	while(listener->active) {
-		std::this_thread::sleep_for(
-			std::chrono::nanoseconds(listener->batch_latency*1000*1000));
-		int prev_value = listener->data;
-		int value;
-		if ((value = get_pin_value(listener->pin)) < 0) {
-			_D("PIN ERROR");
-			return;
+static int8_t set_port_value(gpio_port_e port, uint32_t value) {
+    if (!gpio_isinit) {
+        _D("GPIO is not initialized!!\n");
+        return -1;
+    }
+    volatile uint32_t *base = gpio_base[port > 0x100?0:1];
+    *(base + (port + 1)) = value;
+    return 0;
+}
+
+int gpio_port_init(void) {
+    return gpio_isinit ? 0 : init_gpio();
+}
+
+int gpio_port_read(gpio_port_e port, uint32_t *value) {
+    return get_port_value(port, value);
+}
+
+int gpio_port_write(gpio_port_e port, uint32_t value) {
+    return set_port_value(port, value);
+}
+
+int gpio_pin_set_direction(gpio_pin_e pin, gpio_direction_e direction) {
+    return set_pin_mode(pin, direction);
+}
+
+bool gpio_port_valid(gpio_port_e port) {
+    switch (port) {
+    case GPX0:
+    case GPX1:
+    case GPA0:
+    case GPA1:
+    case GPA2:
+    case GPD0: //also GPB2
+        return true;
+    default:
+        return false;
+    }
+}
+
+volatile uint32_t *gpio_port_data(gpio_port_e port) {
+    if (!gpio_isinit)
+        return NULL;
+    return gpio_base[port > 0x100?0:1] + (port + 1);
+}
+
+volatile uint32_t *gpio_port_config(gpio_port_e port) {
+    if (!gpio_isinit)
+        return NULL;
+    return gpio_base[port > 0x100?0:1] + port;
+}
+
+/* Shortest interval the sampler can keep, given the measured wake-up jitter and read cost */
+static unsigned int gpio_min_interval() {
+	uint64_t ns = (uint64_t)gpio_calibration.wakeup_jitter_ns + gpio_calibration.read_ns;
+	unsigned int interval = (ns + GPIO_NS_PER_MS - 1) / GPIO_NS_PER_MS;
+
+	return interval < GPIO_INTERVAL_MIN_MS ? GPIO_INTERVAL_MIN_MS : interval;
+}
+
+static unsigned int gpio_clamp_interval(unsigned int interval) {
+	unsigned int min_interval = gpio_min_interval();
+
+	return interval < min_interval ? min_interval : interval;
+}
+
+/* Next sampling interval in ms, backing off exponentially while the pin is quiet; under the pass lock */
+static unsigned int gpio_listener_next_interval(gpio_listener_h listener, bool changed) {
+	if (!listener->adaptive)
+		return gpio_clamp_interval(listener->batch_latency);
+
+	if (changed)
+		listener->interval = listener->interval_fast;
+	else if (listener->interval < listener->interval_max / 2)
+		listener->interval *= 2;
+	else
+		listener->interval = listener->interval_max;
+	return listener->interval;
+}
+
+/* Samples @snapshot of the port, taken at @now every @resolution_ns, 0 for a change delivered as it happened */
+static void gpio_listener_sample(gpio_listener_h listener, uint32_t snapshot, uint64_t now,
+		unsigned long long timestamp_ms, uint64_t resolution_ns) {
+	uint32_t bit = 1 << GET_OFFSET(listener->pin);
+	uint32_t events = gpio_edge_filter(listener->edge, listener->prev, snapshot) & bit;
+	bool changed = (listener->prev ^ snapshot) & bit;
+
+	listener->prev = snapshot;
+	listener->data = (snapshot & bit) ? HIGH : LOW;
+	listener->due = now + (uint64_t)gpio_listener_next_interval(listener, changed) * 1000 * 1000;
+	if (changed && gpio_measure_active(&listener->measure))
+		gpio_measure_edge(&listener->measure, snapshot & bit, now, resolution_ns);
+	if (listener->decoder) {
+		gpio_frame_s frame;
+
+		/* Every sample feeds the decoder; only its frames are reported */
+		if (gpio_decoder_feed(listener->decoder, snapshot & bit, now, &frame) && listener->frame_callback)
+			(*listener->frame_callback)(listener->gpio, &frame, listener->frame_user_data);
+		return;
+	}
+	if (events) {
+		gpio_event_s event;
+		event.timestamp = timestamp_ms;
+		event.value = listener->data;
+		if (gpio_event_queue_active(&listener->queue))
+			gpio_event_queue_push(&listener->queue, &event);
+		else if (listener->callback)
+			(*listener->callback)(listener->gpio, &event, listener->user_data);
+	}
+}
+
+#define GPIO_PORT_CACHE_SIZE 8
+
+/* Port registers read during one sampler pass, shared by every listener due in it */
+struct gpio_port_cache_s {
+	int count;
+	gpio_port_e port[GPIO_PORT_CACHE_SIZE];
+	uint32_t value[GPIO_PORT_CACHE_SIZE];
+};
+
+static int8_t get_cached_port_value(gpio_port_cache_s &cache, gpio_port_e port, uint32_t *value) {
+	for (int i = 0; i < cache.count; i++) {
+		if (cache.port[i] == port) {
+			*value = cache.value[i];
+			return 0;
+		}
+	}
+	if (get_port_value(port, value) < 0)
+		return -1;
+	if (cache.count < GPIO_PORT_CACHE_SIZE) {
+		cache.port[cache.count] = port;
+		cache.value[cache.count++] = *value;
+	}
+	return 0;
+}
+
+/*
+ * Single sampling thread for every listener. Each due listener is fed from
+ * one shared read of its port, and keeps its own interval, edge mode and
+ * previous snapshot, so adding listeners does not add register reads.
+ * The listener table is walked without any lock; see gpio_registry.h.
+ */
+static void gpio_sampler() {
+	gpio_clock_enter();
+	while (1) {
+		uint64_t now = gpio_clock_now_ns();
+		uint64_t wake = now + GPIO_SAMPLER_IDLE_NS;
+		unsigned long long timestamp = gpio_clock_timestamp_ms();
+		gpio_port_cache_s cache;
+
+		cache.count = 0;
+		sampler_pass_lock.lock();
+		gpio_registry_read_lock();
+		const gpio_registry_table_s *table = gpio_registry_table();
+		for (size_t i = 0; table && i < table->count; i++) {
+			gpio_listener_h listener = table->listeners[i];
+			uint32_t snapshot;
+
+			/* A listener in fast mode is sampled by its own thread */
+			if (!listener->active || listener->fast_period_ns.load(std::memory_order_relaxed))
+				continue;
+			if (listener->due <= now) {
+				if (get_cached_port_value(cache, (gpio_port_e)GET_PORT(listener->pin), &snapshot) < 0) {
+					_D("PIN ERROR");
+					continue;
+				}
+				gpio_listener_sample(listener, snapshot, now, timestamp,
+						(uint64_t)(listener->adaptive ? listener->interval :
+							gpio_clamp_interval(listener->batch_latency)) * GPIO_NS_PER_MS);
+			}
+			if (listener->due < wake)
+				wake = listener->due;
+		}
+		gpio_registry_read_unlock();
+		for (int p = 0; p < cache.count; p++)
+			gpio_bus_publish(cache.port[p], cache.value[p], timestamp);
+		sampler_pass_lock.unlock();
+		gpio_registry_reclaim();
+
+		std::unique_lock<std::mutex> lock(sampler_lock);
+		if (!sampler_kicked)
+			gpio_clock_wait_until(lock, sampler_cond, wake);
+		sampler_kicked = false;
+	}
+}
+
+/* Wakes the thread of a listener in fast mode, to look at its state again */
+static void gpio_listener_fast_kick(gpio_listener_h listener) {
+	std::lock_guard<std::mutex> lock(listener->fast_lock);
+
+	gpio_clock_notify(listener->fast_cond);
+}
+
+/*
+ * Samples every active listener of @port right away, whatever its interval,
+ * so each change of a virtual port reaches the callbacks. Listeners in fast
+ * mode are kicked too, as the port may just have become real again.
+ */
+void gpio_sampler_feed(gpio_port_e port, unsigned long long timestamp_ms) {
+	std::lock_guard<std::recursive_mutex> pass(sampler_pass_lock);
+	uint64_t now = gpio_clock_now_ns();
+	uint32_t snapshot;
+
+	if (get_port_value(port, &snapshot) < 0)
+		return;
+	gpio_bus_publish(port, snapshot, timestamp_ms);
+
+	gpio_registry_read_lock();
+	const gpio_registry_table_s *table = gpio_registry_table();
+	for (size_t i = 0; table && i < table->count; i++) {
+		gpio_listener_h listener = table->listeners[i];
+
+		if (!listener->active || GET_PORT(listener->pin) != port)
+			continue;
+		gpio_listener_sample(listener, snapshot, now, timestamp_ms, 0);
+		if (listener->fast_period_ns.load(std::memory_order_relaxed))
+			gpio_listener_fast_kick(listener);
+	}
+	gpio_registry_read_unlock();
+	gpio_registry_reclaim();
+}
+
+int gpio_inject_data(gpio_pin_e pin, gpio_value_e value) {
+    gpio_port_e port = (gpio_port_e)GET_PORT(pin);
+    uint32_t bit = 1 << GET_OFFSET(pin);
+    uint32_t state = 0;
+
+    /* The first injection on a port starts from the state of its register */
+    if (get_port_value(port, &state) < 0)
+        state = 0;
+    state = value ? (state | bit) : (state & ~bit);
+
+    {
+        std::lock_guard<std::mutex> lock(virtual_port_lock);
+        gpio_virtual_port_s *virtual_port = find_virtual_port(port);
+
+        /* Injection holds one attachment of the port, until gpio_inject_detach() */
+        if (!virtual_port || !virtual_port->injected) {
+            virtual_port = virtual_port_attach(port, state);
+            if (!virtual_port)
+                return GPIO_ERROR_OUT_OF_MEMORY;
+            virtual_port->injected = true;
+        }
+        virtual_port->value.store(state, std::memory_order_release);
+    }
+    gpio_value[pin] = value;
+    gpio_sampler_feed(port, gpio_clock_timestamp_ms());
+
+    return GPIO_ERROR_NONE;
+}
+
+int gpio_inject_detach(gpio_pin_e pin) {
+    gpio_port_e port = (gpio_port_e)GET_PORT(pin);
+
+    {
+        std::lock_guard<std::mutex> lock(virtual_port_lock);
+        gpio_virtual_port_s *virtual_port = find_virtual_port(port);
+
+        if (!virtual_port || !virtual_port->injected)
+            return GPIO_ERROR_INVALID_PARAMETER;
+        virtual_port->injected = false;
+        virtual_port_detach(virtual_port);
+    }
+    gpio_sampler_feed(port, gpio_clock_timestamp_ms());
+
+    return GPIO_ERROR_NONE;
+}
+
+static void gpio_sampler_schedule(gpio_listener_h listener) {
+	{
+		/* The interval is stepped by sampler passes too */
+		std::lock_guard<std::recursive_mutex> pass(sampler_pass_lock);
+
+		listener->due = gpio_clock_now_ns() + (uint64_t)gpio_listener_next_interval(listener, true) * 1000 * 1000;
+	}
+
+	std::lock_guard<std::mutex> lock(sampler_lock);
+	if (!sampler_running) {
+		gpio_clock_hold();
+		std::thread sampler_thread(gpio_sampler);
+		sampler_thread.detach();
+		sampler_running = true;
+	}
+	sampler_kicked = true;
+	gpio_clock_notify(sampler_cond);
+	if (listener->fast_period_ns.load(std::memory_order_relaxed))
+		gpio_listener_fast_kick(listener);
+}
+
+/*
+ * Fast mode: a thread of the listener's own samples its pin every
+ * fast_period_ns, which the shared sampler cannot wake up for. As the
+ * output thread does, it sleeps until the wake-up jitter before each
+ * sample and spins the rest, then samples under the pass lock like a
+ * sampler pass. Between the frames of a decoder, once the pin had no edge
+ * for fast_quiet_ns, it samples every fast_idle_ns instead, only sleeping,
+ * and speeds up again at the next edge. While the listener is stopped, or its port or the clock
+ * is virtual, it only waits to be kicked: virtual changes are delivered
+ * by gpio_sampler_feed(). Callbacks are called in a read section of the
+ * registry, so a listener destroyed from one outlives them.
+ */
+static void gpio_listener_fast_sampler(gpio_listener_h listener) {
+	gpio_port_e port = (gpio_port_e)GET_PORT(listener->pin);
+	uint32_t bit = 1 << GET_OFFSET(listener->pin);
+	uint64_t next = gpio_clock_now_ns();
+	uint64_t edge = next; //time of the last edge seen
+	uint32_t level = 0;
+	gpio_clock_enter();
+
+	std::unique_lock<std::mutex> lock(listener->fast_lock);
+	while (listener->fast_running) {
+		uint64_t now = gpio_clock_now_ns();
+		uint64_t period = listener->fast_period_ns.load(std::memory_order_relaxed);
+		uint64_t idle = listener->fast_idle_ns.load(std::memory_order_relaxed);
+		uint64_t early = gpio_calibration.wakeup_jitter_ns;
+		uint32_t snapshot;
+		bool sampled = false;
+
+		if (!listener->active || gpio_clock_is_virtual() || virtual_port_attached(port)) {
+			gpio_clock_wait_until(lock, listener->fast_cond, now + GPIO_SAMPLER_IDLE_NS);
+			next = edge = gpio_clock_now_ns();
+			continue;
+		}
+		if (idle && now - edge >= listener->fast_quiet_ns.load(std::memory_order_relaxed)) {
+			/* fast_idle_ns leaves room for the wake-up jitter */
+			if (now < next) {
+				gpio_clock_wait_until(lock, listener->fast_cond, next);
+				continue;
+			}
+			period = idle;
+			next = now + idle;
+		} else {
+			if (now + early < next) {
+				gpio_clock_wait_until(lock, listener->fast_cond, next - early);
+				continue;
+			}
+			while (now < next)
+				now = gpio_clock_now_ns();
+
+			/* Samples missed by a late wake-up are skipped, not taken in a burst */
+			next = now - next > period ? now + period : next + period;
+		}
+
+		lock.unlock();
+		sampler_pass_lock.lock();
+		gpio_registry_read_lock();
+		/* Fast mode may have been left, or the listener stopped, while waiting for the pass */
+		if (listener->active && listener->fast_period_ns.load(std::memory_order_relaxed) &&
+				get_port_value(port, &snapshot) == 0) {
+			gpio_listener_sample(listener, snapshot, now, gpio_clock_timestamp_ms(), period);
+			sampled = true;
+		}
+		gpio_registry_read_unlock();
+		sampler_pass_lock.unlock();
+		lock.lock();
+
+		if (sampled && ((snapshot & bit) != level)) {
+			edge = now;
+			next = std::min(next, now + listener->fast_period_ns.load(std::memory_order_relaxed));
+			level = snapshot & bit;
+		}
+	}
+	listener->fast_exited = true;
+}
+
+/*
+ * Puts @listener in fast mode at the shortest period it was asked for, by
+ * gpio_listener_set_fast_sampling() or by @decoder, or back to the shared
+ * sampler if none; called with fast_mode_lock held. A decoder's period is
+ * only kept between frames when the thread can sleep through them.
+ */
+static int gpio_listener_update_fast(gpio_listener_h listener, const struct gpio_decoder_s *decoder) {
+	uint64_t period = (uint64_t)listener->fast_period_us * GPIO_NS_PER_US;
+	uint64_t idle = 0;
+
+	if (decoder && (!period || gpio_decoder_period_ns(decoder) < period)) {
+		uint64_t lateness = gpio_decoder_lateness_ns(decoder);
+		uint64_t early = gpio_calibration.wakeup_jitter_ns;
+
+		if (lateness > early + GPIO_SLEEP_MIN_NS)
+			idle = period ? std::min(period, lateness - early) : lateness - early;
+		period = gpio_decoder_period_ns(decoder);
+		if (idle <= period)
+			idle = 0;
+		listener->fast_quiet_ns = gpio_decoder_quiet_ns(decoder);
+	}
+	listener->fast_idle_ns = idle;
+
+	if (period) {
+		listener->fast_period_ns = period;
+		{
+			std::lock_guard<std::mutex> lock(listener->fast_lock);
+
+			/* A thread stopped from a callback carries on, unless it already left its loop */
+			if (listener->fast_thread.joinable() && !listener->fast_exited) {
+				listener->fast_running = true;
+				return GPIO_ERROR_NONE;
+			}
+		}
+		if (listener->fast_thread.joinable())
+			listener->fast_thread.join();
+
+		listener->fast_running = true;
+		listener->fast_exited = false;
+		gpio_clock_hold();
+		try {
+			listener->fast_thread = std::thread(gpio_listener_fast_sampler, listener);
+		} catch (...) {
+			gpio_clock_release();
+			listener->fast_running = false;
+			listener->fast_period_ns = 0;
+			return GPIO_ERROR_IO_ERROR;
 		}
-		listener->data = (gpio_value_e)value;
-		if (prev_value != listener->data && listener->callback) {
-			gpio_event_s *event = new gpio_event_s;
-			event->timestamp = 
-				std::chrono::duration_cast<std::chrono::milliseconds>(
-					std::chrono::system_clock::now().time_since_epoch()).count();
-			event->value = listener->data;
-			gpio_event_cb
-			(*listener->callback)(
-					listener->gpio,
-					event,
-					listener->user_data);
-			delete event;
+		return GPIO_ERROR_NONE;
+	}
+
+	if (listener->fast_thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(listener->fast_lock);
+
+			listener->fast_running = false;
+			gpio_clock_notify(listener->fast_cond);
 		}
+		/*
+		 * From a callback, the thread is either the caller or waiting for
+		 * the pass lock the caller holds: it is left to exit on its own,
+		 * and joined when restarted or by the registry before deletion.
+		 */
+		if (!gpio_registry_in_read_section() && listener->fast_thread.get_id() != std::this_thread::get_id())
+			listener->fast_thread.join();
+	}
+	listener->fast_period_ns = 0;
+
+	/* The shared sampler skipped the listener, and may be idling */
+	if (listener->active)
+		gpio_sampler_schedule(listener);
+	return GPIO_ERROR_NONE;
+}
+
+bool gpio_listener_reap(gpio_listener_h listener) {
+	{
+		std::lock_guard<std::mutex> lock(listener->fast_lock);
+
+		if (listener->fast_thread.joinable() && !listener->fast_exited)
+			return false;
 	}
+	if (listener->fast_thread.joinable())
+		listener->fast_thread.join();
+	return true;
 }
 
 //finished
 static int gpio_connect(gpio_h gpio, gpio_listener_h listener)
 {
 	gpio_pin_e pin = (gpio_pin_e)gpio->pin;
-	int id = pin;
 
 	if (!listener)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	_D("called gpio_connect : listener[0x%x], gpio[0x%x]", listener, gpio);
 
-	if (listener_map.find(pin) != listener_map.end() && listener_map[pin]) {
-		_D("Listener associated with pin %d is destroyed\n", pin);
-		gpio_destroy_listener(listener_map[pin]);
-	}
-
-	listener_map[pin] = listener;
-	listener->id = id;
+	listener->id = listener_count++;
 	listener->pin = pin;
 	listener->direction = gpio->direction;
 
-	_D("success gpio_connect: id[%d]", id);
+	if (gpio_registry_add(listener) != GPIO_ERROR_NONE)
+		return GPIO_ERROR_OUT_OF_MEMORY;
 
-	return id;
+	_D("success gpio_connect: id[%d]", listener->id);
+
+	return listener->id;
 }
 
 int gpio_is_supported(gpio_pin_e pin, bool *supported)
@@ -236,15 +774,14 @@ int gpio_is_supported(gpio_pin_e pin, bool *supported)
 //finished
 int gpio_get_default_gpio(gpio_pin_e pin, gpio_h *gpio, gpio_direction_e direction)
 {
-	if (!gpio_isinit) init_gpio();
 	gpio_t *_gpio;
 	
 	_D("called gpio_get_default_gpio : pin[%d], gpio[0x%x]", pin, gpio);
 
-	if (set_pin_mode(pin, direction) != 0)
-		return GPIO_ERROR_INVALID_PARAMETER;
 	if(!gpio)
 		return GPIO_ERROR_INVALID_PARAMETER;
+	if (set_pin_mode(pin, direction) != 0)
+		return GPIO_ERROR_IO_ERROR;
 
 	_gpio = new(std::nothrow) gpio_t;
 
@@ -265,6 +802,28 @@ int gpio_get_gpio_list(gpio_pin_e pin, gpio_h **list, int *gpio_count)
 	return GPIO_ERROR_NOT_SUPPORTED;
 }
 
+int gpio_get_min_interval(gpio_h gpio, int *min_interval)
+{
+	if (!gpio || !min_interval)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*min_interval = gpio_min_interval();
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_get_max_batch_count(gpio_h gpio, int *max_batch_count)
+{
+	if (!gpio || !max_batch_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* Samples of the gpio that can be taken within the shortest interval */
+	*max_batch_count = gpio_calibration.read_ns ?
+		(uint64_t)gpio_min_interval() * GPIO_NS_PER_MS / gpio_calibration.read_ns : 0;
+
+	return GPIO_ERROR_NONE;
+}
+
 int gpio_is_wake_up(gpio_h gpio, bool *wakeup)
 {
 	return GPIO_ERROR_NONE;
@@ -286,6 +845,24 @@ int gpio_create_listener(gpio_h gpio, gpio_listener_h *listener)
 	if (!_listener)
 		return GPIO_ERROR_OUT_OF_MEMORY;
 
+	_listener->gpio = gpio;
+	_listener->active = false;
+	_listener->callback = NULL;
+	_listener->user_data = NULL;
+	_listener->edge = GPIO_EDGE_BOTH;
+	_listener->pause = GPIO_PAUSE_ALL;
+	_listener->batch_latency = GPIO_BATCH_LATENCY_DEFAULT;
+	_listener->adaptive = false;
+	_listener->decoder = NULL;
+	_listener->frame_callback = NULL;
+	_listener->frame_user_data = NULL;
+	_listener->fast_period_us = 0;
+	_listener->fast_period_ns = 0;
+	_listener->fast_idle_ns = 0;
+	_listener->fast_quiet_ns = 0;
+	_listener->fast_running = false;
+	_listener->fast_exited = false;
+
 	error = gpio_connect(gpio, _listener);
 
 	if (error < 0) {
@@ -293,9 +870,6 @@ int gpio_create_listener(gpio_h gpio, gpio_listener_h *listener)
 		return GPIO_ERROR_IO_ERROR;
 	}
 
-	_listener->gpio = gpio;
-	_listener->pause = GPIO_PAUSE_ALL;
-	_listener->batch_latency = GPIO_BATCH_LATENCY_DEFAULT;
 	_listener->magic = GPIO_LISTENER_MAGIC;
 
 	*listener = (gpio_listener_h) _listener;
@@ -316,16 +890,13 @@ int gpio_destroy_listener(gpio_listener_h listener)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	gpio_listener_stop(listener);
-	//wait for batch latency+10ms for thread to finish
-	//TODO: replace this with safer code e.g. using conditional variable
-	std::this_thread::sleep_for(
-			std::chrono::nanoseconds((listener->batch_latency+10)*1000*1000));
-	
-	listener_map[listener->pin] = NULL;
+	gpio_listener_set_fast_sampling(listener, 0);
+	gpio_listener_set_decoder(listener, GPIO_DECODER_NONE, 0, NULL, NULL);
 
 	listener->magic = 0;
 
-	delete (struct gpio_listener_s *)listener;
+	/* Deleted by the registry once no dispatch in flight can reach it */
+	gpio_registry_remove(listener);
 
 	_D("success gpio_destroy");
 
@@ -343,9 +914,10 @@ int gpio_listener_start(gpio_listener_h listener)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
 	if (listener->direction == GPIO_IN) {
+		if (get_port_value((gpio_port_e)GET_PORT(listener->pin), &listener->prev) < 0)
+			return GPIO_ERROR_IO_ERROR;
 		listener->active = true;
-		listener->read_thread = new std::thread(gpio_data_listener, listener);
-		listener->read_thread->detach();
+		gpio_sampler_schedule(listener);
 	}
 
 	_D("success gpio_listener_start : pin[%x]", listener->pin);
@@ -363,11 +935,7 @@ int gpio_listener_stop(gpio_listener_h listener)
 	if (listener->magic != GPIO_LISTENER_MAGIC)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
-	if (listener->direction == GPIO_IN) {
-		listener->active = true;
-		listener->read_thread = new std::thread(gpio_data_listener, listener);
-		listener->read_thread->detach();
-	}
+	listener->active = false;
 
 	_D("success gpio_listener_stop");
 
@@ -386,12 +954,31 @@ int gpio_listener_set_event_cb(gpio_listener_h listener,
 	listener->batch_latency = interval;
 	listener->callback = callback;
 	listener->user_data = user_data;
+	if (listener->active)
+		gpio_sampler_schedule(listener);
 
 	_D("success gpio_listener_set_event");
 
 	return GPIO_ERROR_NONE;
 }
 
+int gpio_listener_set_edge(gpio_listener_h listener, gpio_edge_e edge)
+{
+	_D("called gpio_listener_set_edge : listener[0x%x], edge[%d]", listener, edge);
+
+	if (!listener || (edge & ~(GPIO_EDGE_BOTH | GPIO_EDGE_LEVEL_HIGH | GPIO_EDGE_LEVEL_LOW)))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	listener->edge = edge;
+
+	_D("success gpio_listener_set_edge");
+
+	return GPIO_ERROR_NONE;
+}
+
 int gpio_listener_unset_event_cb(gpio_listener_h listener)
 {
 	_D("called gpio_unregister_event : listener[0x%x]", listener);
@@ -420,13 +1007,173 @@ int gpio_listener_set_interval(gpio_listener_h listener, unsigned int interval)
 	if (listener->magic != GPIO_LISTENER_MAGIC)
 		return GPIO_ERROR_INVALID_PARAMETER;
 
-	listener->batch_latency = interval;
+	/* Read together by sampler passes */
+	{
+		std::lock_guard<std::recursive_mutex> pass(sampler_pass_lock);
+
+		listener->adaptive = false;
+		listener->batch_latency = interval;
+	}
+	if (listener->active)
+		gpio_sampler_schedule(listener);
 
 	_D("success gpio_set_interval");
 
 	return GPIO_ERROR_NONE;
 }
 
+int gpio_listener_set_adaptive_interval(gpio_listener_h listener, unsigned int fast_interval,
+		unsigned int min_interval, unsigned int max_interval)
+{
+	unsigned int interval_min, interval_max;
+
+	_D("called gpio_listener_set_adaptive_interval : listener[0x%x], interval[%d, %d..%d]",
+			listener, fast_interval, min_interval, max_interval);
+
+	if (!listener || min_interval > max_interval)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	interval_min = gpio_clamp_interval(min_interval);
+	interval_max = gpio_clamp_interval(max_interval);
+
+	/* Read together by sampler passes */
+	{
+		std::lock_guard<std::recursive_mutex> pass(sampler_pass_lock);
+
+		listener->interval_max = interval_max;
+		listener->interval_fast = fast_interval < interval_min ? interval_min :
+			fast_interval > interval_max ? interval_max : fast_interval;
+		listener->adaptive = true;
+	}
+	if (listener->active)
+		gpio_sampler_schedule(listener);
+
+	_D("success gpio_listener_set_adaptive_interval");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_listener_set_fast_sampling(gpio_listener_h listener, unsigned int period_us)
+{
+	unsigned int previous;
+	int error;
+
+	_D("called gpio_listener_set_fast_sampling : listener[0x%x], period[%u us]", listener, period_us);
+
+	if (!listener || (period_us && (period_us < GPIO_FAST_PERIOD_MIN_US || period_us > GPIO_FAST_PERIOD_MAX_US)))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> fast(fast_mode_lock);
+
+	previous = listener->fast_period_us;
+	listener->fast_period_us = period_us;
+	error = gpio_listener_update_fast(listener, listener->decoder);
+	if (error != GPIO_ERROR_NONE) {
+		listener->fast_period_us = previous;
+		return error;
+	}
+
+	_D("success gpio_listener_set_fast_sampling : period[%llu ns]", (unsigned long long)listener->fast_period_ns.load());
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_listener_set_decoder(gpio_listener_h listener, gpio_decoder_e decoder, unsigned int param,
+		gpio_frame_cb callback, void *user_data)
+{
+	struct gpio_decoder_s *_decoder = NULL;
+	int error;
+
+	_D("called gpio_listener_set_decoder : listener[0x%x], decoder[%d], param[%u]", listener, decoder, param);
+
+	if (!listener || (decoder != GPIO_DECODER_NONE && !callback))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (decoder < GPIO_DECODER_NONE || decoder > GPIO_DECODER_UART || (decoder == GPIO_DECODER_UART && (!param || param > GPIO_NS_PER_MS * 1000)))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> fast(fast_mode_lock);
+
+	if (decoder != GPIO_DECODER_NONE) {
+		_decoder = gpio_decoder_create(decoder, param);
+		if (!_decoder)
+			return GPIO_ERROR_OUT_OF_MEMORY;
+
+		/* Even fast mode cannot time pulses that short */
+		if (gpio_decoder_period_ns(_decoder) < GPIO_FAST_PERIOD_MIN_US * GPIO_NS_PER_US) {
+			gpio_decoder_destroy(_decoder);
+			return GPIO_ERROR_NOT_SUPPORTED;
+		}
+	}
+
+	/* The pin is sampled as fast as the new decoder needs before it gets any sample */
+	error = gpio_listener_update_fast(listener, _decoder);
+	if (error != GPIO_ERROR_NONE) {
+		gpio_decoder_destroy(_decoder);
+		return error;
+	}
+
+	/* No sampler pass is in flight once the lock is held, so the old decoder can go */
+	{
+		std::lock_guard<std::recursive_mutex> pass(sampler_pass_lock);
+
+		std::swap(listener->decoder, _decoder);
+		listener->frame_callback = callback;
+		listener->frame_user_data = user_data;
+	}
+	gpio_decoder_destroy(_decoder);
+
+	_D("success gpio_listener_set_decoder");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_listener_set_measurement(gpio_listener_h listener, unsigned int window)
+{
+	_D("called gpio_listener_set_measurement : listener[0x%x], window[%u]", listener, window);
+
+	if (!listener)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* No sampler pass is in flight once the lock is held, so the rings can be replaced */
+	{
+		std::lock_guard<std::recursive_mutex> pass(sampler_pass_lock);
+
+		if (gpio_measure_set_window(&listener->measure, window) < 0)
+			return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	_D("success gpio_listener_set_measurement");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_listener_get_measurement(gpio_listener_h listener, gpio_measurement_s *measurement)
+{
+	if (!listener || !measurement)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_measure_get(&listener->measure, measurement) < 0)
+		return GPIO_ERROR_NO_DATA;
+
+	return GPIO_ERROR_NONE;
+}
+
 int gpio_listener_set_max_batch_latency(gpio_listener_h listener, unsigned int max_batch_latency)
 {
 	return gpio_listener_set_interval(listener, max_batch_latency);
@@ -455,14 +1202,48 @@ int gpio_listener_read_data(gpio_listener_h listener, gpio_event_s *event)
 	if ((value = get_pin_value(listener->pin)) < 0)
 		return GPIO_ERROR_IO_ERROR;
 	event->value = (gpio_value_e)value;
-	event->timestamp =
-		std::chrono::duration_cast<std::chrono::milliseconds>(
-			std::chrono::system_clock::now().time_since_epoch()).count();
+	event->timestamp = gpio_clock_timestamp_ms();
 	_D("success gpio_read_data");
 
 	return GPIO_ERROR_NONE;
 }
 
+int gpio_listener_get_fd(gpio_listener_h listener, int *fd)
+{
+	int _fd;
+
+	_D("called gpio_listener_get_fd : listener[0x%x]", listener);
+
+	if (!listener || !fd)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	_fd = gpio_event_queue_open(&listener->queue);
+	if (_fd < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	*fd = _fd;
+
+	_D("success gpio_listener_get_fd : fd[%d]", _fd);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_listener_drain(gpio_listener_h listener, gpio_event_s *events, unsigned int max_count, unsigned int *count)
+{
+	if (!listener || !events || !count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (listener->magic != GPIO_LISTENER_MAGIC || !gpio_event_queue_active(&listener->queue))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*count = gpio_event_queue_drain(&listener->queue, events, max_count);
+
+	return GPIO_ERROR_NONE;
+}
+
 const char * __gpio_get_name(gpio_pin_e pin) {
 	switch(pin) {
 		case GPX0_0: return "GPX0_0";
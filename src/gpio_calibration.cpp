@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <chrono>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+/* The measured values are cached here across runs, if set */
+#define GPIO_CALIBRATION_FILE_ENV "GPIO_CALIBRATION_FILE"
+
+#define GPIO_CALIBRATION_PORT GPX1
+#define GPIO_CALIBRATION_DRIVE_OFFSET 3 //drive strength register, in words after the config register
+#define GPIO_CALIBRATION_ACCESSES 4096
+#define GPIO_CALIBRATION_SLEEPS 16
+#define GPIO_CALIBRATION_SLEEP_NS 1000000
+
+struct gpio_calibration_s gpio_calibration;
+
+static uint32_t calibration_average(uint64_t start, uint64_t end, int count)
+{
+	return (uint32_t)((end - start + count - 1) / count);
+}
+
+static bool calibration_load(const char *path)
+{
+	struct gpio_calibration_s cached;
+	FILE *fp = fopen(path, "r");
+	int ret;
+
+	if (!fp)
+		return false;
+
+	ret = fscanf(fp, "read_ns=%u\nwrite_ns=%u\nclock_ns=%u\nwakeup_jitter_ns=%u\n",
+			&cached.read_ns, &cached.write_ns, &cached.clock_ns, &cached.wakeup_jitter_ns);
+	fclose(fp);
+
+	if (ret != 4 || !cached.read_ns) {
+		_W("Ignoring malformed calibration file %s", path);
+		return false;
+	}
+
+	cached.ipc_ns = 0;
+	gpio_calibration = cached;
+	return true;
+}
+
+static void calibration_store(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+
+	if (!fp) {
+		_W("Cannot write calibration file %s", path);
+		return;
+	}
+
+	fprintf(fp, "read_ns=%u\nwrite_ns=%u\nclock_ns=%u\nwakeup_jitter_ns=%u\n",
+			gpio_calibration.read_ns, gpio_calibration.write_ns,
+			gpio_calibration.clock_ns, gpio_calibration.wakeup_jitter_ns);
+	fclose(fp);
+}
+
+static void calibration_measure(void)
+{
+	volatile uint32_t *drive = gpio_port_config(GPIO_CALIBRATION_PORT) + GPIO_CALIBRATION_DRIVE_OFFSET;
+	uint32_t value = 0, worst = 0;
+	uint64_t start, end;
+	int i;
+
+	start = gpio_steady_now_ns();
+	for (i = 0; i < GPIO_CALIBRATION_ACCESSES; i++)
+		gpio_port_read(GPIO_CALIBRATION_PORT, &value);
+	end = gpio_steady_now_ns();
+	gpio_calibration.read_ns = calibration_average(start, end, GPIO_CALIBRATION_ACCESSES);
+
+	/*
+	 * Writing back a value of the data register read once would revert
+	 * output changes made meanwhile by the service, another process or
+	 * thread. Writes are timed on the drive strength register instead,
+	 * with the value it holds: nothing here writes it, and rewriting it
+	 * does not change the pins.
+	 */
+	value = *drive;
+	start = gpio_steady_now_ns();
+	for (i = 0; i < GPIO_CALIBRATION_ACCESSES; i++)
+		*drive = value;
+	end = gpio_steady_now_ns();
+	gpio_calibration.write_ns = calibration_average(start, end, GPIO_CALIBRATION_ACCESSES);
+
+	start = gpio_steady_now_ns();
+	for (i = 0; i < GPIO_CALIBRATION_ACCESSES; i++)
+		gpio_steady_now_ns();
+	end = gpio_steady_now_ns();
+	gpio_calibration.clock_ns = calibration_average(start, end, GPIO_CALIBRATION_ACCESSES);
+
+	for (i = 0; i < GPIO_CALIBRATION_SLEEPS; i++) {
+		uint64_t late;
+
+		start = gpio_steady_now_ns();
+		std::this_thread::sleep_for(std::chrono::nanoseconds(GPIO_CALIBRATION_SLEEP_NS));
+		end = gpio_steady_now_ns();
+		late = end - start - GPIO_CALIBRATION_SLEEP_NS;
+		if (end - start > GPIO_CALIBRATION_SLEEP_NS && late > worst)
+			worst = (uint32_t)late;
+	}
+	gpio_calibration.wakeup_jitter_ns = worst;
+	gpio_calibration.ipc_ns = 0;
+}
+
+void gpio_calibrate(void)
+{
+	const char *path = getenv(GPIO_CALIBRATION_FILE_ENV);
+
+	if (path && calibration_load(path)) {
+		_D("calibration loaded from %s", path);
+		return;
+	}
+
+	calibration_measure();
+	if (path)
+		calibration_store(path);
+
+	_D("calibration: read %u ns, write %u ns, clock %u ns, wakeup jitter %u ns",
+			gpio_calibration.read_ns, gpio_calibration.write_ns,
+			gpio_calibration.clock_ns, gpio_calibration.wakeup_jitter_ns);
+}
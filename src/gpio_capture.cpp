@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <new>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_capture.h"
+#include "gpio_log.h"
+
+void gpio_capture_pack(struct gpio_capture_s *capture, uint64_t *planes, size_t stride, size_t word)
+{
+	for (int p = 0; p < capture->port_count; p++) {
+		const uint8_t *staged = capture->staging + p * GPIO_CAPTURE_WORD_BITS;
+		uint64_t packed[GPIO_CAPTURE_PORT_PINS] = { 0 };
+
+		/* Each group of 8 samples transposes into 8 samples of each pin */
+		for (int g = 0; g < GPIO_CAPTURE_WORD_BITS / 8; g++) {
+			uint64_t rows;
+
+			memcpy(&rows, staged + g * 8, sizeof(rows));
+			rows = gpio_capture_transpose8(rows);
+			for (int pin = 0; pin < GPIO_CAPTURE_PORT_PINS; pin++)
+				packed[pin] |= ((rows >> (pin * 8)) & 0xff) << (g * 8);
+		}
+
+		for (int pin = 0; pin < GPIO_CAPTURE_PORT_PINS; pin++)
+			planes[(p * GPIO_CAPTURE_PORT_PINS + pin) * stride + word] = packed[pin];
+	}
+}
+
+/* Stores the staged samples as word @word of the capture, @word counting from the start */
+static void capture_store(struct gpio_capture_s *capture, uint64_t word)
+{
+	if (capture->stream)
+		gpio_capture_stream_store(capture, word);
+	else
+		gpio_capture_pack(capture, capture->words, capture->word_count, word % capture->word_count);
+}
+
+static void capture_sampler(struct gpio_capture_s *capture)
+{
+	const struct gpio_capture_trigger_s trigger = capture->trigger;
+	uint64_t stop_at = trigger.armed || capture->stream ? UINT64_MAX : capture->capacity;
+	uint64_t next = gpio_steady_now_ns();
+	uint8_t prev = trigger.armed ? (uint8_t)*capture->data[trigger.port_index] : 0;
+
+	while (capture->running.load(std::memory_order_relaxed) && capture->taken < stop_at) {
+		unsigned int slot = capture->taken % GPIO_CAPTURE_WORD_BITS;
+		uint64_t now;
+
+		now = gpio_steady_wait_until(next);
+		if (now - next > capture->period_ns)
+			capture->late++;
+
+		for (int p = 0; p < capture->port_count; p++)
+			capture->staging[p * GPIO_CAPTURE_WORD_BITS + slot] = (uint8_t)*capture->data[p];
+
+		if (trigger.armed && !capture->triggered.load(std::memory_order_relaxed)) {
+			uint8_t cur = capture->staging[trigger.port_index * GPIO_CAPTURE_WORD_BITS + slot];
+
+			if (gpio_capture_trigger_hit(&trigger, prev, cur)) {
+				capture->trigger_at = capture->taken;
+				stop_at = capture->taken + capture->post_count + 1;
+				capture->triggered.store(true, std::memory_order_release);
+			}
+			prev = cur;
+		}
+
+		next += capture->period_ns;
+		if (++slot < GPIO_CAPTURE_WORD_BITS) {
+			capture->taken++;
+			continue;
+		}
+
+		/* taken counts the samples of the word before it is stored, as for a partial one below */
+		capture->taken++;
+		capture_store(capture, (capture->taken - 1) / GPIO_CAPTURE_WORD_BITS);
+		capture->committed.store(capture->taken, std::memory_order_release);
+	}
+
+	/* Zero the rest of a partial block, so its unused bits read as 0 */
+	if (capture->taken % GPIO_CAPTURE_WORD_BITS) {
+		for (int p = 0; p < capture->port_count; p++) {
+			unsigned int used = capture->taken % GPIO_CAPTURE_WORD_BITS;
+			memset(capture->staging + p * GPIO_CAPTURE_WORD_BITS + used, 0, GPIO_CAPTURE_WORD_BITS - used);
+		}
+		capture_store(capture, capture->taken / GPIO_CAPTURE_WORD_BITS);
+		capture->committed.store(capture->taken, std::memory_order_release);
+	}
+
+	capture->running = false;
+}
+
+/* Samples [first, last) that can be read, in the numbering of the sampling thread */
+static void capture_window(struct gpio_capture_s *capture, uint64_t *first, uint64_t *last)
+{
+	uint64_t committed = capture->committed.load(std::memory_order_acquire);
+
+	if (capture->triggered.load(std::memory_order_acquire)) {
+		uint64_t start = capture->trigger_at > capture->pre_count ?
+			capture->trigger_at - capture->pre_count : 0;
+		uint64_t end = capture->trigger_at + capture->post_count + 1;
+
+		*first = start;
+		*last = committed < end ? committed : end;
+		return;
+	}
+
+	*first = committed > capture->capacity ? committed - capture->capacity : 0;
+	*last = committed;
+}
+
+int gpio_capture_create(const gpio_port_e *ports, int port_count,
+		unsigned int sample_rate, unsigned int sample_count, gpio_capture_h *capture)
+{
+	struct gpio_capture_s *_capture;
+	size_t words;
+
+	_D("called gpio_capture_create : port_count[%d], sample_rate[%u], sample_count[%u]",
+			port_count, sample_rate, sample_count);
+
+	/* The capacity, sample_count rounded up to whole words, must fit its unsigned int */
+	if (!ports || port_count <= 0 || !sample_rate || sample_rate > GPIO_NS_PER_SEC || !sample_count ||
+			sample_count > UINT_MAX - GPIO_CAPTURE_WORD_BITS || !capture)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* The sampler reads the registers of every port without further checks */
+	for (int p = 0; p < port_count; p++) {
+		if (!gpio_port_valid(ports[p]))
+			return GPIO_ERROR_INVALID_PARAMETER;
+	}
+
+	words = ((size_t)sample_count + GPIO_CAPTURE_WORD_BITS - 1) / GPIO_CAPTURE_WORD_BITS + 1;
+	if ((uint64_t)port_count * GPIO_CAPTURE_PORT_PINS * words > SIZE_MAX / sizeof(uint64_t))
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	if (gpio_port_init() < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_capture = new(std::nothrow) struct gpio_capture_s;
+	if (!_capture)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_capture->port_count = port_count;
+	_capture->period_ns = GPIO_NS_PER_SEC / sample_rate;
+	_capture->word_count = words;
+	_capture->capacity = (_capture->word_count - 1) * GPIO_CAPTURE_WORD_BITS;
+	_capture->trigger.armed = false;
+	_capture->pre_count = _capture->capacity / 2;
+	_capture->post_count = _capture->capacity - _capture->pre_count - 1;
+	_capture->taken = 0;
+	_capture->committed = 0;
+	_capture->triggered = false;
+	_capture->trigger_at = 0;
+	_capture->late = 0;
+	_capture->stream = NULL;
+	_capture->summaries = NULL;
+	_capture->running = false;
+
+	words = (size_t)port_count * GPIO_CAPTURE_PORT_PINS * _capture->word_count;
+	_capture->ports = (gpio_port_e *)malloc(port_count * sizeof(gpio_port_e));
+	_capture->data = (volatile uint32_t **)malloc(port_count * sizeof(volatile uint32_t *));
+	_capture->words = (uint64_t *)calloc(words, sizeof(uint64_t));
+	_capture->staging = (uint8_t *)calloc(port_count, GPIO_CAPTURE_WORD_BITS);
+
+	if (!_capture->ports || !_capture->data || !_capture->words || !_capture->staging) {
+		free(_capture->ports);
+		free(_capture->data);
+		free(_capture->words);
+		free(_capture->staging);
+		delete _capture;
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	for (int p = 0; p < port_count; p++) {
+		_capture->ports[p] = ports[p];
+		_capture->data[p] = gpio_port_data(ports[p]);
+	}
+
+	*capture = _capture;
+
+	_D("success gpio_capture_create : capture[0x%x], %zu words", _capture, words);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_destroy(gpio_capture_h capture)
+{
+	_D("called gpio_capture_destroy : capture[0x%x]", capture);
+
+	if (!capture)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	gpio_capture_stop(capture);
+	gpio_capture_stream_destroy(capture);
+
+	if (capture->summaries) {
+		for (int i = 0; i < capture->port_count * GPIO_CAPTURE_PORT_PINS; i++)
+			gpio_summary_destroy(capture->summaries[i]);
+		free(capture->summaries);
+	}
+
+	free(capture->ports);
+	free((void *)capture->data);
+	free(capture->words);
+	free(capture->staging);
+	delete capture;
+
+	_D("success gpio_capture_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_start(gpio_capture_h capture)
+{
+	_D("called gpio_capture_start : capture[0x%x]", capture);
+
+	if (!capture || capture->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* The previous run may have ended by itself on a full buffer */
+	if (capture->thread.joinable())
+		capture->thread.join();
+
+	capture->taken = 0;
+	capture->committed = 0;
+	capture->triggered = false;
+	capture->late = 0;
+
+	/* Memory captures summarize on demand, once the run is over */
+	if (capture->summaries && !capture->stream) {
+		for (int i = 0; i < capture->port_count * GPIO_CAPTURE_PORT_PINS; i++)
+			gpio_summary_reset(capture->summaries[i]);
+	}
+
+	if (capture->stream && gpio_capture_stream_begin(capture) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	capture->running = true;
+
+	try {
+		capture->thread = std::thread(capture_sampler, capture);
+	} catch (...) {
+		capture->running = false;
+		if (capture->stream)
+			gpio_capture_stream_end(capture);
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	_D("success gpio_capture_start");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_stop(gpio_capture_h capture)
+{
+	_D("called gpio_capture_stop : capture[0x%x]", capture);
+
+	if (!capture)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	capture->running = false;
+	if (capture->thread.joinable())
+		capture->thread.join();
+
+	/* Persists the blocks still queued, the last one partially filled */
+	if (capture->stream)
+		gpio_capture_stream_end(capture);
+
+	_D("success gpio_capture_stop : %llu samples, %llu late",
+			(unsigned long long)capture->committed.load(), (unsigned long long)capture->late);
+
+	return GPIO_ERROR_NONE;
+}
+
+static int capture_port_index(struct gpio_capture_s *capture, gpio_port_e port)
+{
+	for (int p = 0; p < capture->port_count; p++) {
+		if (capture->ports[p] == port)
+			return p;
+	}
+	return -1;
+}
+
+static int capture_set_trigger(struct gpio_capture_s *capture, gpio_port_e port,
+		uint8_t mask, uint8_t value, uint8_t changed)
+{
+	int port_index = capture_port_index(capture, port);
+
+	if (port_index < 0 || capture->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	capture->trigger.armed = true;
+	capture->trigger.port_index = port_index;
+	capture->trigger.mask = mask;
+	capture->trigger.value = value & mask;
+	capture->trigger.changed = changed;
+	capture->trigger.always = changed ? 0 : 0xff;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_set_trigger_edge(gpio_capture_h capture, gpio_pin_e pin, gpio_edge_e edge)
+{
+	uint8_t bit = 1 << (pin & 7);
+
+	_D("called gpio_capture_set_trigger_edge : capture[0x%x], pin[%d], edge[%d]", capture, pin, edge);
+
+	if (!capture || capture->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	switch (edge) {
+	case GPIO_EDGE_NONE:
+		capture->trigger.armed = false;
+		return GPIO_ERROR_NONE;
+	case GPIO_EDGE_RISING:
+		return capture_set_trigger(capture, (gpio_port_e)(pin >> 3), bit, bit, bit);
+	case GPIO_EDGE_FALLING:
+		return capture_set_trigger(capture, (gpio_port_e)(pin >> 3), bit, 0, bit);
+	case GPIO_EDGE_BOTH:
+		return capture_set_trigger(capture, (gpio_port_e)(pin >> 3), 0, 0, bit);
+	default:
+		return GPIO_ERROR_INVALID_PARAMETER;
+	}
+}
+
+int gpio_capture_set_trigger_pattern(gpio_capture_h capture, gpio_port_e port,
+		uint8_t mask, uint8_t pattern)
+{
+	_D("called gpio_capture_set_trigger_pattern : capture[0x%x], port[0x%x], mask[0x%x], pattern[0x%x]",
+			capture, port, mask, pattern);
+
+	if (!capture)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	return capture_set_trigger(capture, port, mask, pattern, 0);
+}
+
+int gpio_capture_set_trigger_window(gpio_capture_h capture,
+		unsigned int pre_count, unsigned int post_count)
+{
+	_D("called gpio_capture_set_trigger_window : capture[0x%x], pre[%u], post[%u]",
+			capture, pre_count, post_count);
+
+	if (!capture || capture->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* The trigger sample itself is kept too */
+	if ((uint64_t)pre_count + post_count + 1 > capture->capacity)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	capture->pre_count = pre_count;
+	capture->post_count = post_count;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_get_trigger(gpio_capture_h capture, bool *triggered, unsigned int *trigger_index)
+{
+	uint64_t first, last;
+
+	if (!capture || !triggered || !trigger_index)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*triggered = capture->triggered.load(std::memory_order_acquire);
+	if (!*triggered)
+		return GPIO_ERROR_NONE;
+
+	capture_window(capture, &first, &last);
+	*trigger_index = capture->trigger_at - first;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_read(gpio_capture_h capture, gpio_pin_e pin,
+		uint64_t *words, unsigned int word_count, unsigned int *sample_count)
+{
+	const uint64_t *plane;
+	uint64_t first, last, count;
+	int port_index;
+
+	if (!capture || !words || !sample_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	port_index = capture_port_index(capture, (gpio_port_e)(pin >> 3));
+	if (port_index < 0)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* Streamed samples are only on disk */
+	if (capture->stream) {
+		*sample_count = 0;
+		return GPIO_ERROR_NONE;
+	}
+
+	capture_window(capture, &first, &last);
+	count = last - first;
+	if (count > (uint64_t)word_count * GPIO_CAPTURE_WORD_BITS)
+		count = (uint64_t)word_count * GPIO_CAPTURE_WORD_BITS;
+
+	/* Realigns the ring so the first sample of the window lands in bit 0 */
+	plane = gpio_capture_plane(capture, port_index, pin & 7);
+	for (uint64_t i = 0; i * GPIO_CAPTURE_WORD_BITS < count; i++) {
+		uint64_t bit = first + i * GPIO_CAPTURE_WORD_BITS;
+		unsigned int word = (bit / GPIO_CAPTURE_WORD_BITS) % capture->word_count;
+		unsigned int shift = bit % GPIO_CAPTURE_WORD_BITS;
+		uint64_t value = plane[word] >> shift;
+		uint64_t left = count - i * GPIO_CAPTURE_WORD_BITS;
+
+		if (shift)
+			value |= plane[(word + 1) % capture->word_count] << (GPIO_CAPTURE_WORD_BITS - shift);
+		if (left < GPIO_CAPTURE_WORD_BITS)
+			value &= (1ULL << left) - 1;
+		words[i] = value;
+	}
+	*sample_count = count;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_summaries_init(struct gpio_capture_s *capture)
+{
+	int plane_count = capture->port_count * GPIO_CAPTURE_PORT_PINS;
+
+	if (capture->summaries)
+		return GPIO_ERROR_NONE;
+
+	capture->summaries = (gpio_summary_h *)calloc(plane_count, sizeof(gpio_summary_h));
+	if (!capture->summaries)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	for (int i = 0; i < plane_count; i++) {
+		if (gpio_summary_create(&capture->summaries[i]) != GPIO_ERROR_NONE) {
+			for (int j = 0; j < i; j++)
+				gpio_summary_destroy(capture->summaries[j]);
+			free(capture->summaries);
+			capture->summaries = NULL;
+			return GPIO_ERROR_OUT_OF_MEMORY;
+		}
+	}
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_get_summary(gpio_capture_h capture, gpio_pin_e pin, gpio_summary_h *summary)
+{
+	gpio_summary_h _summary;
+	unsigned long long summarized;
+	unsigned int sample_count;
+	uint64_t *words;
+	int port_index;
+	int ret;
+
+	_D("called gpio_capture_get_summary : capture[0x%x], pin[%d]", capture, pin);
+
+	if (!capture || !summary)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	port_index = capture_port_index(capture, (gpio_port_e)(pin >> 3));
+	if (port_index < 0)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	ret = gpio_capture_summaries_init(capture);
+	if (ret)
+		return ret;
+
+	_summary = capture->summaries[port_index * GPIO_CAPTURE_PORT_PINS + (pin & 7)];
+
+	/* A stream writer extends its summaries as it goes, a memory capture is summarized once stopped */
+	if (!capture->stream) {
+		if (capture->running)
+			return GPIO_ERROR_INVALID_PARAMETER;
+
+		gpio_summary_get_sample_count(_summary, &summarized);
+		if (!summarized) {
+			words = (uint64_t *)malloc((size_t)capture->word_count * sizeof(uint64_t));
+			if (!words)
+				return GPIO_ERROR_OUT_OF_MEMORY;
+
+			gpio_capture_read(capture, pin, words, capture->word_count, &sample_count);
+			ret = gpio_summary_append(_summary, words, sample_count);
+			free(words);
+			if (ret)
+				return ret;
+		}
+	}
+
+	*summary = _summary;
+
+	_D("success gpio_capture_get_summary : summary[0x%x]", _summary);
+
+	return GPIO_ERROR_NONE;
+}
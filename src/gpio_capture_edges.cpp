@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GPIO_EDGE_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GPIO_EDGE_NEON 1
+#endif
+
+#include "gpio.h"
+#include "gpio_capture.h"
+#include "gpio_log.h"
+
+/*
+ * Edge kernels over pin planes. Sample i is compared with sample i-1, so
+ * word w is XORed with itself shifted left by one, the top bit of word
+ * w-1 shifted in. The vector kernels load words w and w-1 unaligned,
+ * which keeps every lane independent and the loop free of carries.
+ * Sample 0 has no predecessor: it is compared with itself.
+ */
+
+static inline void count_word(uint64_t word, uint64_t edges, struct gpio_capture_edge_counts_s *counts)
+{
+	counts->rising += __builtin_popcountll(edges & word);
+	counts->falling += __builtin_popcountll(edges & ~word);
+	counts->high += __builtin_popcountll(word);
+}
+
+static void count_scalar(const uint64_t *words, size_t word_count, struct gpio_capture_edge_counts_s *counts)
+{
+	for (size_t w = 0; w < word_count; w++)
+		count_word(words[w], gpio_capture_edge_word(words, w), counts);
+}
+
+static size_t scan_scalar(const uint64_t *words, size_t from, size_t word_count)
+{
+	for (size_t w = from; w < word_count; w++) {
+		if (gpio_capture_edge_word(words, w))
+			return w;
+	}
+	return word_count;
+}
+
+const struct gpio_capture_edge_ops_s gpio_capture_edge_scalar = {
+	"scalar",
+	count_scalar,
+	scan_scalar,
+};
+
+#ifdef GPIO_EDGE_X86
+
+/* Per 64-bit lane population counts, by nibble lookup */
+__attribute__((target("ssse3")))
+static inline __m128i popcount_ssse3(__m128i v)
+{
+	const __m128i lookup = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m128i low = _mm_set1_epi8(0x0f);
+	__m128i count = _mm_add_epi8(_mm_shuffle_epi8(lookup, _mm_and_si128(v, low)),
+			_mm_shuffle_epi8(lookup, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+
+	return _mm_sad_epu8(count, _mm_setzero_si128());
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i edges_ssse3(const uint64_t *words, size_t w, __m128i *word)
+{
+	__m128i prev = _mm_loadu_si128((const __m128i *)(words + w - 1));
+
+	*word = _mm_loadu_si128((const __m128i *)(words + w));
+	return _mm_xor_si128(*word, _mm_or_si128(_mm_slli_epi64(*word, 1), _mm_srli_epi64(prev, 63)));
+}
+
+__attribute__((target("ssse3")))
+static void count_ssse3(const uint64_t *words, size_t word_count, struct gpio_capture_edge_counts_s *counts)
+{
+	__m128i rising = _mm_setzero_si128();
+	__m128i falling = _mm_setzero_si128();
+	__m128i high = _mm_setzero_si128();
+	uint64_t sums[2];
+	size_t w = 1;
+
+	if (!word_count)
+		return;
+	count_word(words[0], gpio_capture_edge_word(words, 0), counts);
+
+	for (; w + 2 <= word_count; w += 2) {
+		__m128i word;
+		__m128i edges = edges_ssse3(words, w, &word);
+
+		rising = _mm_add_epi64(rising, popcount_ssse3(_mm_and_si128(edges, word)));
+		falling = _mm_add_epi64(falling, popcount_ssse3(_mm_andnot_si128(word, edges)));
+		high = _mm_add_epi64(high, popcount_ssse3(word));
+	}
+
+	_mm_storeu_si128((__m128i *)sums, rising);
+	counts->rising += sums[0] + sums[1];
+	_mm_storeu_si128((__m128i *)sums, falling);
+	counts->falling += sums[0] + sums[1];
+	_mm_storeu_si128((__m128i *)sums, high);
+	counts->high += sums[0] + sums[1];
+
+	for (; w < word_count; w++)
+		count_word(words[w], gpio_capture_edge_word(words, w), counts);
+}
+
+__attribute__((target("ssse3")))
+static size_t scan_ssse3(const uint64_t *words, size_t from, size_t word_count)
+{
+	size_t w = from;
+
+	if (w == 0 && word_count) {
+		if (gpio_capture_edge_word(words, 0))
+			return 0;
+		w = 1;
+	}
+	for (; w + 2 <= word_count; w += 2) {
+		__m128i word;
+		__m128i edges = edges_ssse3(words, w, &word);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(edges, _mm_setzero_si128())) != 0xffff)
+			return gpio_capture_edge_word(words, w) ? w : w + 1;
+	}
+	return scan_scalar(words, w, word_count);
+}
+
+static const struct gpio_capture_edge_ops_s edge_ssse3 = {
+	"ssse3",
+	count_ssse3,
+	scan_ssse3,
+};
+
+__attribute__((target("avx2")))
+static inline __m256i popcount_avx2(__m256i v)
+{
+	const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i count = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low)),
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+
+	return _mm256_sad_epu8(count, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static inline __m256i edges_avx2(const uint64_t *words, size_t w, __m256i *word)
+{
+	__m256i prev = _mm256_loadu_si256((const __m256i *)(words + w - 1));
+
+	*word = _mm256_loadu_si256((const __m256i *)(words + w));
+	return _mm256_xor_si256(*word, _mm256_or_si256(_mm256_slli_epi64(*word, 1), _mm256_srli_epi64(prev, 63)));
+}
+
+__attribute__((target("avx2")))
+static void count_avx2(const uint64_t *words, size_t word_count, struct gpio_capture_edge_counts_s *counts)
+{
+	__m256i rising = _mm256_setzero_si256();
+	__m256i falling = _mm256_setzero_si256();
+	__m256i high = _mm256_setzero_si256();
+	uint64_t sums[4];
+	size_t w = 1;
+
+	if (!word_count)
+		return;
+	count_word(words[0], gpio_capture_edge_word(words, 0), counts);
+
+	for (; w + 4 <= word_count; w += 4) {
+		__m256i word;
+		__m256i edges = edges_avx2(words, w, &word);
+
+		rising = _mm256_add_epi64(rising, popcount_avx2(_mm256_and_si256(edges, word)));
+		falling = _mm256_add_epi64(falling, popcount_avx2(_mm256_andnot_si256(word, edges)));
+		high = _mm256_add_epi64(high, popcount_avx2(word));
+	}
+
+	_mm256_storeu_si256((__m256i *)sums, rising);
+	counts->rising += sums[0] + sums[1] + sums[2] + sums[3];
+	_mm256_storeu_si256((__m256i *)sums, falling);
+	counts->falling += sums[0] + sums[1] + sums[2] + sums[3];
+	_mm256_storeu_si256((__m256i *)sums, high);
+	counts->high += sums[0] + sums[1] + sums[2] + sums[3];
+
+	for (; w < word_count; w++)
+		count_word(words[w], gpio_capture_edge_word(words, w), counts);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const uint64_t *words, size_t from, size_t word_count)
+{
+	size_t w = from;
+
+	if (w == 0 && word_count) {
+		if (gpio_capture_edge_word(words, 0))
+			return 0;
+		w = 1;
+	}
+	for (; w + 4 <= word_count; w += 4) {
+		__m256i word;
+		__m256i edges = edges_avx2(words, w, &word);
+
+		if (!_mm256_testz_si256(edges, edges)) {
+			int zero = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(edges, _mm256_setzero_si256())));
+
+			return w + __builtin_ctz(~zero);
+		}
+	}
+	return scan_scalar(words, w, word_count);
+}
+
+static const struct gpio_capture_edge_ops_s edge_avx2 = {
+	"avx2",
+	count_avx2,
+	scan_avx2,
+};
+
+#endif
+
+#ifdef GPIO_EDGE_NEON
+
+static inline uint64x2_t edges_neon(const uint64_t *words, size_t w, uint64x2_t *word)
+{
+	uint64x2_t prev = vld1q_u64(words + w - 1);
+
+	*word = vld1q_u64(words + w);
+	return veorq_u64(*word, vorrq_u64(vshlq_n_u64(*word, 1), vshrq_n_u64(prev, 63)));
+}
+
+/* Adds the population count of each 64-bit lane of @v to @sum */
+static inline uint64x2_t popcount_add_neon(uint64x2_t sum, uint64x2_t v)
+{
+	return vpadalq_u32(sum, vpaddlq_u16(vpaddlq_u8(vcntq_u8(vreinterpretq_u8_u64(v)))));
+}
+
+static void count_neon(const uint64_t *words, size_t word_count, struct gpio_capture_edge_counts_s *counts)
+{
+	uint64x2_t rising = vdupq_n_u64(0);
+	uint64x2_t falling = vdupq_n_u64(0);
+	uint64x2_t high = vdupq_n_u64(0);
+	size_t w = 1;
+
+	if (!word_count)
+		return;
+	count_word(words[0], gpio_capture_edge_word(words, 0), counts);
+
+	for (; w + 2 <= word_count; w += 2) {
+		uint64x2_t word;
+		uint64x2_t edges = edges_neon(words, w, &word);
+
+		rising = popcount_add_neon(rising, vandq_u64(edges, word));
+		falling = popcount_add_neon(falling, vbicq_u64(edges, word));
+		high = popcount_add_neon(high, word);
+	}
+
+	counts->rising += vgetq_lane_u64(rising, 0) + vgetq_lane_u64(rising, 1);
+	counts->falling += vgetq_lane_u64(falling, 0) + vgetq_lane_u64(falling, 1);
+	counts->high += vgetq_lane_u64(high, 0) + vgetq_lane_u64(high, 1);
+
+	for (; w < word_count; w++)
+		count_word(words[w], gpio_capture_edge_word(words, w), counts);
+}
+
+static size_t scan_neon(const uint64_t *words, size_t from, size_t word_count)
+{
+	size_t w = from;
+
+	if (w == 0 && word_count) {
+		if (gpio_capture_edge_word(words, 0))
+			return 0;
+		w = 1;
+	}
+	for (; w + 2 <= word_count; w += 2) {
+		uint64x2_t word;
+		uint64x2_t edges = edges_neon(words, w, &word);
+
+		if (vgetq_lane_u64(edges, 0) | vgetq_lane_u64(edges, 1))
+			return gpio_capture_edge_word(words, w) ? w : w + 1;
+	}
+	return scan_scalar(words, w, word_count);
+}
+
+static const struct gpio_capture_edge_ops_s edge_neon = {
+	"neon",
+	count_neon,
+	scan_neon,
+};
+
+#endif
+
+static const struct gpio_capture_edge_ops_s *edge_ops_select(void)
+{
+#ifdef GPIO_EDGE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return &edge_avx2;
+	if (__builtin_cpu_supports("ssse3"))
+		return &edge_ssse3;
+#elif defined(GPIO_EDGE_NEON)
+	return &edge_neon;
+#endif
+	return &gpio_capture_edge_scalar;
+}
+
+const struct gpio_capture_edge_ops_s *gpio_capture_edge_ops(void)
+{
+	static const struct gpio_capture_edge_ops_s *ops = edge_ops_select();
+
+	return ops;
+}
+
+int gpio_capture_get_edge_stats(const uint64_t *words, unsigned long long sample_count,
+		gpio_capture_edge_stats_s *stats)
+{
+	struct gpio_capture_edge_counts_s counts = { 0, 0, 0 };
+	size_t full = sample_count / GPIO_CAPTURE_WORD_BITS;
+	unsigned int tail = sample_count % GPIO_CAPTURE_WORD_BITS;
+
+	if (!words || !stats)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	gpio_capture_edge_ops()->count(words, full, &counts);
+
+	/* Bits past the last sample are not part of the capture */
+	if (tail) {
+		uint64_t mask = (1ULL << tail) - 1;
+		uint64_t word = words[full] & mask;
+		uint64_t edges = gpio_capture_edge_word(words, full) & mask;
+
+		counts.rising += __builtin_popcountll(edges & word);
+		counts.falling += __builtin_popcountll(edges & ~word);
+		counts.high += __builtin_popcountll(word);
+	}
+
+	stats->rising = counts.rising;
+	stats->falling = counts.falling;
+	stats->high = counts.high;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_find_edges(const uint64_t *words, unsigned long long sample_count, gpio_edge_e edge,
+		unsigned long long from, unsigned long long *positions, unsigned int max_count, unsigned int *count)
+{
+	const struct gpio_capture_edge_ops_s *ops = gpio_capture_edge_ops();
+	size_t word_count = (sample_count + GPIO_CAPTURE_WORD_BITS - 1) / GPIO_CAPTURE_WORD_BITS;
+	size_t w = from / GPIO_CAPTURE_WORD_BITS;
+	unsigned int found = 0;
+
+	if (!words || !positions || !count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+	if (edge != GPIO_EDGE_RISING && edge != GPIO_EDGE_FALLING && edge != GPIO_EDGE_BOTH)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	while (found < max_count && w < word_count) {
+		uint64_t edges;
+
+		w = ops->scan(words, w, word_count);
+		if (w == word_count)
+			break;
+
+		edges = gpio_capture_edge_word(words, w);
+		if (edge == GPIO_EDGE_RISING)
+			edges &= words[w];
+		else if (edge == GPIO_EDGE_FALLING)
+			edges &= ~words[w];
+		if (w == from / GPIO_CAPTURE_WORD_BITS)
+			edges &= ~0ULL << (from % GPIO_CAPTURE_WORD_BITS);
+		if (w == word_count - 1 && sample_count % GPIO_CAPTURE_WORD_BITS)
+			edges &= (1ULL << (sample_count % GPIO_CAPTURE_WORD_BITS)) - 1;
+
+		while (edges && found < max_count) {
+			positions[found++] = (unsigned long long)w * GPIO_CAPTURE_WORD_BITS + __builtin_ctzll(edges);
+			edges &= edges - 1;
+		}
+		w++;
+	}
+	*count = found;
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <new>
+#include <chrono>
+
+#ifdef GPIO_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_capture.h"
+#include "gpio_log.h"
+
+#define GPIO_STREAM_BLOCK_SAMPLES_DEFAULT 65536
+#define GPIO_STREAM_BLOCK_COUNT_DEFAULT 4
+#define GPIO_STREAM_BLOCK_COUNT_MIN 2
+#define GPIO_STREAM_WAIT_MS 10
+
+/* A run of queued blocks, contiguous in memory */
+struct gpio_stream_span_s {
+	const uint8_t *data;
+	size_t size;
+};
+
+static uint8_t *stream_block(struct gpio_capture_stream_s *stream, uint64_t index)
+{
+	return stream->blocks + (index % stream->block_count) * stream->block_size;
+}
+
+static uint8_t *stream_spare(struct gpio_capture_stream_s *stream)
+{
+	return stream->blocks + (size_t)stream->block_count * stream->block_size;
+}
+
+static int stream_write_all(struct gpio_capture_stream_s *stream, const uint8_t *data, size_t size)
+{
+	while (size) {
+		ssize_t ret;
+
+		if (stream->offset < 0)
+			ret = write(stream->fd, data, size);
+		else
+			ret = pwrite(stream->fd, data, size, stream->offset);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (stream->offset >= 0)
+			stream->offset += ret;
+		stream->bytes_written += ret;
+		data += ret;
+		size -= ret;
+	}
+	return 0;
+}
+
+#ifdef GPIO_HAVE_LIBURING
+/* Submits the spans as linked writes, and completes short or cancelled ones synchronously */
+static int stream_write_uring(struct gpio_capture_stream_s *stream, struct io_uring *ring,
+		const struct gpio_stream_span_s *spans, int count)
+{
+	size_t done[2] = { 0, 0 };
+	int64_t offset = stream->offset;
+	int ret = 0;
+
+	for (int i = 0; i < count; i++) {
+		struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+
+		io_uring_prep_write(sqe, stream->fd, spans[i].data, spans[i].size, offset);
+		io_uring_sqe_set_data(sqe, (void *)(uintptr_t)i);
+		if (i + 1 < count)
+			sqe->flags |= IOSQE_IO_LINK;
+		offset += spans[i].size;
+	}
+	io_uring_submit_and_wait(ring, count);
+
+	for (int i = 0; i < count; i++) {
+		struct io_uring_cqe *cqe;
+
+		if (io_uring_wait_cqe(ring, &cqe) < 0)
+			break;
+		if (cqe->res > 0)
+			done[(uintptr_t)io_uring_cqe_get_data(cqe)] = cqe->res;
+		io_uring_cqe_seen(ring, cqe);
+	}
+
+	for (int i = 0; i < count && !ret; i++) {
+		stream->bytes_written += done[i];
+		stream->offset += done[i];
+		if (done[i] < spans[i].size)
+			ret = stream_write_all(stream, spans[i].data + done[i], spans[i].size - done[i]);
+	}
+	return ret;
+}
+#endif
+
+/* Extends the summary of each pin plane with block @index */
+static void stream_summarize(struct gpio_capture_stream_s *stream, uint64_t index)
+{
+	const uint8_t *block = stream_block(stream, index);
+	const struct gpio_capture_block_header_s *header = (const struct gpio_capture_block_header_s *)block;
+	const uint64_t *planes = (const uint64_t *)(block + sizeof(struct gpio_capture_block_header_s));
+
+	for (unsigned int i = 0; i < stream->plane_count; i++) {
+		gpio_summary_skip(stream->summaries[i], header->first_sample);
+		gpio_summary_append(stream->summaries[i], planes + (size_t)i * stream->block_words, header->sample_count);
+	}
+}
+
+static void stream_writer(struct gpio_capture_stream_s *stream)
+{
+#ifdef GPIO_HAVE_LIBURING
+	struct io_uring ring;
+	bool uring = stream->offset >= 0 && io_uring_queue_init(2, &ring, 0) == 0;
+#endif
+
+	for (;;) {
+		uint64_t consumed = stream->consumed.load(std::memory_order_relaxed);
+		uint64_t produced, first;
+		struct gpio_stream_span_s spans[2];
+		int count = 0, ret = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(stream->lock);
+			stream->cond.wait_for(lock, std::chrono::milliseconds(GPIO_STREAM_WAIT_MS), [&] {
+				return stream->produced.load() != consumed || stream->closing.load();
+			});
+		}
+
+		produced = stream->produced.load(std::memory_order_acquire);
+		if (produced == consumed) {
+			if (stream->closing)
+				break;
+			continue;
+		}
+
+		/* The queued blocks take one span, or two where they wrap around the ring */
+		for (first = consumed; first < produced; ) {
+			uint64_t end = first - first % stream->block_count + stream->block_count;
+
+			if (end > produced)
+				end = produced;
+			spans[count].data = stream_block(stream, first);
+			spans[count].size = (end - first) * stream->block_size;
+			count++;
+			first = end;
+		}
+
+		if (!stream->error) {
+#ifdef GPIO_HAVE_LIBURING
+			if (uring)
+				ret = stream_write_uring(stream, &ring, spans, count);
+			else
+#endif
+			for (int i = 0; i < count && !ret; i++)
+				ret = stream_write_all(stream, spans[i].data, spans[i].size);
+
+			if (ret < 0) {
+				_E("capture stream write failed : %d", ret);
+				stream->error = -ret;
+			}
+		}
+
+		/* The blocks are summarized even when lost, they are still in memory */
+		for (uint64_t i = consumed; i < produced; i++)
+			stream_summarize(stream, i);
+
+		/* After an error the queued blocks are lost, and accounted as such */
+		if (stream->error) {
+			for (uint64_t i = consumed; i < produced; i++) {
+				struct gpio_capture_block_header_s *header =
+					(struct gpio_capture_block_header_s *)stream_block(stream, i);
+				stream->blocks_dropped++;
+				stream->samples_dropped += header->sample_count;
+			}
+		} else {
+			stream->blocks_written += produced - consumed;
+		}
+
+		stream->consumed.store(produced, std::memory_order_release);
+	}
+
+#ifdef GPIO_HAVE_LIBURING
+	if (uring)
+		io_uring_queue_exit(&ring);
+#endif
+}
+
+/* Picks the block the next samples go to, the spare one if the writer lags behind */
+static void stream_open_block(struct gpio_capture_stream_s *stream, uint64_t first_sample)
+{
+	uint64_t produced = stream->produced.load(std::memory_order_relaxed);
+	uint64_t pending = produced - stream->consumed.load(std::memory_order_acquire);
+
+	if (pending >= stream->block_count || stream->error.load(std::memory_order_relaxed))
+		stream->filling = stream_spare(stream);
+	else
+		stream->filling = stream_block(stream, produced);
+
+	stream->filling_first = first_sample;
+	memset(stream->filling, 0, stream->block_size);
+}
+
+static void stream_queue_block(struct gpio_capture_stream_s *stream, uint32_t sample_count)
+{
+	struct gpio_capture_block_header_s *header = (struct gpio_capture_block_header_s *)stream->filling;
+	uint64_t produced = stream->produced.load(std::memory_order_relaxed);
+	unsigned int pending;
+
+	if (stream->filling == stream_spare(stream)) {
+		stream->dropped++;
+		stream->blocks_dropped++;
+		stream->samples_dropped += sample_count;
+		stream->filling = NULL;
+		return;
+	}
+
+	header->first_sample = stream->filling_first;
+	header->sample_count = sample_count;
+	header->dropped = stream->dropped;
+	stream->dropped = 0;
+	stream->filling = NULL;
+
+	stream->produced.store(produced + 1, std::memory_order_release);
+	stream->cond.notify_one();
+
+	pending = produced + 1 - stream->consumed.load(std::memory_order_relaxed);
+	if (pending > stream->max_pending.load(std::memory_order_relaxed))
+		stream->max_pending.store(pending, std::memory_order_relaxed);
+}
+
+void gpio_capture_stream_store(struct gpio_capture_s *capture, uint64_t word)
+{
+	struct gpio_capture_stream_s *stream = capture->stream;
+	size_t index = word % stream->block_words;
+	uint64_t end;
+
+	if (index == 0)
+		stream_open_block(stream, word * GPIO_CAPTURE_WORD_BITS);
+
+	gpio_capture_pack(capture, (uint64_t *)(stream->filling + sizeof(struct gpio_capture_block_header_s)),
+			stream->block_words, index);
+
+	/* The last word of a capture may be partial, also when it ends a block */
+	if (index == stream->block_words - 1) {
+		end = stream->filling_first + (uint64_t)stream->block_words * GPIO_CAPTURE_WORD_BITS;
+		stream_queue_block(stream, (end < capture->taken ? end : capture->taken) - stream->filling_first);
+	}
+}
+
+int gpio_capture_stream_begin(struct gpio_capture_s *capture)
+{
+	struct gpio_capture_stream_s *stream = capture->stream;
+	struct gpio_capture_stream_header_s header;
+	size_t ports_size = ((capture->port_count * sizeof(uint32_t)) + 7) & ~(size_t)7;
+	uint8_t *buffer;
+	off_t offset;
+	int ret;
+
+	stream->filling = NULL;
+	stream->dropped = 0;
+	stream->produced = 0;
+	stream->consumed = 0;
+	stream->closing = false;
+	stream->blocks_written = 0;
+	stream->blocks_dropped = 0;
+	stream->samples_dropped = 0;
+	stream->bytes_written = 0;
+	stream->max_pending = 0;
+	stream->error = 0;
+
+	for (unsigned int i = 0; i < stream->plane_count; i++)
+		gpio_summary_reset(stream->summaries[i]);
+
+	/* Positioned writes need a seekable file, pipes are written in order instead */
+	offset = lseek(stream->fd, 0, SEEK_CUR);
+	stream->offset = offset;
+
+	buffer = (uint8_t *)calloc(1, sizeof(header) + ports_size);
+	if (!buffer)
+		return -1;
+
+	header.magic = GPIO_CAPTURE_STREAM_MAGIC;
+	header.version = GPIO_CAPTURE_STREAM_VERSION;
+	header.port_count = capture->port_count;
+	header.period_ns = capture->period_ns;
+	header.block_samples = stream->block_words * GPIO_CAPTURE_WORD_BITS;
+	header.reserved = 0;
+	memcpy(buffer, &header, sizeof(header));
+	for (int p = 0; p < capture->port_count; p++)
+		((uint32_t *)(buffer + sizeof(header)))[p] = capture->ports[p];
+
+	ret = stream_write_all(stream, buffer, sizeof(header) + ports_size);
+	free(buffer);
+	if (ret < 0) {
+		_E("capture stream header write failed : %d", ret);
+		stream->error = -ret;
+		return -1;
+	}
+
+	try {
+		stream->writer = std::thread(stream_writer, stream);
+	} catch (...) {
+		return -1;
+	}
+
+	return 0;
+}
+
+void gpio_capture_stream_end(struct gpio_capture_s *capture)
+{
+	struct gpio_capture_stream_s *stream = capture->stream;
+
+	if (!stream->writer.joinable())
+		return;
+
+	if (stream->filling)
+		stream_queue_block(stream, capture->taken - stream->filling_first);
+
+	stream->closing = true;
+	stream->cond.notify_one();
+	stream->writer.join();
+
+	_D("capture stream closed : %llu blocks written, %llu dropped, %llu bytes",
+			(unsigned long long)stream->blocks_written.load(),
+			(unsigned long long)stream->blocks_dropped.load(),
+			(unsigned long long)stream->bytes_written.load());
+}
+
+void gpio_capture_stream_destroy(struct gpio_capture_s *capture)
+{
+	if (!capture->stream)
+		return;
+
+	gpio_capture_stream_end(capture);
+	free(capture->stream->blocks);
+	delete capture->stream;
+	capture->stream = NULL;
+}
+
+int gpio_capture_set_stream(gpio_capture_h capture, int fd,
+		unsigned int block_samples, unsigned int block_count)
+{
+	struct gpio_capture_stream_s *stream;
+
+	_D("called gpio_capture_set_stream : capture[0x%x], fd[%d], block_samples[%u], block_count[%u]",
+			capture, fd, block_samples, block_count);
+
+	if (!capture || capture->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (!block_samples)
+		block_samples = GPIO_STREAM_BLOCK_SAMPLES_DEFAULT;
+	if (!block_count)
+		block_count = GPIO_STREAM_BLOCK_COUNT_DEFAULT;
+	if (block_count < GPIO_STREAM_BLOCK_COUNT_MIN)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	gpio_capture_stream_destroy(capture);
+	if (fd < 0)
+		return GPIO_ERROR_NONE;
+
+	if (gpio_capture_summaries_init(capture) != GPIO_ERROR_NONE)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	stream = new(std::nothrow) struct gpio_capture_stream_s;
+	if (!stream)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	stream->fd = fd;
+	stream->block_words = (block_samples + GPIO_CAPTURE_WORD_BITS - 1) / GPIO_CAPTURE_WORD_BITS;
+	stream->block_count = block_count;
+	stream->block_size = sizeof(struct gpio_capture_block_header_s) +
+		(size_t)capture->port_count * GPIO_CAPTURE_PORT_PINS * stream->block_words * sizeof(uint64_t);
+	stream->blocks = (uint8_t *)malloc(stream->block_size * (block_count + 1));
+	if (!stream->blocks) {
+		delete stream;
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+	stream->summaries = capture->summaries;
+	stream->plane_count = capture->port_count * GPIO_CAPTURE_PORT_PINS;
+	stream->filling = NULL;
+	stream->blocks_written = 0;
+	stream->blocks_dropped = 0;
+	stream->samples_dropped = 0;
+	stream->bytes_written = 0;
+	stream->max_pending = 0;
+	stream->error = 0;
+
+	capture->stream = stream;
+
+	_D("success gpio_capture_set_stream : %zu bytes per block", stream->block_size);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_capture_get_stream_stats(gpio_capture_h capture, gpio_capture_stream_stats_s *stats)
+{
+	struct gpio_capture_stream_s *stream;
+
+	if (!capture || !stats || !capture->stream)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	stream = capture->stream;
+	stats->blocks_written = stream->blocks_written;
+	stats->blocks_dropped = stream->blocks_dropped;
+	stats->samples_dropped = stream->samples_dropped;
+	stats->bytes_written = stream->bytes_written;
+	stats->max_pending = stream->max_pending;
+	stats->error = stream->error;
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <new>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_decoder.h"
+
+/* NEC, on the active low output of an IR receiver: a mark is LOW */
+#define NEC_LEADER_MARK_NS (9000 * GPIO_NS_PER_US)
+#define NEC_LEADER_SPACE_NS (4500 * GPIO_NS_PER_US)
+#define NEC_REPEAT_SPACE_NS (2250 * GPIO_NS_PER_US)
+#define NEC_BIT_MARK_NS (562 * GPIO_NS_PER_US)
+#define NEC_ZERO_SPACE_NS (562 * GPIO_NS_PER_US)
+#define NEC_ONE_SPACE_NS (1687 * GPIO_NS_PER_US)
+#define NEC_BITS 32
+
+/* RC5, Manchester coded on the same kind of receiver: a one is HIGH then LOW */
+#define RC5_HALF_BIT_NS (889 * GPIO_NS_PER_US)
+#define RC5_HALVES 28
+
+#define UART_SLOTS 10
+
+/* Samples per shortest pulse: each edge is then late by at most an eighth of it, well within the margins */
+#define GPIO_DECODER_SAMPLES_PER_PULSE 8
+
+enum {
+	NEC_IDLE = 0,
+	NEC_LEADER, //leader mark seen, its space decides between frame and repeat
+	NEC_MARK, //a bit mark, or the final one after 32 bits
+	NEC_SPACE,
+	NEC_REPEAT_MARK,
+};
+
+/* Within 25% of @nominal, enough for the oscillators of remote controls */
+static inline bool near(uint64_t duration, uint64_t nominal)
+{
+	uint64_t margin = nominal / 4;
+
+	return duration + margin >= nominal && duration <= nominal + margin;
+}
+
+static void frame_init(gpio_frame_s *frame, gpio_decoder_e type, uint64_t start_ns)
+{
+	memset(frame, 0, sizeof(*frame));
+	frame->decoder = type;
+	frame->timestamp_ns = start_ns;
+}
+
+static void nec_reset(struct gpio_decoder_s *decoder)
+{
+	decoder->nec.step = NEC_IDLE;
+	decoder->nec.valid = false;
+}
+
+static bool nec_pulse(struct gpio_decoder_s *decoder, bool level, uint64_t start_ns, uint64_t end_ns,
+		gpio_frame_s *frame)
+{
+	struct gpio_decoder_nec_s *nec = &decoder->nec;
+	uint64_t duration = end_ns - start_ns;
+	int step = nec->step;
+
+	nec->step = NEC_IDLE;
+
+	/* A leader restarts decoding from anywhere */
+	if (!level && near(duration, NEC_LEADER_MARK_NS)) {
+		nec->step = NEC_LEADER;
+		nec->start_ns = start_ns;
+		return false;
+	}
+
+	switch (step) {
+	case NEC_LEADER:
+		if (level && near(duration, NEC_LEADER_SPACE_NS)) {
+			nec->step = NEC_MARK;
+			nec->bits = 0;
+			nec->value = 0;
+		} else if (level && near(duration, NEC_REPEAT_SPACE_NS)) {
+			nec->step = NEC_REPEAT_MARK;
+		}
+		return false;
+
+	case NEC_MARK:
+		if (level || !near(duration, NEC_BIT_MARK_NS))
+			return false;
+		if (nec->bits < NEC_BITS) {
+			nec->step = NEC_SPACE;
+			return false;
+		}
+
+		/* Address, its complement unless extended, command and its complement, LSB first */
+		if ((((nec->value >> 16) ^ (nec->value >> 24)) & 0xff) != 0xff) {
+			nec->valid = false;
+			return false;
+		}
+		nec->address = ((nec->value ^ (nec->value >> 8)) & 0xff) == 0xff ?
+			nec->value & 0xff : nec->value & 0xffff;
+		nec->command = (nec->value >> 16) & 0xff;
+		nec->valid = true;
+		frame_init(frame, GPIO_DECODER_NEC, nec->start_ns);
+		frame->address = nec->address;
+		frame->command = nec->command;
+		return true;
+
+	case NEC_SPACE:
+		if (level && near(duration, NEC_ZERO_SPACE_NS)) {
+			nec->bits++;
+			nec->step = NEC_MARK;
+		} else if (level && near(duration, NEC_ONE_SPACE_NS)) {
+			nec->value |= 1U << nec->bits++;
+			nec->step = NEC_MARK;
+		}
+		return false;
+
+	case NEC_REPEAT_MARK:
+		if (level || !near(duration, NEC_BIT_MARK_NS) || !nec->valid)
+			return false;
+		frame_init(frame, GPIO_DECODER_NEC, nec->start_ns);
+		frame->address = nec->address;
+		frame->command = nec->command;
+		frame->repeat = true;
+		return true;
+	}
+	return false;
+}
+
+static void rc5_reset(struct gpio_decoder_s *decoder)
+{
+	decoder->rc5.halves = 0;
+}
+
+/* Decodes the 28 half bits: start, field, toggle, 5 address and 6 command bits, MSB first */
+static bool rc5_frame(struct gpio_decoder_s *decoder, gpio_frame_s *frame)
+{
+	struct gpio_decoder_rc5_s *rc5 = &decoder->rc5;
+	uint32_t bits = 0;
+
+	rc5->halves = 0;
+	for (int i = 0; i < RC5_HALVES / 2; i++) {
+		unsigned int pair = (rc5->levels >> (2 * i)) & 3;
+
+		/* HIGH then LOW is a one, LOW then HIGH a zero; no edge in the middle is not Manchester */
+		if (pair != 1 && pair != 2)
+			return false;
+		bits = bits << 1 | (pair == 1);
+	}
+
+	frame_init(frame, GPIO_DECODER_RC5, rc5->start_ns);
+	frame->address = (bits >> 6) & 0x1f;
+	frame->command = (bits & 0x3f) | (bits & (1 << 12) ? 0 : 0x40);
+	frame->toggle = bits & (1 << 11);
+	return true;
+}
+
+static bool rc5_pulse(struct gpio_decoder_s *decoder, bool level, uint64_t start_ns, uint64_t end_ns,
+		gpio_frame_s *frame)
+{
+	struct gpio_decoder_rc5_s *rc5 = &decoder->rc5;
+	uint64_t half = decoder->bit_ns;
+	uint64_t duration = end_ns - start_ns;
+	unsigned int n = duration < half / 2 ? 0 : duration < half * 3 / 2 ? 1 : duration < half * 5 / 2 ? 2 : 3;
+	bool done = false;
+
+	if (rc5->halves) {
+		if (n == 1 || n == 2) {
+			for (unsigned int i = 0; i < n && rc5->halves < RC5_HALVES; i++)
+				rc5->levels |= (uint32_t)level << rc5->halves++;
+			if (rc5->halves == RC5_HALVES)
+				return rc5_frame(decoder, frame);
+			return false;
+		}
+
+		/* The last half bit of a zero is HIGH, and runs into the idle line */
+		if (level && rc5->halves == RC5_HALVES - 1) {
+			rc5->levels |= 1U << rc5->halves++;
+			done = rc5_frame(decoder, frame);
+		}
+		rc5->halves = 0;
+	}
+
+	/* The first half of the start bit is HIGH like the idle line: a frame starts on a falling edge */
+	if (level) {
+		rc5->halves = 1;
+		rc5->levels = 1;
+		rc5->start_ns = end_ns - half;
+	}
+	return done;
+}
+
+static bool rc5_idle(struct gpio_decoder_s *decoder, bool level, uint64_t since_ns, uint64_t now_ns,
+		gpio_frame_s *frame)
+{
+	struct gpio_decoder_rc5_s *rc5 = &decoder->rc5;
+
+	if (!level || rc5->halves != RC5_HALVES - 1 || now_ns - since_ns < decoder->bit_ns * 5 / 2)
+		return false;
+	rc5->levels |= 1U << rc5->halves++;
+	return rc5_frame(decoder, frame);
+}
+
+static void uart_reset(struct gpio_decoder_s *decoder)
+{
+	decoder->uart.receiving = false;
+}
+
+/* Samples @level in the middle of every bit that ends before @until_ns; true once the stop bit is in */
+static bool uart_sample(struct gpio_decoder_s *decoder, bool level, uint64_t until_ns, gpio_frame_s *frame)
+{
+	struct gpio_decoder_uart_s *uart = &decoder->uart;
+
+	while (uart->slot < UART_SLOTS &&
+			uart->start_ns + uart->slot * decoder->bit_ns + decoder->bit_ns / 2 < until_ns)
+		uart->bits |= (unsigned int)level << uart->slot++;
+	if (uart->slot < UART_SLOTS)
+		return false;
+
+	/* A LOW start bit and a HIGH stop bit, or a framing error */
+	uart->receiving = false;
+	if ((uart->bits & 1) || !(uart->bits >> 9))
+		return false;
+	frame_init(frame, GPIO_DECODER_UART, uart->start_ns);
+	frame->command = (uart->bits >> 1) & 0xff;
+	return true;
+}
+
+static bool uart_pulse(struct gpio_decoder_s *decoder, bool level, uint64_t start_ns, uint64_t end_ns,
+		gpio_frame_s *frame)
+{
+	struct gpio_decoder_uart_s *uart = &decoder->uart;
+	bool done = false;
+
+	/* Bits are timed from the start bit, not from each pulse */
+	(void)start_ns;
+
+	if (uart->receiving)
+		done = uart_sample(decoder, level, end_ns, frame);
+
+	/* A falling edge on an idle line is a start bit, right after a stop bit too */
+	if (!uart->receiving && level) {
+		uart->receiving = true;
+		uart->slot = 0;
+		uart->bits = 0;
+		uart->start_ns = end_ns;
+	}
+	return done;
+}
+
+static bool uart_idle(struct gpio_decoder_s *decoder, bool level, uint64_t since_ns, uint64_t now_ns,
+		gpio_frame_s *frame)
+{
+	(void)since_ns;
+
+	if (!decoder->uart.receiving)
+		return false;
+	return uart_sample(decoder, level, now_ns, frame);
+}
+
+static const struct gpio_decoder_ops_s decoders[] = {
+	{ GPIO_DECODER_NEC, nec_reset, nec_pulse, NULL },
+	{ GPIO_DECODER_RC5, rc5_reset, rc5_pulse, rc5_idle },
+	{ GPIO_DECODER_UART, uart_reset, uart_pulse, uart_idle },
+};
+
+struct gpio_decoder_s *gpio_decoder_create(gpio_decoder_e type, unsigned int param)
+{
+	const struct gpio_decoder_ops_s *ops = NULL;
+	struct gpio_decoder_s *decoder;
+
+	for (size_t i = 0; i < sizeof(decoders) / sizeof(decoders[0]); i++) {
+		if (decoders[i].type == type)
+			ops = &decoders[i];
+	}
+	if (!ops || (type == GPIO_DECODER_UART && (!param || param > GPIO_NS_PER_SEC)))
+		return NULL;
+
+	decoder = new(std::nothrow) struct gpio_decoder_s;
+	if (!decoder)
+		return NULL;
+
+	decoder->ops = ops;
+	decoder->bit_ns = type == GPIO_DECODER_UART ? GPIO_NS_PER_SEC / param :
+		type == GPIO_DECODER_RC5 ? RC5_HALF_BIT_NS : NEC_BIT_MARK_NS;
+
+	/* A late first edge takes half the margin of its pulse: an eighth of the leader mark, a quarter of the shortest pulse */
+	if (type == GPIO_DECODER_NEC) {
+		decoder->quiet_ns = NEC_LEADER_MARK_NS + NEC_LEADER_MARK_NS / 4;
+		decoder->lateness_ns = NEC_LEADER_MARK_NS / 8;
+	} else if (type == GPIO_DECODER_RC5) {
+		decoder->quiet_ns = decoder->bit_ns * 5 / 2;
+		decoder->lateness_ns = decoder->bit_ns / 4;
+	} else {
+		decoder->quiet_ns = decoder->bit_ns * UART_SLOTS;
+		decoder->lateness_ns = decoder->bit_ns / 4;
+	}
+	decoder->primed = false;
+	ops->reset(decoder);
+
+	return decoder;
+}
+
+void gpio_decoder_destroy(struct gpio_decoder_s *decoder)
+{
+	delete decoder;
+}
+
+uint64_t gpio_decoder_period_ns(const struct gpio_decoder_s *decoder)
+{
+	return decoder->bit_ns / GPIO_DECODER_SAMPLES_PER_PULSE;
+}
+
+uint64_t gpio_decoder_quiet_ns(const struct gpio_decoder_s *decoder)
+{
+	return decoder->quiet_ns;
+}
+
+uint64_t gpio_decoder_lateness_ns(const struct gpio_decoder_s *decoder)
+{
+	return decoder->lateness_ns;
+}
+
+bool gpio_decoder_feed(struct gpio_decoder_s *decoder, bool level, uint64_t now_ns, gpio_frame_s *frame)
+{
+	bool done;
+
+	/* Decoding starts from the first level seen, whatever came before */
+	if (!decoder->primed) {
+		decoder->primed = true;
+		decoder->level = level;
+		decoder->since_ns = now_ns;
+		return false;
+	}
+
+	if (level == decoder->level) {
+		if (!decoder->ops->idle)
+			return false;
+		return decoder->ops->idle(decoder, level, decoder->since_ns, now_ns, frame);
+	}
+
+	done = decoder->ops->pulse(decoder, decoder->level, decoder->since_ns, now_ns, frame);
+	decoder->level = level;
+	decoder->since_ns = now_ns;
+	return done;
+}
@@ -0,0 +1,527 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <new>
+#include <vector>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_edgelog.h"
+#include "gpio_log.h"
+
+#define GPIO_EDGELOG_INDEX_INTERVAL_DEFAULT 1024
+
+struct gpio_edgelog_writer_s {
+	FILE *fp;
+	int port_count;
+	gpio_port_e *ports;
+	uint8_t *state;
+	uint32_t index_interval;
+	uint64_t start_ns;
+	uint64_t last_ns;
+	uint64_t record_count;
+	uint64_t offset;
+	std::vector<gpio_edgelog_index_s> index;
+};
+
+struct gpio_edgelog_s {
+	const uint8_t *map;
+	size_t size;
+	struct gpio_edgelog_header_s header;
+	struct gpio_edgelog_trailer_s trailer;
+	const uint32_t *ports; //unaligned, read through memcpy
+	const uint8_t *initial;
+	const uint8_t *records; //first record, right after the header
+	const uint8_t *index;
+	const uint8_t *end; //end of the records
+};
+
+/* Where decoding resumes: the position, time and ordinal of the next record, and the states */
+struct gpio_edgelog_cursor_s {
+	const uint8_t *pos;
+	uint64_t time_ns;
+	uint64_t record;
+	uint8_t state[GPIO_EDGELOG_MAX_PORTS];
+};
+
+static int writer_put(struct gpio_edgelog_writer_s *writer, const void *data, size_t size)
+{
+	if (fwrite(data, 1, size, writer->fp) != size)
+		return GPIO_ERROR_IO_ERROR;
+	writer->offset += size;
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_writer_create(const char *path, const gpio_port_e *ports, int port_count,
+		const uint8_t *initial_state, unsigned long long start_ns,
+		unsigned int index_interval, gpio_edgelog_writer_h *writer)
+{
+	struct gpio_edgelog_writer_s *_writer;
+	struct gpio_edgelog_header_s header;
+	int error = GPIO_ERROR_NONE;
+
+	_D("called gpio_edgelog_writer_create : path[%s], port_count[%d]", path, port_count);
+
+	if (!path || !ports || port_count <= 0 || port_count > GPIO_EDGELOG_MAX_PORTS || !writer)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	_writer = new(std::nothrow) struct gpio_edgelog_writer_s;
+	if (!_writer)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_writer->port_count = port_count;
+	_writer->index_interval = index_interval ? index_interval : GPIO_EDGELOG_INDEX_INTERVAL_DEFAULT;
+	_writer->start_ns = start_ns;
+	_writer->last_ns = start_ns;
+	_writer->record_count = 0;
+	_writer->offset = 0;
+	_writer->ports = (gpio_port_e *)malloc(port_count * sizeof(gpio_port_e));
+	_writer->state = (uint8_t *)calloc(port_count, 1);
+	_writer->fp = fopen(path, "wb");
+
+	if (!_writer->ports || !_writer->state || !_writer->fp) {
+		error = _writer->fp ? GPIO_ERROR_OUT_OF_MEMORY : GPIO_ERROR_IO_ERROR;
+		goto fail;
+	}
+
+	memcpy(_writer->ports, ports, port_count * sizeof(gpio_port_e));
+	if (initial_state)
+		memcpy(_writer->state, initial_state, port_count);
+
+	header.magic = GPIO_EDGELOG_MAGIC;
+	header.version = GPIO_EDGELOG_VERSION;
+	header.port_count = port_count;
+	header.index_interval = _writer->index_interval;
+	header.reserved = 0;
+	header.start_ns = start_ns;
+
+	error = writer_put(_writer, &header, sizeof(header));
+	for (int p = 0; p < port_count && !error; p++) {
+		uint32_t port = ports[p];
+		error = writer_put(_writer, &port, sizeof(port));
+	}
+	if (!error)
+		error = writer_put(_writer, _writer->state, port_count);
+	if (error)
+		goto fail;
+
+	*writer = _writer;
+
+	_D("success gpio_edgelog_writer_create : writer[0x%x]", _writer);
+
+	return GPIO_ERROR_NONE;
+
+fail:
+	if (_writer->fp)
+		fclose(_writer->fp);
+	free(_writer->ports);
+	free(_writer->state);
+	delete _writer;
+	return error;
+}
+
+int gpio_edgelog_writer_append(gpio_edgelog_writer_h writer, unsigned long long timestamp_ns,
+		gpio_port_e port, uint8_t state)
+{
+	uint8_t record[GPIO_EDGELOG_VARINT_MAX + 2];
+	size_t size;
+	int port_index = -1;
+	uint8_t changed;
+	int error;
+
+	if (!writer || timestamp_ns < writer->last_ns)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	for (int p = 0; p < writer->port_count; p++) {
+		if (writer->ports[p] == port) {
+			port_index = p;
+			break;
+		}
+	}
+	if (port_index < 0)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	changed = writer->state[port_index] ^ state;
+	if (!changed)
+		return GPIO_ERROR_NONE;
+
+	if (writer->record_count && !(writer->record_count % writer->index_interval)) {
+		struct gpio_edgelog_index_s entry;
+
+		entry.time_ns = writer->last_ns;
+		entry.offset = writer->offset;
+		error = writer_put(writer, &writer->last_ns, sizeof(writer->last_ns));
+		if (!error)
+			error = writer_put(writer, &writer->record_count, sizeof(writer->record_count));
+		if (!error)
+			error = writer_put(writer, writer->state, writer->port_count);
+		if (error)
+			return error;
+		writer->index.push_back(entry);
+	}
+
+	size = gpio_edgelog_varint_put(record, timestamp_ns - writer->last_ns);
+	record[size++] = port_index;
+	record[size++] = changed;
+	error = writer_put(writer, record, size);
+	if (error)
+		return error;
+
+	writer->state[port_index] = state;
+	writer->last_ns = timestamp_ns;
+	writer->record_count++;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_writer_close(gpio_edgelog_writer_h writer)
+{
+	struct gpio_edgelog_trailer_s trailer;
+	int error = GPIO_ERROR_NONE;
+
+	_D("called gpio_edgelog_writer_close : writer[0x%x]", writer);
+
+	if (!writer)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	trailer.index_offset = writer->offset;
+	trailer.record_count = writer->record_count;
+	trailer.end_ns = writer->last_ns;
+	trailer.index_count = writer->index.size();
+	trailer.magic = GPIO_EDGELOG_INDEX_MAGIC;
+
+	if (!writer->index.empty())
+		error = writer_put(writer, &writer->index[0], writer->index.size() * sizeof(gpio_edgelog_index_s));
+	if (!error)
+		error = writer_put(writer, &trailer, sizeof(trailer));
+	if (fclose(writer->fp) && !error)
+		error = GPIO_ERROR_IO_ERROR;
+
+	free(writer->ports);
+	free(writer->state);
+	delete writer;
+
+	_D("success gpio_edgelog_writer_close");
+
+	return error;
+}
+
+int gpio_edgelog_open(const char *path, gpio_edgelog_h *log)
+{
+	struct gpio_edgelog_s *_log;
+	struct stat st;
+	size_t header_size;
+	void *map;
+	int fd;
+
+	_D("called gpio_edgelog_open : path[%s]", path);
+
+	if (!path || !log)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(gpio_edgelog_header_s) + sizeof(gpio_edgelog_trailer_s)) {
+		close(fd);
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return GPIO_ERROR_IO_ERROR;
+
+	_log = new(std::nothrow) struct gpio_edgelog_s;
+	if (!_log) {
+		munmap(map, st.st_size);
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	_log->map = (const uint8_t *)map;
+	_log->size = st.st_size;
+	memcpy(&_log->header, _log->map, sizeof(_log->header));
+	memcpy(&_log->trailer, _log->map + _log->size - sizeof(_log->trailer), sizeof(_log->trailer));
+
+	header_size = sizeof(_log->header) + _log->header.port_count * (sizeof(uint32_t) + 1);
+
+	/* Rejects files that are not edge logs, that were not closed, or with more ports than a cursor holds */
+	if (_log->header.magic != GPIO_EDGELOG_MAGIC || _log->header.version != GPIO_EDGELOG_VERSION ||
+			!_log->header.port_count || _log->header.port_count > GPIO_EDGELOG_MAX_PORTS ||
+			!_log->header.index_interval ||
+			_log->trailer.magic != GPIO_EDGELOG_INDEX_MAGIC ||
+			_log->trailer.index_offset < header_size ||
+			_log->trailer.index_offset + (uint64_t)_log->trailer.index_count * sizeof(gpio_edgelog_index_s) +
+				sizeof(_log->trailer) != _log->size) {
+		_E("%s is not a valid edge log", path);
+		gpio_edgelog_close(_log);
+		return GPIO_ERROR_INVALID_PARAMETER;
+	}
+
+	_log->ports = (const uint32_t *)(_log->map + sizeof(_log->header));
+	_log->initial = _log->map + sizeof(_log->header) + _log->header.port_count * sizeof(uint32_t);
+	_log->records = _log->map + header_size;
+	_log->index = _log->map + _log->trailer.index_offset;
+	_log->end = _log->index;
+
+	*log = _log;
+
+	_D("success gpio_edgelog_open : %llu records, %u index entries",
+			(unsigned long long)_log->trailer.record_count, _log->trailer.index_count);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_close(gpio_edgelog_h log)
+{
+	if (!log)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	munmap((void *)log->map, log->size);
+	delete log;
+
+	return GPIO_ERROR_NONE;
+}
+
+static int edgelog_port_index(const struct gpio_edgelog_s *log, gpio_port_e port)
+{
+	for (int p = 0; p < log->header.port_count; p++) {
+		uint32_t value;
+
+		memcpy(&value, log->ports + p, sizeof(value));
+		if (value == (uint32_t)port)
+			return p;
+	}
+	return -1;
+}
+
+static struct gpio_edgelog_index_s edgelog_index_entry(const struct gpio_edgelog_s *log, uint32_t i)
+{
+	struct gpio_edgelog_index_s entry;
+
+	memcpy(&entry, log->index + i * sizeof(entry), sizeof(entry));
+	return entry;
+}
+
+/*
+ * Positions @cursor at the last checkpoint whose time is below @time_ns,
+ * or at or below it if @inclusive, or at the start of the records.
+ */
+static int edgelog_seek(const struct gpio_edgelog_s *log, uint64_t time_ns, bool inclusive,
+		struct gpio_edgelog_cursor_s *cursor)
+{
+	uint32_t low = 0, high = log->trailer.index_count;
+	const uint8_t *checkpoint;
+
+	while (low < high) {
+		uint32_t mid = low + (high - low) / 2;
+		uint64_t t = edgelog_index_entry(log, mid).time_ns;
+
+		if (t < time_ns || (inclusive && t == time_ns))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (!low) {
+		cursor->pos = log->records;
+		cursor->time_ns = log->header.start_ns;
+		cursor->record = 0;
+		memcpy(cursor->state, log->initial, log->header.port_count);
+		return GPIO_ERROR_NONE;
+	}
+
+	checkpoint = log->map + edgelog_index_entry(log, low - 1).offset;
+	if (checkpoint < log->records || checkpoint + 16 + log->header.port_count > log->end)
+		return GPIO_ERROR_IO_ERROR;
+
+	memcpy(&cursor->time_ns, checkpoint, sizeof(cursor->time_ns));
+	memcpy(&cursor->record, checkpoint + 8, sizeof(cursor->record));
+	memcpy(cursor->state, checkpoint + 16, log->header.port_count);
+	cursor->pos = checkpoint + 16 + log->header.port_count;
+	return GPIO_ERROR_NONE;
+}
+
+/* Decodes the next record at @cursor; returns 1 on a record, 0 at the end, or an error */
+static int edgelog_next(const struct gpio_edgelog_s *log, struct gpio_edgelog_cursor_s *cursor,
+		int *port_index, uint8_t *changed)
+{
+	uint64_t delta;
+	size_t size;
+
+	if (cursor->record >= log->trailer.record_count)
+		return 0;
+
+	size = gpio_edgelog_varint_get(cursor->pos, log->end, &delta);
+	if (!size || cursor->pos + size + 2 > log->end || cursor->pos[size] >= log->header.port_count)
+		return -GPIO_ERROR_IO_ERROR;
+
+	*port_index = cursor->pos[size];
+	*changed = cursor->pos[size + 1];
+	cursor->pos += size + 2;
+	cursor->time_ns += delta;
+	cursor->record++;
+	cursor->state[*port_index] ^= *changed;
+
+	/* Checkpoints sit before known ordinals, and are skipped while decoding */
+	if (!(cursor->record % log->header.index_interval) && cursor->record < log->trailer.record_count)
+		cursor->pos += 16 + log->header.port_count;
+	return 1;
+}
+
+int gpio_edgelog_get_range(gpio_edgelog_h log, unsigned long long *start_ns,
+		unsigned long long *end_ns, unsigned long long *record_count)
+{
+	if (!log || !start_ns || !end_ns || !record_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*start_ns = log->header.start_ns;
+	*end_ns = log->trailer.end_ns;
+	*record_count = log->trailer.record_count;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_get_ports(gpio_edgelog_h log, gpio_port_e *ports, int max_count, int *port_count)
+{
+	if (!log || (!ports && max_count) || max_count < 0 || !port_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	for (int p = 0; p < log->header.port_count && p < max_count; p++) {
+		uint32_t port;
+
+		memcpy(&port, log->ports + p, sizeof(port));
+		ports[p] = (gpio_port_e)port;
+	}
+	*port_count = log->header.port_count;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_get_initial_state(gpio_edgelog_h log, gpio_port_e port, uint8_t *state)
+{
+	int port_index;
+
+	if (!log || !state)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	port_index = edgelog_port_index(log, port);
+	if (port_index < 0)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*state = log->initial[port_index];
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_get_port_state(gpio_edgelog_h log, gpio_port_e port,
+		unsigned long long timestamp_ns, uint8_t *state)
+{
+	struct gpio_edgelog_cursor_s cursor;
+	int port_index, error;
+
+	if (!log || !state)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	port_index = edgelog_port_index(log, port);
+	if (port_index < 0)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	error = edgelog_seek(log, timestamp_ns, true, &cursor);
+	if (error)
+		return error;
+
+	for (;;) {
+		uint8_t before = cursor.state[port_index];
+		uint8_t changed;
+		int index;
+		int ret = edgelog_next(log, &cursor, &index, &changed);
+
+		if (ret < 0)
+			return -ret;
+		if (!ret || cursor.time_ns > timestamp_ns) {
+			*state = ret ? before : cursor.state[port_index];
+			break;
+		}
+	}
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_get_value(gpio_edgelog_h log, gpio_pin_e pin,
+		unsigned long long timestamp_ns, gpio_value_e *value)
+{
+	uint8_t state;
+	int error;
+
+	if (!value)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	error = gpio_edgelog_get_port_state(log, (gpio_port_e)(pin >> 3), timestamp_ns, &state);
+	if (error)
+		return error;
+
+	*value = (gpio_value_e)((state >> (pin & 7)) & 1);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_edgelog_foreach_edge(gpio_edgelog_h log, unsigned long long start_ns,
+		unsigned long long end_ns, gpio_edgelog_cb callback, void *user_data)
+{
+	struct gpio_edgelog_cursor_s cursor;
+	int error;
+
+	if (!log || !callback || start_ns > end_ns)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	error = edgelog_seek(log, start_ns, false, &cursor);
+	if (error)
+		return error;
+
+	for (;;) {
+		gpio_edgelog_record_s record;
+		uint32_t port;
+		uint8_t changed;
+		int index;
+		int ret = edgelog_next(log, &cursor, &index, &changed);
+
+		if (ret < 0)
+			return -ret;
+		if (!ret || cursor.time_ns > end_ns)
+			break;
+		if (cursor.time_ns < start_ns)
+			continue;
+
+		record.timestamp = cursor.time_ns;
+		memcpy(&port, log->ports + index, sizeof(port));
+		record.port = (gpio_port_e)port;
+		record.changed = changed;
+		record.state = cursor.state[index];
+		if (!callback(&record, user_data))
+			break;
+	}
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+#include <atomic>
+#include <thread>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+#define GPIO_ENCODER_WINDOW_MS_DEFAULT 10
+
+/* Movement for a change of state, indexed by previous state * 4 + state, a state being A * 2 + B */
+#define QUAD_INVALID 2
+
+static const int8_t quadrature[16] = {
+	0, 1, -1, QUAD_INVALID,
+	-1, 0, QUAD_INVALID, 1,
+	1, QUAD_INVALID, 0, -1,
+	QUAD_INVALID, -1, 1, 0,
+};
+
+/*
+ * Quadrature decoding at a fixed rate, by a sampling thread of its own.
+ * Each sample is one read of the port both pins are on, and one lookup
+ * of the transition from the previous state. A transition that changes
+ * both pins at once lost a state in between: it does not move the
+ * position and is counted as invalid.
+ *
+ * The thread is the only writer of the published state, which readers
+ * copy under a sequence count, so they never block it: seq is odd while
+ * the thread updates the state. It publishes on every move, and at the
+ * end of every velocity window.
+ */
+struct gpio_encoder_s {
+	gpio_pin_e pin_a;
+	gpio_pin_e pin_b;
+	volatile uint32_t *data;
+	uint32_t bit_a;
+	uint32_t bit_b;
+	uint64_t period_ns;
+	std::atomic<uint64_t> window_ns;
+
+	std::atomic<uint64_t> seq;
+	gpio_encoder_state_s state;
+
+	std::atomic<bool> running;
+	std::thread thread;
+};
+
+static inline unsigned int encoder_read_state(struct gpio_encoder_s *encoder)
+{
+	uint32_t value = *encoder->data;
+
+	return (value & encoder->bit_a ? 2 : 0) | (value & encoder->bit_b ? 1 : 0);
+}
+
+static void encoder_publish(struct gpio_encoder_s *encoder, const gpio_encoder_state_s *state)
+{
+	uint64_t seq = encoder->seq.load(std::memory_order_relaxed);
+
+	encoder->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	encoder->state = *state;
+	encoder->seq.store(seq + 2, std::memory_order_release);
+}
+
+static void encoder_sampler(struct gpio_encoder_s *encoder, unsigned int prev)
+{
+	gpio_encoder_state_s state = encoder->state;
+	uint64_t next = gpio_steady_now_ns();
+	uint64_t window_start = next;
+	long long window_position = state.position;
+
+	while (encoder->running.load(std::memory_order_relaxed)) {
+		unsigned int cur;
+		uint64_t now;
+		int move;
+
+		now = gpio_steady_wait_until(next);
+		if (now - next > encoder->period_ns)
+			state.late_count++;
+		next += encoder->period_ns;
+		state.sample_count++;
+
+		cur = encoder_read_state(encoder);
+		move = quadrature[prev << 2 | cur];
+		prev = cur;
+
+		if (move == QUAD_INVALID)
+			state.invalid_count++;
+		else
+			state.position += move;
+
+		if (now - window_start >= encoder->window_ns.load(std::memory_order_relaxed)) {
+			state.velocity = (double)(state.position - window_position) * GPIO_NS_PER_SEC / (now - window_start);
+			window_start = now;
+			window_position = state.position;
+		} else if (!move) {
+			continue;
+		}
+		encoder_publish(encoder, &state);
+	}
+}
+
+int gpio_encoder_create(gpio_pin_e pin_a, gpio_pin_e pin_b, unsigned int sample_rate, gpio_encoder_h *encoder)
+{
+	struct gpio_encoder_s *_encoder;
+
+	_D("called gpio_encoder_create : pin_a[%d], pin_b[%d], sample_rate[%u]", pin_a, pin_b, sample_rate);
+
+	if (!encoder || !sample_rate || sample_rate > GPIO_NS_PER_SEC || pin_a == pin_b ||
+			GET_PORT(pin_a) != GET_PORT(pin_b))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_port_init() < 0 ||
+			gpio_pin_set_direction(pin_a, GPIO_IN) < 0 || gpio_pin_set_direction(pin_b, GPIO_IN) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_encoder = new(std::nothrow) struct gpio_encoder_s;
+	if (!_encoder)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_encoder->pin_a = pin_a;
+	_encoder->pin_b = pin_b;
+	_encoder->data = gpio_port_data((gpio_port_e)GET_PORT(pin_a));
+	_encoder->bit_a = 1 << GET_OFFSET(pin_a);
+	_encoder->bit_b = 1 << GET_OFFSET(pin_b);
+	_encoder->period_ns = GPIO_NS_PER_SEC / sample_rate;
+	_encoder->window_ns = GPIO_ENCODER_WINDOW_MS_DEFAULT * GPIO_NS_PER_MS;
+	_encoder->seq = 0;
+	_encoder->state.position = 0;
+	_encoder->state.velocity = 0;
+	_encoder->state.invalid_count = 0;
+	_encoder->state.late_count = 0;
+	_encoder->state.sample_count = 0;
+	_encoder->running = true;
+
+	/* Counting starts from the state at creation, not whenever the thread gets to run */
+	try {
+		_encoder->thread = std::thread(encoder_sampler, _encoder, encoder_read_state(_encoder));
+	} catch (...) {
+		delete _encoder;
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	*encoder = _encoder;
+
+	_D("success gpio_encoder_create : encoder[0x%x]", _encoder);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_encoder_destroy(gpio_encoder_h encoder)
+{
+	_D("called gpio_encoder_destroy : encoder[0x%x]", encoder);
+
+	if (!encoder)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	encoder->running = false;
+	if (encoder->thread.joinable())
+		encoder->thread.join();
+
+	_D("success gpio_encoder_destroy : %llu samples, %llu invalid, %llu late",
+			encoder->state.sample_count, encoder->state.invalid_count, encoder->state.late_count);
+
+	delete encoder;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_encoder_set_velocity_window(gpio_encoder_h encoder, unsigned int window_ms)
+{
+	_D("called gpio_encoder_set_velocity_window : encoder[0x%x], window_ms[%u]", encoder, window_ms);
+
+	if (!encoder || !window_ms)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	encoder->window_ns = window_ms * GPIO_NS_PER_MS;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_encoder_read(gpio_encoder_h encoder, gpio_encoder_state_s *state)
+{
+	uint64_t begin;
+
+	if (!encoder || !state)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* Copies again if the sampling thread published meanwhile */
+	do {
+		begin = encoder->seq.load(std::memory_order_acquire);
+		*state = encoder->state;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((begin & 1) || encoder->seq.load(std::memory_order_relaxed) != begin);
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+#define GPIO_I2C_FREQUENCY_DEFAULT 400000
+#define GPIO_I2C_FREQUENCY_MAX 1000000
+#define GPIO_I2C_STRETCH_TIMEOUT_US_DEFAULT 10000
+#define GPIO_I2C_RISE_NS 300 //longest rise time of fast mode, not counted as stretching
+
+/*
+ * Bit-banged I2C master. The lines are open drain: their data bits are
+ * driven LOW once, and a line is pulled low by switching its pin to
+ * output, released by switching it back to input. The configuration
+ * register of each port is cached for the transfer, so a line change is
+ * a single store, and SCL and SDA on the same port share the cache.
+ *
+ * Timing is a busy-wait on absolute deadlines, so the cost of register
+ * accesses, measured by the calibration, eats into the waits instead of
+ * adding to them. A slave stretching the clock resets the deadlines.
+ */
+struct gpio_i2c_line_s {
+	gpio_pin_e pin;
+	volatile uint32_t *config;
+	volatile uint32_t *data;
+	uint32_t *image; //cached configuration register, shared by the lines of a port
+	uint32_t mode_bit; //output bit of the pin in the configuration register
+	uint32_t bit; //bit of the pin in the data register
+};
+
+struct gpio_i2c_s {
+	struct gpio_i2c_line_s scl;
+	struct gpio_i2c_line_s sda;
+	uint32_t images[2];
+	uint64_t low_ns; //SCL low time
+	uint64_t high_ns; //SCL high time, also the setup and hold times of start and stop
+	uint64_t stretch_timeout_ns;
+
+	uint64_t next; //deadline of the current step
+	unsigned int stretches; //in the current transaction
+};
+
+static void i2c_line_init(struct gpio_i2c_line_s *line, gpio_pin_e pin, uint32_t *image)
+{
+	line->pin = pin;
+	line->config = gpio_port_config((gpio_port_e)GET_PORT(pin));
+	line->data = gpio_port_data((gpio_port_e)GET_PORT(pin));
+	line->image = image;
+	line->mode_bit = 1 << (GET_OFFSET(pin) << 2);
+	line->bit = 1 << GET_OFFSET(pin);
+}
+
+static inline void i2c_line_set(struct gpio_i2c_line_s *line, bool low)
+{
+	*line->image = low ? *line->image | line->mode_bit : *line->image & ~line->mode_bit;
+	*line->config = *line->image;
+}
+
+static inline bool i2c_line_get(const struct gpio_i2c_line_s *line)
+{
+	return *line->data & line->bit;
+}
+
+static inline void i2c_wait(struct gpio_i2c_s *i2c, uint64_t ns)
+{
+	i2c->next += ns;
+	while (gpio_steady_now_ns() < i2c->next)
+		;
+}
+
+/* Releases SCL and waits for it to go high, as long as a slave stretches it */
+static gpio_i2c_status_e i2c_scl_release(struct gpio_i2c_s *i2c)
+{
+	uint64_t start, now;
+
+	i2c_line_set(&i2c->scl, false);
+	if (i2c_line_get(&i2c->scl))
+		return GPIO_I2C_STATUS_OK;
+
+	start = gpio_steady_now_ns();
+	do {
+		now = gpio_steady_now_ns();
+		if (now - start > i2c->stretch_timeout_ns)
+			return GPIO_I2C_STATUS_TIMEOUT;
+	} while (!i2c_line_get(&i2c->scl));
+
+	if (now - start > GPIO_I2C_RISE_NS) {
+		i2c->stretches++;
+		i2c->next = now;
+	}
+	return GPIO_I2C_STATUS_OK;
+}
+
+/* Clocks one bit out, SCL low on entry and exit; @in gets SDA as sampled */
+static gpio_i2c_status_e i2c_bit(struct gpio_i2c_s *i2c, bool out, bool *in)
+{
+	gpio_i2c_status_e status;
+
+	i2c_line_set(&i2c->sda, !out);
+	i2c_wait(i2c, i2c->low_ns);
+	status = i2c_scl_release(i2c);
+	if (status)
+		return status;
+	i2c_wait(i2c, i2c->high_ns);
+	*in = i2c_line_get(&i2c->sda);
+	i2c_line_set(&i2c->scl, true);
+	return GPIO_I2C_STATUS_OK;
+}
+
+static gpio_i2c_status_e i2c_start(struct gpio_i2c_s *i2c)
+{
+	if (!i2c_line_get(&i2c->scl) || !i2c_line_get(&i2c->sda))
+		return GPIO_I2C_STATUS_BUS_BUSY;
+
+	i2c->next = gpio_steady_now_ns();
+	i2c_line_set(&i2c->sda, true);
+	i2c_wait(i2c, i2c->high_ns);
+	i2c_line_set(&i2c->scl, true);
+	return GPIO_I2C_STATUS_OK;
+}
+
+static gpio_i2c_status_e i2c_restart(struct gpio_i2c_s *i2c)
+{
+	gpio_i2c_status_e status;
+
+	i2c_line_set(&i2c->sda, false);
+	i2c_wait(i2c, i2c->low_ns);
+	status = i2c_scl_release(i2c);
+	if (status)
+		return status;
+	i2c_wait(i2c, i2c->high_ns);
+	i2c_line_set(&i2c->sda, true);
+	i2c_wait(i2c, i2c->high_ns);
+	i2c_line_set(&i2c->scl, true);
+	return GPIO_I2C_STATUS_OK;
+}
+
+/* Leaves the bus idle, with the bus free time before the next start */
+static gpio_i2c_status_e i2c_stop(struct gpio_i2c_s *i2c)
+{
+	gpio_i2c_status_e status;
+
+	i2c_line_set(&i2c->sda, true);
+	i2c_wait(i2c, i2c->low_ns);
+	status = i2c_scl_release(i2c);
+	if (status)
+		return status;
+	i2c_wait(i2c, i2c->high_ns);
+	i2c_line_set(&i2c->sda, false);
+	i2c_wait(i2c, i2c->low_ns);
+	return GPIO_I2C_STATUS_OK;
+}
+
+static gpio_i2c_status_e i2c_write_byte(struct gpio_i2c_s *i2c, uint8_t byte)
+{
+	gpio_i2c_status_e status;
+	bool in;
+
+	for (int n = 7; n >= 0; n--) {
+		status = i2c_bit(i2c, byte >> n & 1, &in);
+		if (status)
+			return status;
+	}
+
+	/* The slave pulls SDA low to acknowledge */
+	status = i2c_bit(i2c, true, &in);
+	if (status)
+		return status;
+	return in ? GPIO_I2C_STATUS_NACK : GPIO_I2C_STATUS_OK;
+}
+
+static gpio_i2c_status_e i2c_read_byte(struct gpio_i2c_s *i2c, uint8_t *byte, bool ack)
+{
+	gpio_i2c_status_e status;
+	uint8_t value = 0;
+	bool in;
+
+	for (int n = 7; n >= 0; n--) {
+		status = i2c_bit(i2c, true, &in);
+		if (status)
+			return status;
+		value |= in << n;
+	}
+	*byte = value;
+
+	/* The last byte of a read is not acknowledged, which ends it */
+	return i2c_bit(i2c, !ack, &in);
+}
+
+static gpio_i2c_status_e i2c_segment(struct gpio_i2c_s *i2c, const gpio_i2c_segment_s *segment)
+{
+	gpio_i2c_status_e status;
+
+	status = i2c_write_byte(i2c, segment->address << 1 | segment->read);
+	for (unsigned int i = 0; !status && i < segment->length; i++) {
+		if (segment->read)
+			status = i2c_read_byte(i2c, &segment->buffer[i], i + 1 < segment->length);
+		else
+			status = i2c_write_byte(i2c, segment->buffer[i]);
+	}
+	return status;
+}
+
+static gpio_i2c_status_e i2c_transaction(struct gpio_i2c_s *i2c, const gpio_i2c_transaction_s *transaction)
+{
+	gpio_i2c_status_e status, stop;
+
+	status = i2c_start(i2c);
+	if (status)
+		return status;
+
+	for (unsigned int s = 0; !status && s < transaction->segment_count; s++) {
+		if (s)
+			status = i2c_restart(i2c);
+		if (!status)
+			status = i2c_segment(i2c, &transaction->segments[s]);
+	}
+
+	/* A failed transaction still releases the bus, unless SCL is held low */
+	if (status == GPIO_I2C_STATUS_TIMEOUT) {
+		i2c_line_set(&i2c->sda, false);
+		return status;
+	}
+	stop = i2c_stop(i2c);
+	return status ? status : stop;
+}
+
+int gpio_i2c_create(gpio_pin_e scl, gpio_pin_e sda, gpio_i2c_h *i2c)
+{
+	struct gpio_i2c_s *_i2c;
+
+	_D("called gpio_i2c_create : scl[%d], sda[%d]", scl, sda);
+
+	if (!i2c || scl == sda)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* Both lines start released */
+	if (gpio_port_init() < 0 ||
+			gpio_pin_set_direction(scl, GPIO_IN) < 0 || gpio_pin_set_direction(sda, GPIO_IN) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_i2c = new(std::nothrow) struct gpio_i2c_s;
+	if (!_i2c)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	i2c_line_init(&_i2c->scl, scl, &_i2c->images[0]);
+	i2c_line_init(&_i2c->sda, sda, GET_PORT(scl) == GET_PORT(sda) ? &_i2c->images[0] : &_i2c->images[1]);
+	_i2c->stretch_timeout_ns = GPIO_I2C_STRETCH_TIMEOUT_US_DEFAULT * GPIO_NS_PER_US;
+	gpio_i2c_set_frequency(_i2c, GPIO_I2C_FREQUENCY_DEFAULT);
+
+	*i2c = _i2c;
+
+	_D("success gpio_i2c_create : i2c[0x%x]", _i2c);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_i2c_destroy(gpio_i2c_h i2c)
+{
+	_D("called gpio_i2c_destroy : i2c[0x%x]", i2c);
+
+	if (!i2c)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	delete i2c;
+
+	_D("success gpio_i2c_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_i2c_set_frequency(gpio_i2c_h i2c, unsigned int frequency_hz)
+{
+	uint64_t period_ns;
+
+	_D("called gpio_i2c_set_frequency : i2c[0x%x], frequency_hz[%u]", i2c, frequency_hz);
+
+	if (!i2c || !frequency_hz || frequency_hz > GPIO_I2C_FREQUENCY_MAX)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* Fast mode needs SCL low for 1.3 us out of 2.5: the low time gets 52% of the period */
+	period_ns = GPIO_NS_PER_SEC / frequency_hz;
+	i2c->low_ns = period_ns * 13 / 25;
+	i2c->high_ns = period_ns - i2c->low_ns;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_i2c_set_stretch_timeout(gpio_i2c_h i2c, unsigned int timeout_us)
+{
+	_D("called gpio_i2c_set_stretch_timeout : i2c[0x%x], timeout_us[%u]", i2c, timeout_us);
+
+	if (!i2c || !timeout_us)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	i2c->stretch_timeout_ns = timeout_us * GPIO_NS_PER_US;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_i2c_transfer(gpio_i2c_h i2c, gpio_i2c_transaction_s *transactions, unsigned int transaction_count)
+{
+	volatile uint32_t *data;
+	bool failed = false;
+
+	_D("called gpio_i2c_transfer : i2c[0x%x], transaction_count[%u]", i2c, transaction_count);
+
+	if (!i2c || (!transactions && transaction_count))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	for (unsigned int t = 0; t < transaction_count; t++) {
+		if (!transactions[t].segments && transactions[t].segment_count)
+			return GPIO_ERROR_INVALID_PARAMETER;
+		for (unsigned int s = 0; s < transactions[t].segment_count; s++) {
+			const gpio_i2c_segment_s *segment = &transactions[t].segments[s];
+
+			if (segment->address > 0x7f || (!segment->buffer && segment->length))
+				return GPIO_ERROR_INVALID_PARAMETER;
+		}
+	}
+
+	/* The other pins of the ports keep their configuration for the whole transfer */
+	*i2c->scl.image = *i2c->scl.config;
+	*i2c->sda.image = *i2c->sda.config;
+
+	data = i2c->scl.data;
+	*data = gpio_data_drive(*data, 0, i2c->scl.bit);
+	data = i2c->sda.data;
+	*data = gpio_data_drive(*data, 0, i2c->sda.bit);
+
+	/* Back to back, the bus free time after each stop as the only gap */
+	for (unsigned int t = 0; t < transaction_count; t++) {
+		i2c->stretches = 0;
+		transactions[t].status = i2c_transaction(i2c, &transactions[t]);
+		transactions[t].stretch_count = i2c->stretches;
+		failed |= transactions[t].status != GPIO_I2C_STATUS_OK;
+	}
+
+	_D("success gpio_i2c_transfer : failed[%d]", failed);
+
+	return failed ? GPIO_ERROR_IO_ERROR : GPIO_ERROR_NONE;
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <new>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+#define GPIO_KEYPAD_LINES_MAX 8
+#define GPIO_KEYPAD_SCAN_RATE_DEFAULT 200
+#define GPIO_KEYPAD_DEBOUNCE_MS_DEFAULT 20
+#define GPIO_KEYPAD_SETTLE_NS 1000 //columns settling after a row is driven
+
+/*
+ * Matrix keypad scanner. The rows are outputs on one port, the columns
+ * pulled-up inputs on one port. A scan reads the row port once, then for
+ * each row writes an image of the port with that row LOW and the others
+ * HIGH, and reads the columns with one read of their port: a pressed
+ * key pulls its column LOW. A last write leaves every row HIGH. A 4x4
+ * keypad thus takes 10 register accesses per scan.
+ *
+ * Keys are debounced one by one: a key changes state once it read the
+ * other state on debounce consecutive scans.
+ */
+struct gpio_keypad_s {
+	int row_count;
+	int column_count;
+	gpio_pin_e rows[GPIO_KEYPAD_LINES_MAX];
+	gpio_pin_e columns[GPIO_KEYPAD_LINES_MAX];
+	volatile uint32_t *row_data;
+	volatile uint32_t *column_data;
+	uint32_t row_bits[GPIO_KEYPAD_LINES_MAX];
+	uint32_t row_mask; //every row
+	uint32_t column_bits[GPIO_KEYPAD_LINES_MAX];
+
+	/* Owned by the scanning thread */
+	uint64_t stable; //bit row * 8 + column set while the key is down
+	uint8_t counts[GPIO_KEYPAD_LINES_MAX * GPIO_KEYPAD_LINES_MAX]; //scans the key read the other state
+
+	std::mutex lock;
+	std::condition_variable cond;
+	bool running;
+	uint64_t period_ns;
+	unsigned int debounce_ms;
+	unsigned int debounce_scans;
+	gpio_keypad_event_cb callback;
+	void *user_data;
+	std::atomic<uint64_t> pressed; //stable, for gpio_keypad_get_state()
+	std::thread thread;
+};
+
+/* Scans needed to cover the debounce time, at least one */
+static void keypad_set_debounce_scans(struct gpio_keypad_s *keypad)
+{
+	uint64_t scans = ((uint64_t)keypad->debounce_ms * 1000000 + keypad->period_ns - 1) / keypad->period_ns;
+
+	keypad->debounce_scans = scans < 1 ? 1 : scans > UINT8_MAX ? UINT8_MAX : scans;
+}
+
+/* Keys read down in this scan: each row is driven LOW in turn, the others HIGH */
+static uint64_t keypad_read(struct gpio_keypad_s *keypad)
+{
+	uint32_t idle = gpio_data_drive(*keypad->row_data, keypad->row_mask, 0);
+	uint64_t down = 0;
+
+	for (int r = 0; r < keypad->row_count; r++) {
+		uint64_t settle;
+		uint32_t columns;
+
+		*keypad->row_data = gpio_data_drive(idle, 0, keypad->row_bits[r]);
+		settle = gpio_steady_now_ns() + GPIO_KEYPAD_SETTLE_NS;
+		while (gpio_steady_now_ns() < settle)
+			;
+		columns = *keypad->column_data;
+		for (int c = 0; c < keypad->column_count; c++) {
+			if (!(columns & keypad->column_bits[c]))
+				down |= 1ULL << (r * GPIO_KEYPAD_LINES_MAX + c);
+		}
+	}
+	*keypad->row_data = idle;
+	return down;
+}
+
+static void keypad_scan(struct gpio_keypad_s *keypad, uint64_t now, unsigned int debounce_scans,
+		gpio_keypad_event_cb callback, void *user_data)
+{
+	uint64_t changed = keypad_read(keypad) ^ keypad->stable;
+
+	for (int k = 0; k < GPIO_KEYPAD_LINES_MAX * GPIO_KEYPAD_LINES_MAX; k++) {
+		gpio_keypad_event_s event;
+
+		if (!(changed >> k & 1)) {
+			keypad->counts[k] = 0;
+			continue;
+		}
+		if (++keypad->counts[k] < debounce_scans)
+			continue;
+
+		keypad->counts[k] = 0;
+		keypad->stable ^= 1ULL << k;
+		keypad->pressed.store(keypad->stable, std::memory_order_relaxed);
+		if (!callback)
+			continue;
+
+		event.row = k / GPIO_KEYPAD_LINES_MAX;
+		event.column = k % GPIO_KEYPAD_LINES_MAX;
+		event.pressed = keypad->stable >> k & 1;
+		event.timestamp_ns = now;
+		callback(keypad, &event, user_data);
+	}
+}
+
+static void keypad_run(struct gpio_keypad_s *keypad)
+{
+	gpio_clock_enter();
+
+	std::unique_lock<std::mutex> lock(keypad->lock);
+	uint64_t next = gpio_clock_now_ns();
+
+	while (keypad->running) {
+		uint64_t now = gpio_clock_now_ns();
+		unsigned int debounce_scans = keypad->debounce_scans;
+		gpio_keypad_event_cb callback = keypad->callback;
+		void *user_data = keypad->user_data;
+
+		if (now < next) {
+			gpio_clock_wait_until(lock, keypad->cond, next);
+			continue;
+		}
+
+		/* Scans missed while the thread was held up are skipped, not caught up */
+		next += keypad->period_ns;
+		if (next <= now)
+			next = now + keypad->period_ns;
+
+		lock.unlock();
+		keypad_scan(keypad, now, debounce_scans, callback, user_data);
+		lock.lock();
+	}
+}
+
+static bool keypad_lines_valid(const gpio_pin_e *pins, int count)
+{
+	if (!pins || count <= 0 || count > GPIO_KEYPAD_LINES_MAX)
+		return false;
+	for (int i = 0; i < count; i++) {
+		if (GET_PORT(pins[i]) != GET_PORT(pins[0]))
+			return false;
+		for (int j = 0; j < i; j++) {
+			if (pins[i] == pins[j])
+				return false;
+		}
+	}
+	return true;
+}
+
+int gpio_keypad_create(const gpio_pin_e *rows, int row_count, const gpio_pin_e *columns, int column_count,
+		gpio_keypad_h *keypad)
+{
+	struct gpio_keypad_s *_keypad;
+
+	_D("called gpio_keypad_create : rows[%d], columns[%d]", row_count, column_count);
+
+	if (!keypad || !keypad_lines_valid(rows, row_count) || !keypad_lines_valid(columns, column_count))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	for (int r = 0; r < row_count; r++) {
+		for (int c = 0; c < column_count; c++) {
+			if (rows[r] == columns[c])
+				return GPIO_ERROR_INVALID_PARAMETER;
+		}
+	}
+
+	if (gpio_port_init() < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_keypad = new(std::nothrow) struct gpio_keypad_s;
+	if (!_keypad)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_keypad->row_count = row_count;
+	_keypad->column_count = column_count;
+	_keypad->row_data = gpio_port_data((gpio_port_e)GET_PORT(rows[0]));
+	_keypad->column_data = gpio_port_data((gpio_port_e)GET_PORT(columns[0]));
+	_keypad->row_mask = 0;
+	for (int r = 0; r < row_count; r++) {
+		_keypad->rows[r] = rows[r];
+		_keypad->row_bits[r] = 1 << GET_OFFSET(rows[r]);
+		_keypad->row_mask |= _keypad->row_bits[r];
+	}
+	for (int c = 0; c < column_count; c++) {
+		_keypad->columns[c] = columns[c];
+		_keypad->column_bits[c] = 1 << GET_OFFSET(columns[c]);
+	}
+	_keypad->stable = 0;
+	memset(_keypad->counts, 0, sizeof(_keypad->counts));
+	_keypad->running = false;
+	_keypad->period_ns = GPIO_NS_PER_SEC / GPIO_KEYPAD_SCAN_RATE_DEFAULT;
+	_keypad->debounce_ms = GPIO_KEYPAD_DEBOUNCE_MS_DEFAULT;
+	keypad_set_debounce_scans(_keypad);
+	_keypad->callback = NULL;
+	_keypad->user_data = NULL;
+	_keypad->pressed = 0;
+
+	/* Every row idles HIGH */
+	*_keypad->row_data = gpio_data_drive(*_keypad->row_data, _keypad->row_mask, 0);
+	for (int i = 0; i < row_count + column_count; i++) {
+		gpio_pin_e pin = i < row_count ? rows[i] : columns[i - row_count];
+
+		if (gpio_pin_set_direction(pin, i < row_count ? GPIO_OUT : GPIO_IN) < 0) {
+			delete _keypad;
+			return GPIO_ERROR_IO_ERROR;
+		}
+	}
+
+	*keypad = _keypad;
+
+	_D("success gpio_keypad_create : keypad[0x%x]", _keypad);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_destroy(gpio_keypad_h keypad)
+{
+	_D("called gpio_keypad_destroy : keypad[0x%x]", keypad);
+
+	if (!keypad)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	gpio_keypad_stop(keypad);
+	delete keypad;
+
+	_D("success gpio_keypad_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_set_scan_rate(gpio_keypad_h keypad, unsigned int scan_rate)
+{
+	_D("called gpio_keypad_set_scan_rate : keypad[0x%x], scan_rate[%u]", keypad, scan_rate);
+
+	if (!keypad || !scan_rate || scan_rate > GPIO_NS_PER_SEC / GPIO_KEYPAD_SETTLE_NS)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(keypad->lock);
+
+	keypad->period_ns = GPIO_NS_PER_SEC / scan_rate;
+	keypad_set_debounce_scans(keypad);
+	gpio_clock_notify(keypad->cond);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_set_debounce(gpio_keypad_h keypad, unsigned int debounce_ms)
+{
+	_D("called gpio_keypad_set_debounce : keypad[0x%x], debounce_ms[%u]", keypad, debounce_ms);
+
+	if (!keypad)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(keypad->lock);
+
+	keypad->debounce_ms = debounce_ms;
+	keypad_set_debounce_scans(keypad);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_set_event_cb(gpio_keypad_h keypad, gpio_keypad_event_cb callback, void *user_data)
+{
+	_D("called gpio_keypad_set_event_cb : keypad[0x%x]", keypad);
+
+	if (!keypad)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(keypad->lock);
+
+	keypad->callback = callback;
+	keypad->user_data = user_data;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_start(gpio_keypad_h keypad)
+{
+	_D("called gpio_keypad_start : keypad[0x%x]", keypad);
+
+	if (!keypad)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(keypad->lock);
+
+	if (keypad->running)
+		return GPIO_ERROR_NONE;
+
+	keypad->running = true;
+	gpio_clock_hold();
+	try {
+		keypad->thread = std::thread(keypad_run, keypad);
+	} catch (...) {
+		gpio_clock_release();
+		keypad->running = false;
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	_D("success gpio_keypad_start");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_stop(gpio_keypad_h keypad)
+{
+	_D("called gpio_keypad_stop : keypad[0x%x]", keypad);
+
+	if (!keypad)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	{
+		std::lock_guard<std::mutex> lock(keypad->lock);
+
+		keypad->running = false;
+		gpio_clock_notify(keypad->cond);
+	}
+	if (keypad->thread.joinable())
+		keypad->thread.join();
+
+	_D("success gpio_keypad_stop");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_keypad_get_state(gpio_keypad_h keypad, unsigned long long *pressed)
+{
+	if (!keypad || !pressed)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*pressed = keypad->pressed.load(std::memory_order_relaxed);
+
+	return GPIO_ERROR_NONE;
+}
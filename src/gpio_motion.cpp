@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <new>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+#define GPIO_MOTION_PULSE_NS_DEFAULT 2000
+#define GPIO_MOTION_DIR_SETUP_NS_DEFAULT 1000
+#define GPIO_MOTION_DIR_HOLD_NS_DEFAULT 1000
+#define GPIO_MOTION_PRIORITY 50
+
+/*
+ * Step/direction pulse generator. Queuing a move plans it right away, in
+ * the caller's thread: the time of every step, in ns from the start of
+ * the move, goes to a buffer. The timing thread of the motor then only
+ * waits for each time and pulses the step pin, sleeping through long
+ * gaps up to the wake-up jitter and spinning the rest.
+ *
+ * Moves play back to back: a move starts where the previous one ended
+ * on the timeline, whenever the thread got to it, so there is no gap
+ * between segments. The last step of a move is at its end, so with
+ * matching end and start rates the step rate carries across. Only a
+ * change of direction can push a move back, to leave the hold time
+ * after the last pulse and the setup time before the next one.
+ */
+struct gpio_motion_plan_s {
+	bool forward;
+	unsigned long long count;
+	uint64_t *times; //of each step, in ns from the start of the move; the last one is the end
+	uint64_t generation; //of gpio_motion_stop() calls, at queue time
+};
+
+struct gpio_motion_s {
+	gpio_pin_e step;
+	gpio_pin_e dir;
+	volatile uint32_t *step_data;
+	volatile uint32_t *dir_data;
+	uint32_t step_bit;
+	uint32_t dir_bit;
+	std::atomic<uint32_t> pulse_ns;
+	std::atomic<uint32_t> dir_setup_ns;
+	std::atomic<uint32_t> dir_hold_ns;
+
+	std::mutex lock;
+	std::condition_variable cond;
+	std::atomic<bool> running; //changed under the lock, read on every step
+	bool busy; //playing a move
+	std::atomic<uint64_t> generation; //of gpio_motion_stop() calls, as running
+	std::deque<struct gpio_motion_plan_s *> queue;
+	std::thread thread;
+
+	/* Statistics, under the lock but for the counters the thread bumps on every step */
+	std::atomic<long long> position;
+	std::atomic<unsigned long long> step_count;
+	unsigned long long move_count;
+	uint64_t max_late_ns;
+	uint64_t total_late_ns;
+	double planned_rate;
+	double achieved_rate;
+};
+
+/* Part of a move where the rate goes from v0 to v1 in t_total seconds, linearly or along a half cosine */
+struct motion_ramp_s {
+	double v0;
+	double v1;
+	double t_total;
+	bool s_curve;
+};
+
+static double ramp_position(const struct motion_ramp_s *ramp, double t)
+{
+	double dv = ramp->v1 - ramp->v0;
+
+	if (ramp->s_curve)
+		return ramp->v0 * t + dv / 2 * (t - ramp->t_total / M_PI * sin(M_PI * t / ramp->t_total));
+	return ramp->v0 * t + dv * t * t / (2 * ramp->t_total);
+}
+
+static double ramp_rate(const struct motion_ramp_s *ramp, double t)
+{
+	double dv = ramp->v1 - ramp->v0;
+
+	if (ramp->s_curve)
+		return ramp->v0 + dv * (1 - cos(M_PI * t / ramp->t_total)) / 2;
+	return ramp->v0 + dv * t / ramp->t_total;
+}
+
+/* Time at which the ramp reaches position @x, by Newton's method kept inside a bracket */
+static double ramp_time(const struct motion_ramp_s *ramp, double x, double guess)
+{
+	double lo = 0, hi = ramp->t_total;
+	double t = guess < lo || guess > hi ? hi / 2 : guess;
+
+	for (int i = 0; i < 64 && hi - lo > 1e-12; i++) {
+		double f = ramp_position(ramp, t) - x;
+		double v = ramp_rate(ramp, t);
+		double next;
+
+		if (fabs(f) < 1e-9)
+			break;
+		if (f > 0)
+			hi = t;
+		else
+			lo = t;
+		next = v > 0 ? t - f / v : (lo + hi) / 2;
+		t = next <= lo || next >= hi ? (lo + hi) / 2 : next;
+	}
+	return t;
+}
+
+/*
+ * Plans the step times of @move: a ramp up from the start rate, a cruise
+ * at the top rate, and a ramp down to the end rate. When the move is too
+ * short to reach the maximum rate, the top rate is where both ramps meet.
+ */
+static int motion_plan(const gpio_motion_move_s *move, struct gpio_motion_plan_s *plan)
+{
+	unsigned long long n = move->steps < 0 ? -move->steps : move->steps;
+	struct motion_ramp_s up, down;
+	double vp, d_up, d_down, d_cruise, t_cruise, t = 0;
+
+	/* The S-curve ramps cover pi / 2 times the distance of linear ones with the same peak acceleration */
+	double k = move->profile == GPIO_MOTION_PROFILE_S_CURVE ? M_PI / 2 : 1;
+	double a = move->acceleration;
+	double v0 = move->start_rate, v1 = move->end_rate;
+
+	if (!n || !(move->max_rate > 0) || a < 0 || v0 < 0 || v1 < 0 || v0 > move->max_rate || v1 > move->max_rate)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (a > 0) {
+		if (k * fabs(v1 * v1 - v0 * v0) / (2 * a) > n)
+			return GPIO_ERROR_INVALID_PARAMETER;
+		vp = fmin(move->max_rate, sqrt((2 * a * n / k + v0 * v0 + v1 * v1) / 2));
+	} else {
+		vp = v0 = v1 = move->max_rate;
+	}
+
+	up.v0 = v0;
+	up.v1 = vp;
+	up.t_total = a > 0 ? k * (vp - v0) / a : 0;
+	up.s_curve = k != 1;
+	down.v0 = vp;
+	down.v1 = v1;
+	down.t_total = a > 0 ? k * (vp - v1) / a : 0;
+	down.s_curve = k != 1;
+
+	d_up = (v0 + vp) / 2 * up.t_total;
+	d_down = (vp + v1) / 2 * down.t_total;
+	d_cruise = fmax(0, n - d_up - d_down);
+	t_cruise = d_cruise / vp;
+
+	plan->times = new(std::nothrow) uint64_t[n];
+	if (!plan->times)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	plan->count = n;
+	plan->forward = move->steps > 0;
+
+	for (unsigned long long s = 1; s <= n; s++) {
+		double x = s;
+
+		if (x <= d_up)
+			t = ramp_time(&up, x, t);
+		else if (x <= d_up + d_cruise || !down.t_total)
+			t = up.t_total + (x - d_up) / vp;
+		else
+			t = up.t_total + t_cruise + ramp_time(&down, x - d_up - d_cruise, t - up.t_total - t_cruise);
+		plan->times[s - 1] = (uint64_t)llround(t * GPIO_NS_PER_SEC);
+	}
+
+	/* The end of the move is its last step, also when rounding left it short of the ramp */
+	if (a > 0)
+		plan->times[n - 1] = (uint64_t)llround((up.t_total + t_cruise + down.t_total) * GPIO_NS_PER_SEC);
+
+	return GPIO_ERROR_NONE;
+}
+
+static void motion_free(struct gpio_motion_plan_s *plan)
+{
+	delete[] plan->times;
+	delete plan;
+}
+
+static bool motion_stopped(struct gpio_motion_s *motion, uint64_t generation)
+{
+	return motion->generation.load(std::memory_order_relaxed) != generation ||
+		!motion->running.load(std::memory_order_relaxed);
+}
+
+/* Waits for @due_ns: sleeps up to the wake-up jitter before it, then spins; false as soon as stopped */
+static bool motion_wait(struct gpio_motion_s *motion, uint64_t due_ns, uint64_t generation)
+{
+	uint64_t early = gpio_calibration.wakeup_jitter_ns;
+	uint64_t now = gpio_steady_now_ns();
+
+	if (due_ns > now + early + GPIO_SLEEP_MIN_NS) {
+		std::unique_lock<std::mutex> lock(motion->lock);
+
+		motion->cond.wait_for(lock, std::chrono::nanoseconds(due_ns - early - now),
+				[&] { return motion_stopped(motion, generation); });
+	}
+
+	/* Fast moves only spin, so a stop is also looked for while spinning */
+	while (gpio_steady_now_ns() < due_ns) {
+		if (motion_stopped(motion, generation))
+			return false;
+	}
+	return !motion_stopped(motion, generation);
+}
+
+static void motion_run(struct gpio_motion_s *motion)
+{
+	struct sched_param param;
+	bool forward = true;
+	bool anchored = false; //end is where the next move starts
+	uint64_t end = 0;
+	uint64_t last_fall = 0;
+
+	param.sched_priority = GPIO_MOTION_PRIORITY;
+	if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+		_W("Motion thread runs without real-time priority");
+
+	std::unique_lock<std::mutex> lock(motion->lock);
+	while (motion->running) {
+		struct gpio_motion_plan_s *plan;
+		uint64_t start, now, first = 0, late_max = 0, late_total = 0;
+		unsigned long long done = 0;
+		uint32_t pulse_ns = motion->pulse_ns;
+
+		if (motion->queue.empty()) {
+			motion->busy = false;
+			anchored = false;
+			motion->cond.wait(lock);
+			continue;
+		}
+		plan = motion->queue.front();
+		motion->queue.pop_front();
+		motion->busy = true;
+		lock.unlock();
+
+		now = gpio_steady_now_ns();
+		start = anchored ? end : now;
+		if (plan->forward != forward) {
+			uint64_t dir_at = std::max(now, last_fall + motion->dir_hold_ns);
+
+			while (gpio_steady_now_ns() < dir_at)
+				;
+			*motion->dir_data = plan->forward ? gpio_data_drive(*motion->dir_data, motion->dir_bit, 0) :
+				gpio_data_drive(*motion->dir_data, 0, motion->dir_bit);
+			forward = plan->forward;
+			start = std::max(start, dir_at + motion->dir_setup_ns);
+		}
+
+		for (; done < plan->count; done++) {
+			uint64_t due = start + plan->times[done];
+
+			if (!motion_wait(motion, due, plan->generation))
+				break;
+			*motion->step_data = gpio_data_drive(*motion->step_data, motion->step_bit, 0);
+			now = gpio_steady_now_ns();
+			while (gpio_steady_now_ns() < now + pulse_ns)
+				;
+			*motion->step_data = gpio_data_drive(*motion->step_data, 0, motion->step_bit);
+			last_fall = gpio_steady_now_ns();
+
+			motion->position.fetch_add(forward ? 1 : -1, std::memory_order_relaxed);
+			motion->step_count.fetch_add(1, std::memory_order_relaxed);
+			late_max = std::max(late_max, now - due);
+			late_total += now - due;
+			if (!done)
+				first = now;
+		}
+
+		/* A stopped move leaves the timeline; the next one starts afresh */
+		anchored = done == plan->count;
+		end = start + plan->times[plan->count - 1];
+
+		lock.lock();
+		if (done == plan->count) {
+			motion->move_count++;
+			if (done > 1) {
+				motion->planned_rate = (double)(done - 1) * GPIO_NS_PER_SEC /
+					(plan->times[done - 1] - plan->times[0]);
+				motion->achieved_rate = (double)(done - 1) * GPIO_NS_PER_SEC / (now - first);
+			}
+		}
+		motion->max_late_ns = std::max(motion->max_late_ns, late_max);
+		motion->total_late_ns += late_total;
+		motion_free(plan);
+	}
+}
+
+int gpio_motion_create(gpio_pin_e step, gpio_pin_e dir, gpio_motion_h *motion)
+{
+	struct gpio_motion_s *_motion;
+
+	_D("called gpio_motion_create : step[%d], dir[%d]", step, dir);
+
+	if (!motion || step == dir)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_port_init() < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_motion = new(std::nothrow) struct gpio_motion_s;
+	if (!_motion)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_motion->step = step;
+	_motion->dir = dir;
+	_motion->step_data = gpio_port_data((gpio_port_e)GET_PORT(step));
+	_motion->dir_data = gpio_port_data((gpio_port_e)GET_PORT(dir));
+	_motion->step_bit = 1 << GET_OFFSET(step);
+	_motion->dir_bit = 1 << GET_OFFSET(dir);
+	_motion->pulse_ns = GPIO_MOTION_PULSE_NS_DEFAULT;
+	_motion->dir_setup_ns = GPIO_MOTION_DIR_SETUP_NS_DEFAULT;
+	_motion->dir_hold_ns = GPIO_MOTION_DIR_HOLD_NS_DEFAULT;
+	_motion->running = true;
+	_motion->busy = false;
+	_motion->generation = 0;
+	_motion->position = 0;
+	_motion->step_count = 0;
+	_motion->move_count = 0;
+	_motion->max_late_ns = 0;
+	_motion->total_late_ns = 0;
+	_motion->planned_rate = 0;
+	_motion->achieved_rate = 0;
+
+	/* Step idles LOW, direction starts forward, HIGH */
+	*_motion->step_data = gpio_data_drive(*_motion->step_data, 0, _motion->step_bit);
+	*_motion->dir_data = gpio_data_drive(*_motion->dir_data, _motion->dir_bit, 0);
+	if (gpio_pin_set_direction(step, GPIO_OUT) < 0 || gpio_pin_set_direction(dir, GPIO_OUT) < 0) {
+		delete _motion;
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	try {
+		_motion->thread = std::thread(motion_run, _motion);
+	} catch (...) {
+		delete _motion;
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	*motion = _motion;
+
+	_D("success gpio_motion_create : motion[0x%x]", _motion);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_motion_destroy(gpio_motion_h motion)
+{
+	_D("called gpio_motion_destroy : motion[0x%x]", motion);
+
+	if (!motion)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	{
+		std::lock_guard<std::mutex> lock(motion->lock);
+
+		motion->running = false;
+		motion->cond.notify_all();
+	}
+	motion->thread.join();
+
+	while (!motion->queue.empty()) {
+		motion_free(motion->queue.front());
+		motion->queue.pop_front();
+	}
+	delete motion;
+
+	_D("success gpio_motion_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_motion_set_timing(gpio_motion_h motion, unsigned int pulse_ns, unsigned int dir_setup_ns,
+		unsigned int dir_hold_ns)
+{
+	_D("called gpio_motion_set_timing : motion[0x%x], pulse_ns[%u], dir_setup_ns[%u], dir_hold_ns[%u]",
+			motion, pulse_ns, dir_setup_ns, dir_hold_ns);
+
+	if (!motion || !pulse_ns)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	motion->pulse_ns = pulse_ns;
+	motion->dir_setup_ns = dir_setup_ns;
+	motion->dir_hold_ns = dir_hold_ns;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_motion_queue(gpio_motion_h motion, const gpio_motion_move_s *move)
+{
+	struct gpio_motion_plan_s *plan;
+	unsigned long long count;
+	uint64_t duration_ns;
+	int error;
+
+	_D("called gpio_motion_queue : motion[0x%x]", motion);
+
+	if (!motion || !move)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	plan = new(std::nothrow) struct gpio_motion_plan_s;
+	if (!plan)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	plan->times = NULL;
+	error = motion_plan(move, plan);
+	if (error != GPIO_ERROR_NONE) {
+		delete plan;
+		return error;
+	}
+
+	/* Once queued, the plan belongs to the motion thread, which frees it when played or stopped */
+	count = plan->count;
+	duration_ns = plan->times[count - 1];
+
+	try {
+		std::lock_guard<std::mutex> lock(motion->lock);
+
+		plan->generation = motion->generation;
+		motion->queue.push_back(plan);
+		motion->cond.notify_all();
+	} catch (...) {
+		motion_free(plan);
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	_D("success gpio_motion_queue : %llu steps, %.3f s", count, (double)duration_ns / GPIO_NS_PER_SEC);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_motion_stop(gpio_motion_h motion)
+{
+	_D("called gpio_motion_stop : motion[0x%x]", motion);
+
+	if (!motion)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(motion->lock);
+
+	/* The move being played sees the generation change before its next step */
+	motion->generation++;
+	while (!motion->queue.empty()) {
+		motion_free(motion->queue.front());
+		motion->queue.pop_front();
+	}
+	motion->cond.notify_all();
+
+	_D("success gpio_motion_stop");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_motion_get_stats(gpio_motion_h motion, gpio_motion_stats_s *stats)
+{
+	if (!motion || !stats)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(motion->lock);
+	unsigned long long steps = motion->step_count.load(std::memory_order_relaxed);
+
+	stats->busy = motion->busy || !motion->queue.empty();
+	stats->queued_moves = motion->queue.size();
+	stats->position = motion->position.load(std::memory_order_relaxed);
+	stats->step_count = steps;
+	stats->move_count = motion->move_count;
+	stats->max_late_ns = motion->max_late_ns;
+	stats->mean_late_ns = steps ? (double)motion->total_late_ns / steps : 0;
+	stats->planned_rate = motion->planned_rate;
+	stats->achieved_rate = motion->achieved_rate;
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,560 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+#define GPIO_NS_PER_S 1000000000.0
+#define GPIO_PWM_FREQUENCY_MIN 0.01
+#define GPIO_PWM_PERIOD_MIN_NS 10000 //100 kHz
+#define GPIO_OUTPUT_IDLE_NS 1000000000ULL
+#define GPIO_OUTPUT_PRIORITY 50
+#define GPIO_OUTPUT_BATCH_PORTS 8
+#define GPIO_OUTPUT_REPORTS 1024
+
+/*
+ * Timed outputs, PWM channels and scheduled writes, are driven by one
+ * thread from a min-heap of their next events.
+ *
+ * A PWM channel has a single event in the heap at a time: the start of
+ * its next period, where it goes HIGH and where new settings take effect,
+ * or the end of its HIGH phase. Events made stale by gpio_pwm_set() or
+ * gpio_pwm_unset() are left in the heap, and skipped by their generation.
+ * A scheduled write is an event of its own, until it is done.
+ *
+ * Every event due when the thread wakes is applied in one batch, with a
+ * single write per port. PWM periods start on multiples of the period on
+ * the clock, so channels of the same frequency rise at the same instant
+ * and share the write.
+ */
+struct gpio_pwm_channel_s {
+	gpio_pin_e pin;
+	volatile uint32_t *data; //data register of the port
+	uint32_t bit;
+	uint64_t period_ns;
+	uint64_t high_ns; //0 or period_ns for a constant level
+	uint64_t next_period_ns; //settings for the next period
+	uint64_t next_high_ns;
+	uint64_t rise_ns; //start of the current period
+	uint32_t generation;
+	bool used;
+	bool scheduled; //if it has an event in the heap
+};
+
+enum gpio_output_event_type_e {
+	OUTPUT_PWM_RISE, //start of a period
+	OUTPUT_PWM_FALL,
+	OUTPUT_WRITE,
+};
+
+struct gpio_output_event_s {
+	uint64_t time_ns;
+	uint64_t seq; //events due at the same time are applied in the order they were queued
+	int type;
+	uint32_t channel; //PWM events
+	uint32_t generation;
+	gpio_pin_e pin; //writes
+	gpio_value_e value;
+	volatile uint32_t *data;
+};
+
+/* Pins to drive in one batch, by port */
+struct gpio_output_batch_s {
+	volatile uint32_t *data[GPIO_OUTPUT_BATCH_PORTS];
+	uint32_t high[GPIO_OUTPUT_BATCH_PORTS];
+	uint32_t low[GPIO_OUTPUT_BATCH_PORTS];
+	int count;
+};
+
+struct gpio_output_engine_s {
+	std::mutex lock;
+	std::condition_variable cond;
+	bool running;
+	uint64_t seq;
+	std::vector<gpio_pwm_channel_s> channels;
+	std::vector<gpio_output_event_s> heap;
+	std::vector<gpio_output_event_s> done; //writes of the current batch, to report
+
+	/* Reports of the writes done, oldest dropped when full */
+	gpio_output_report_s reports[GPIO_OUTPUT_REPORTS];
+	unsigned int report_head;
+	unsigned int report_count;
+	unsigned long long report_lost;
+};
+
+/* Never destroyed, as the detached thread may still use it at exit */
+static struct gpio_output_engine_s *output = new struct gpio_output_engine_s();
+
+static bool event_later(const gpio_output_event_s &a, const gpio_output_event_s &b)
+{
+	return a.time_ns != b.time_ns ? a.time_ns > b.time_ns : a.seq > b.seq;
+}
+
+static void output_push(gpio_output_event_s &event)
+{
+	event.seq = output->seq++;
+	output->heap.push_back(event);
+	std::push_heap(output->heap.begin(), output->heap.end(), event_later);
+}
+
+static void pwm_push(uint32_t channel, uint64_t time_ns, bool rising)
+{
+	gpio_output_event_s event;
+
+	event.time_ns = time_ns;
+	event.type = rising ? OUTPUT_PWM_RISE : OUTPUT_PWM_FALL;
+	event.channel = channel;
+	event.generation = output->channels[channel].generation;
+	output_push(event);
+}
+
+static void output_batch_flush(struct gpio_output_batch_s *batch)
+{
+	for (int p = 0; p < batch->count; p++)
+		*batch->data[p] = gpio_data_drive(*batch->data[p], batch->high[p], batch->low[p]);
+	batch->count = 0;
+}
+
+/* The last level set for a pin in a batch wins */
+static void output_batch_add(struct gpio_output_batch_s *batch, volatile uint32_t *data, uint32_t bit,
+		gpio_value_e value)
+{
+	int p;
+
+	for (p = 0; p < batch->count; p++) {
+		if (batch->data[p] == data)
+			break;
+	}
+	if (p == batch->count) {
+		if (p == GPIO_OUTPUT_BATCH_PORTS) {
+			output_batch_flush(batch);
+			p = 0;
+		}
+		batch->data[p] = data;
+		batch->high[p] = 0;
+		batch->low[p] = 0;
+		batch->count++;
+	}
+
+	if (value) {
+		batch->high[p] |= bit;
+		batch->low[p] &= ~bit;
+	} else {
+		batch->low[p] |= bit;
+		batch->high[p] &= ~bit;
+	}
+}
+
+static void pwm_rise(uint32_t channel, uint64_t time_ns, struct gpio_output_batch_s *batch)
+{
+	gpio_pwm_channel_s *ch = &output->channels[channel];
+
+	ch->period_ns = ch->next_period_ns;
+	ch->high_ns = ch->next_high_ns;
+	ch->rise_ns = time_ns;
+
+	output_batch_add(batch, ch->data, ch->bit, ch->high_ns ? HIGH : LOW);
+	if (!ch->high_ns || ch->high_ns >= ch->period_ns) {
+		ch->scheduled = false;
+		return;
+	}
+	pwm_push(channel, time_ns + ch->high_ns, false);
+}
+
+static void pwm_fall(uint32_t channel, uint64_t now, struct gpio_output_batch_s *batch)
+{
+	gpio_pwm_channel_s *ch = &output->channels[channel];
+	uint64_t next = ch->rise_ns + ch->period_ns;
+
+	output_batch_add(batch, ch->data, ch->bit, LOW);
+
+	/* Periods missed while the thread was late are dropped, not played in a burst */
+	if (next <= now)
+		next += ((now - next) / ch->period_ns + 1) * ch->period_ns;
+	pwm_push(channel, next, true);
+}
+
+static void output_report(const gpio_output_event_s &event, uint64_t actual_ns)
+{
+	gpio_output_report_s *report;
+
+	if (output->report_count == GPIO_OUTPUT_REPORTS) {
+		output->report_head = (output->report_head + 1) % GPIO_OUTPUT_REPORTS;
+		output->report_count--;
+		output->report_lost++;
+	}
+	report = &output->reports[(output->report_head + output->report_count++) % GPIO_OUTPUT_REPORTS];
+	report->pin = event.pin;
+	report->value = event.value;
+	report->time_ns = event.time_ns;
+	report->error_ns = (long long)(actual_ns - event.time_ns);
+}
+
+/* Applies every event due at @now; called with output->lock held */
+static void output_fire(uint64_t now)
+{
+	struct gpio_output_batch_s batch;
+	uint64_t actual_ns;
+
+	batch.count = 0;
+	output->done.clear();
+	while (!output->heap.empty() && output->heap.front().time_ns <= now) {
+		gpio_output_event_s event = output->heap.front();
+
+		std::pop_heap(output->heap.begin(), output->heap.end(), event_later);
+		output->heap.pop_back();
+
+		if (event.type == OUTPUT_WRITE) {
+			output_batch_add(&batch, event.data, 1 << GET_OFFSET(event.pin), event.value);
+			output->done.push_back(event);
+			continue;
+		}
+
+		const gpio_pwm_channel_s &ch = output->channels[event.channel];
+
+		if (!ch.used || event.generation != ch.generation)
+			continue;
+		if (event.type == OUTPUT_PWM_RISE)
+			pwm_rise(event.channel, event.time_ns, &batch);
+		else
+			pwm_fall(event.channel, now, &batch);
+	}
+	output_batch_flush(&batch);
+
+	actual_ns = gpio_clock_now_ns();
+	for (size_t i = 0; i < output->done.size(); i++)
+		output_report(output->done[i], actual_ns);
+}
+
+static void output_run(void)
+{
+	struct sched_param param;
+
+	gpio_clock_enter();
+
+	param.sched_priority = GPIO_OUTPUT_PRIORITY;
+	if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+		_W("Output thread runs without real-time priority");
+
+	std::unique_lock<std::mutex> lock(output->lock);
+	while (1) {
+		uint64_t now = gpio_clock_now_ns();
+		uint64_t early = gpio_clock_is_virtual() ? 0 : gpio_calibration.wakeup_jitter_ns;
+		uint64_t deadline;
+
+		if (output->heap.empty()) {
+			gpio_clock_wait_until(lock, output->cond, now + GPIO_OUTPUT_IDLE_NS);
+			continue;
+		}
+
+		/* Sleeps until the wake-up jitter before the event, then spins the rest */
+		deadline = output->heap.front().time_ns;
+		if (now + early < deadline) {
+			gpio_clock_wait_until(lock, output->cond, deadline - early);
+			continue;
+		}
+		while (now < deadline)
+			now = gpio_clock_now_ns();
+
+		output_fire(now);
+	}
+}
+
+/* Starts the thread if needed; called with output->lock held */
+static int output_start(void)
+{
+	if (output->running)
+		return GPIO_ERROR_NONE;
+
+	gpio_clock_hold();
+	try {
+		std::thread output_thread(output_run);
+		output_thread.detach();
+	} catch (...) {
+		gpio_clock_release();
+		return GPIO_ERROR_IO_ERROR;
+	}
+	output->running = true;
+	return GPIO_ERROR_NONE;
+}
+
+static gpio_pwm_channel_s *pwm_find(gpio_pin_e pin)
+{
+	for (size_t i = 0; i < output->channels.size(); i++) {
+		if (output->channels[i].used && output->channels[i].pin == pin)
+			return &output->channels[i];
+	}
+	return NULL;
+}
+
+/* Returns the index of a free channel for @pin, or -1 */
+static int pwm_alloc(gpio_pin_e pin, volatile uint32_t *data)
+{
+	size_t i;
+
+	for (i = 0; i < output->channels.size(); i++) {
+		if (!output->channels[i].used)
+			break;
+	}
+	if (i == output->channels.size()) {
+		try {
+			output->channels.push_back(gpio_pwm_channel_s());
+		} catch (...) {
+			return -1;
+		}
+		output->channels[i].generation = 0;
+	}
+
+	output->channels[i].pin = pin;
+	output->channels[i].data = data;
+	output->channels[i].bit = 1 << GET_OFFSET(pin);
+	output->channels[i].used = true;
+	output->channels[i].scheduled = false;
+	return i;
+}
+
+int gpio_pwm_set(gpio_pin_e pin, double frequency_hz, double duty)
+{
+	volatile uint32_t *data;
+	gpio_pwm_channel_s *ch;
+	uint64_t period_ns, high_ns;
+	int channel;
+
+	_D("called gpio_pwm_set : pin[%d], frequency_hz[%f], duty[%f]", pin, frequency_hz, duty);
+
+	if (!(frequency_hz >= GPIO_PWM_FREQUENCY_MIN) || !(duty >= 0 && duty <= 1))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	period_ns = llround(GPIO_NS_PER_S / frequency_hz);
+	if (period_ns < GPIO_PWM_PERIOD_MIN_NS)
+		return GPIO_ERROR_INVALID_PARAMETER;
+	high_ns = llround(period_ns * duty);
+
+	if (gpio_port_init() < 0 || gpio_pin_set_direction(pin, GPIO_OUT) < 0)
+		return GPIO_ERROR_IO_ERROR;
+	data = gpio_port_data((gpio_port_e)GET_PORT(pin));
+	if (!data)
+		return GPIO_ERROR_IO_ERROR;
+
+	{
+		std::lock_guard<std::mutex> lock(output->lock);
+
+		ch = pwm_find(pin);
+		if (ch) {
+			channel = ch - &output->channels[0];
+		} else {
+			channel = pwm_alloc(pin, data);
+			if (channel < 0)
+				return GPIO_ERROR_OUT_OF_MEMORY;
+			ch = &output->channels[channel];
+		}
+
+		/* A running channel switches at the start of its next period, without a glitch */
+		ch->next_period_ns = period_ns;
+		ch->next_high_ns = high_ns;
+		if (!ch->scheduled) {
+			uint64_t now = gpio_clock_now_ns();
+
+			ch->generation++;
+			ch->scheduled = true;
+			if (!high_ns || high_ns == period_ns)
+				pwm_push(channel, now, true);
+			else
+				pwm_push(channel, (now / period_ns + 1) * period_ns, true);
+		}
+
+		if (output_start() != GPIO_ERROR_NONE) {
+			ch->used = false;
+			return GPIO_ERROR_IO_ERROR;
+		}
+	}
+	gpio_clock_notify(output->cond);
+
+	_D("success gpio_pwm_set : period_ns[%llu], high_ns[%llu]",
+			(unsigned long long)period_ns, (unsigned long long)high_ns);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pwm_unset(gpio_pin_e pin)
+{
+	gpio_pwm_channel_s *ch;
+
+	_D("called gpio_pwm_unset : pin[%d]", pin);
+
+	{
+		std::lock_guard<std::mutex> lock(output->lock);
+
+		ch = pwm_find(pin);
+		if (!ch)
+			return GPIO_ERROR_INVALID_PARAMETER;
+
+		/* Its events left in the heap become stale */
+		ch->generation++;
+		ch->used = false;
+		ch->scheduled = false;
+		*ch->data = gpio_data_drive(*ch->data, 0, ch->bit);
+	}
+	gpio_clock_notify(output->cond);
+
+	_D("success gpio_pwm_unset");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pwm_get(gpio_pin_e pin, double *frequency_hz, double *duty)
+{
+	std::lock_guard<std::mutex> lock(output->lock);
+	gpio_pwm_channel_s *ch;
+
+	if (!frequency_hz || !duty)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	ch = pwm_find(pin);
+	if (!ch)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*frequency_hz = GPIO_NS_PER_S / ch->next_period_ns;
+	*duty = (double)ch->next_high_ns / ch->next_period_ns;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_output_schedule(const gpio_output_edge_s *edges, unsigned int edge_count)
+{
+	std::vector<volatile uint32_t *> data;
+	int error;
+
+	_D("called gpio_output_schedule : edge_count[%u]", edge_count);
+
+	if (!edges || !edge_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_port_init() < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	try {
+		data.resize(edge_count);
+	} catch (...) {
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+	for (unsigned int i = 0; i < edge_count; i++) {
+		if (gpio_pin_set_direction(edges[i].pin, GPIO_OUT) < 0)
+			return GPIO_ERROR_IO_ERROR;
+		data[i] = gpio_port_data((gpio_port_e)GET_PORT(edges[i].pin));
+		if (!data[i])
+			return GPIO_ERROR_IO_ERROR;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(output->lock);
+
+		/* A pin is either driven by PWM or by scheduled writes */
+		for (unsigned int i = 0; i < edge_count; i++) {
+			if (pwm_find(edges[i].pin))
+				return GPIO_ERROR_INVALID_PARAMETER;
+		}
+
+		try {
+			output->heap.reserve(output->heap.size() + edge_count);
+		} catch (...) {
+			return GPIO_ERROR_OUT_OF_MEMORY;
+		}
+		for (unsigned int i = 0; i < edge_count; i++) {
+			gpio_output_event_s event;
+
+			event.time_ns = edges[i].time_ns;
+			event.type = OUTPUT_WRITE;
+			event.pin = edges[i].pin;
+			event.value = edges[i].value ? HIGH : LOW;
+			event.data = data[i];
+			output_push(event);
+		}
+
+		error = output_start();
+		if (error)
+			return error;
+	}
+	gpio_clock_notify(output->cond);
+
+	_D("success gpio_output_schedule");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_output_cancel(gpio_pin_e pin, unsigned int *cancel_count)
+{
+	unsigned int count = 0;
+
+	_D("called gpio_output_cancel : pin[%d]", pin);
+
+	{
+		std::lock_guard<std::mutex> lock(output->lock);
+		std::vector<gpio_output_event_s> &heap = output->heap;
+
+		for (size_t i = 0; i < heap.size();) {
+			if (heap[i].type == OUTPUT_WRITE && heap[i].pin == pin) {
+				heap[i] = heap.back();
+				heap.pop_back();
+				count++;
+			} else {
+				i++;
+			}
+		}
+		if (count)
+			std::make_heap(heap.begin(), heap.end(), event_later);
+	}
+	gpio_clock_notify(output->cond);
+
+	if (cancel_count)
+		*cancel_count = count;
+
+	_D("success gpio_output_cancel : %u writes", count);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_output_read_reports(gpio_output_report_s *reports, unsigned int max_count,
+		unsigned int *count, unsigned long long *lost)
+{
+	std::lock_guard<std::mutex> lock(output->lock);
+	unsigned int n = 0;
+
+	if ((!reports && max_count) || !count || !lost)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	while (n < max_count && output->report_count) {
+		reports[n++] = output->reports[output->report_head];
+		output->report_head = (output->report_head + 1) % GPIO_OUTPUT_REPORTS;
+		output->report_count--;
+	}
+
+	*count = n;
+	*lost = output->report_lost;
+	output->report_lost = 0;
+
+	return GPIO_ERROR_NONE;
+}
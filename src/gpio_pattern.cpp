@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <new>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_pattern.h"
+#include "gpio_log.h"
+
+#define GPIO_PATTERN_PORT_PINS 8
+#define GPIO_PATTERN_AHEAD (4 << 20) //samples the prefetcher keeps mapped ahead of playback
+#define GPIO_PATTERN_CHUNK (256 << 10) //samples prefetched or released at once
+#define GPIO_PATTERN_PUBLISH_MASK 1023 //playback position is published every 1024 samples
+#define GPIO_PATTERN_POLL_US 1000
+
+/*
+ * A pattern plays from a read-only mapping of its file, so it never has
+ * to fit in memory. A prefetch thread faults the values in up to
+ * GPIO_PATTERN_AHEAD samples ahead of playback, and releases the pages
+ * already played; the playing thread only reads memory that is already
+ * there. A sample played beyond what was prefetched is an underrun: it
+ * may stall on a page fault.
+ */
+struct gpio_pattern_s {
+	const uint8_t *map;
+	size_t size;
+	const uint8_t *values;
+	uint64_t sample_count;
+	uint64_t period_ns;
+	gpio_port_e port;
+	uint8_t mask;
+	volatile uint32_t *data; //data register of the port
+
+	std::atomic<uint64_t> played; //published every few samples by the playing thread
+	std::atomic<uint64_t> prefetched;
+	std::atomic<uint64_t> late; //samples written more than one period late
+	std::atomic<uint64_t> underruns; //samples played before they were prefetched
+
+	std::atomic<bool> running;
+	std::thread thread;
+	std::thread prefetcher;
+};
+
+/* Faults in the values of samples [first, last) */
+static void pattern_fetch(struct gpio_pattern_s *pattern, uint64_t first, uint64_t last)
+{
+	size_t page = getpagesize();
+	uintptr_t start = (uintptr_t)(pattern->values + first) & ~(page - 1);
+	volatile uint8_t sink = 0;
+
+	madvise((void *)start, (uintptr_t)(pattern->values + last) - start, MADV_WILLNEED);
+	for (uintptr_t p = start; p < (uintptr_t)(pattern->values + last); p += page)
+		sink += *(const uint8_t *)p;
+	(void)sink;
+	pattern->prefetched.store(last, std::memory_order_release);
+}
+
+/* Drops the pages of samples before @sample, which are played */
+static void pattern_release(struct gpio_pattern_s *pattern, uint64_t sample)
+{
+	size_t page = getpagesize();
+	uintptr_t start = (uintptr_t)pattern->map;
+	uintptr_t end = (uintptr_t)(pattern->values + sample) & ~(page - 1);
+
+	if (end > start)
+		madvise((void *)start, end - start, MADV_DONTNEED);
+}
+
+static void pattern_prefetcher(struct gpio_pattern_s *pattern)
+{
+	uint64_t released = 0;
+
+	while (pattern->running.load(std::memory_order_relaxed)) {
+		uint64_t played = pattern->played.load(std::memory_order_acquire);
+		uint64_t prefetched = pattern->prefetched.load(std::memory_order_relaxed);
+
+		if (played >= released + GPIO_PATTERN_CHUNK) {
+			pattern_release(pattern, played);
+			released = played;
+		}
+
+		if (prefetched < pattern->sample_count && prefetched < played + GPIO_PATTERN_AHEAD) {
+			pattern_fetch(pattern, prefetched,
+					std::min(prefetched + GPIO_PATTERN_CHUNK, pattern->sample_count));
+			continue;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(GPIO_PATTERN_POLL_US));
+	}
+}
+
+static void pattern_player(struct gpio_pattern_s *pattern)
+{
+	const uint8_t *values = pattern->values;
+	volatile uint32_t *data = pattern->data;
+	uint32_t mask = pattern->mask;
+	uint64_t period_ns = pattern->period_ns;
+	uint64_t prefetched = pattern->prefetched.load(std::memory_order_acquire);
+	uint64_t late = 0, underruns = 0;
+	uint64_t next = gpio_steady_now_ns();
+	uint64_t i;
+
+	for (i = 0; i < pattern->sample_count && pattern->running.load(std::memory_order_relaxed); i++) {
+		uint64_t now;
+
+		if (i >= prefetched) {
+			prefetched = pattern->prefetched.load(std::memory_order_acquire);
+			if (i >= prefetched)
+				underruns++;
+		}
+
+		now = gpio_steady_wait_until(next);
+		if (now - next > period_ns)
+			late++;
+
+		*data = gpio_data_drive(*data, values[i] & mask, ~values[i] & mask);
+		next += period_ns;
+
+		if (!(i & GPIO_PATTERN_PUBLISH_MASK)) {
+			pattern->played.store(i, std::memory_order_release);
+			pattern->late.store(late, std::memory_order_relaxed);
+			pattern->underruns.store(underruns, std::memory_order_relaxed);
+		}
+	}
+
+	pattern->played.store(i, std::memory_order_release);
+	pattern->late.store(late, std::memory_order_relaxed);
+	pattern->underruns.store(underruns, std::memory_order_relaxed);
+	pattern->running = false;
+}
+
+int gpio_pattern_write(const char *path, gpio_port_e port, uint8_t mask, unsigned int sample_rate,
+		const uint8_t *values, unsigned long long sample_count)
+{
+	struct gpio_pattern_header_s header;
+	FILE *fp;
+	bool ok;
+
+	_D("called gpio_pattern_write : path[%s], port[0x%x], mask[0x%x], sample_rate[%u], sample_count[%llu]",
+			path, port, mask, sample_rate, sample_count);
+
+	if (!path || !gpio_port_valid(port) || !mask || !sample_rate || sample_rate > GPIO_NS_PER_SEC ||
+			(!values && sample_count))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	fp = fopen(path, "wb");
+	if (!fp)
+		return GPIO_ERROR_IO_ERROR;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = GPIO_PATTERN_MAGIC;
+	header.version = GPIO_PATTERN_VERSION;
+	header.header_size = sizeof(header);
+	header.port = port;
+	header.mask = mask;
+	header.period_ns = GPIO_NS_PER_SEC / sample_rate;
+	header.sample_count = sample_count;
+
+	ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		fwrite(values, 1, sample_count, fp) == sample_count;
+	if (fclose(fp) != 0 || !ok) {
+		unlink(path);
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	_D("success gpio_pattern_write");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pattern_open(const char *path, gpio_pattern_h *pattern)
+{
+	struct gpio_pattern_s *_pattern;
+	struct gpio_pattern_header_s header;
+	struct stat st;
+	void *map;
+	int fd;
+
+	_D("called gpio_pattern_open : path[%s]", path);
+
+	if (!path || !pattern)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(header)) {
+		close(fd);
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return GPIO_ERROR_IO_ERROR;
+
+	memcpy(&header, map, sizeof(header));
+	/* The port picks the register the player stores to, so a file must not choose an arbitrary one */
+	if (header.magic != GPIO_PATTERN_MAGIC || header.version != GPIO_PATTERN_VERSION ||
+			header.header_size < sizeof(header) || !gpio_port_valid((gpio_port_e)header.port) || !header.mask || header.mask >> GPIO_PATTERN_PORT_PINS ||
+			!header.period_ns || header.header_size > (uint64_t)st.st_size ||
+			header.sample_count > (uint64_t)st.st_size - header.header_size) {
+		_E("%s is not a valid pattern", path);
+		munmap(map, st.st_size);
+		return GPIO_ERROR_INVALID_PARAMETER;
+	}
+
+	if (gpio_port_init() < 0) {
+		munmap(map, st.st_size);
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	_pattern = new(std::nothrow) struct gpio_pattern_s;
+	if (!_pattern) {
+		munmap(map, st.st_size);
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	_pattern->map = (const uint8_t *)map;
+	_pattern->size = st.st_size;
+	_pattern->values = _pattern->map + header.header_size;
+	_pattern->sample_count = header.sample_count;
+	_pattern->period_ns = header.period_ns;
+	_pattern->port = (gpio_port_e)header.port;
+	_pattern->mask = header.mask;
+	_pattern->data = gpio_port_data(_pattern->port);
+	_pattern->played = 0;
+	_pattern->prefetched = 0;
+	_pattern->late = 0;
+	_pattern->underruns = 0;
+	_pattern->running = false;
+
+	*pattern = _pattern;
+
+	_D("success gpio_pattern_open : pattern[0x%x], %llu samples", _pattern,
+			(unsigned long long)_pattern->sample_count);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pattern_close(gpio_pattern_h pattern)
+{
+	_D("called gpio_pattern_close : pattern[0x%x]", pattern);
+
+	if (!pattern)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	gpio_pattern_stop(pattern);
+
+	munmap((void *)pattern->map, pattern->size);
+	delete pattern;
+
+	_D("success gpio_pattern_close");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pattern_start(gpio_pattern_h pattern)
+{
+	_D("called gpio_pattern_start : pattern[0x%x]", pattern);
+
+	if (!pattern || pattern->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* The previous run may have ended by itself */
+	gpio_pattern_stop(pattern);
+
+	for (int pin = 0; pin < GPIO_PATTERN_PORT_PINS; pin++) {
+		if ((pattern->mask >> pin & 1) &&
+				gpio_pin_set_direction((gpio_pin_e)((pattern->port << 3) + pin), GPIO_OUT) < 0)
+			return GPIO_ERROR_IO_ERROR;
+	}
+
+	pattern->played = 0;
+	pattern->late = 0;
+	pattern->underruns = 0;
+
+	/* Playback starts with its lead already in memory */
+	pattern_fetch(pattern, 0, std::min((uint64_t)GPIO_PATTERN_AHEAD, pattern->sample_count));
+
+	pattern->running = true;
+	try {
+		pattern->prefetcher = std::thread(pattern_prefetcher, pattern);
+		pattern->thread = std::thread(pattern_player, pattern);
+	} catch (...) {
+		gpio_pattern_stop(pattern);
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	_D("success gpio_pattern_start");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pattern_stop(gpio_pattern_h pattern)
+{
+	_D("called gpio_pattern_stop : pattern[0x%x]", pattern);
+
+	if (!pattern)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	pattern->running = false;
+	if (pattern->thread.joinable())
+		pattern->thread.join();
+	if (pattern->prefetcher.joinable())
+		pattern->prefetcher.join();
+
+	_D("success gpio_pattern_stop : %llu samples, %llu late, %llu underruns",
+			(unsigned long long)pattern->played.load(), (unsigned long long)pattern->late.load(),
+			(unsigned long long)pattern->underruns.load());
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_pattern_get_stats(gpio_pattern_h pattern, gpio_pattern_stats_s *stats)
+{
+	if (!pattern || !stats)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	stats->running = pattern->running;
+	stats->samples_played = pattern->played.load(std::memory_order_acquire);
+	stats->samples_late = pattern->late.load(std::memory_order_relaxed);
+	stats->samples_underrun = pattern->underruns.load(std::memory_order_relaxed);
+	stats->sample_count = pattern->sample_count;
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+#define GPIO_REPLAY_LINE_MAX 256
+
+struct gpio_replay_event_s {
+	uint64_t time_ns;
+	gpio_pin_e pin;
+	gpio_value_e value;
+};
+
+/*
+ * Feeds a trace to the listeners through virtual ports: each change is
+ * written to the port, then delivered by gpio_sampler_feed() with the
+ * trace time as the event time.
+ */
+struct gpio_replay_s {
+	gpio_edgelog_h log; //edge log source, or NULL for a waveform
+	std::vector<gpio_replay_event_s> waveform;
+	std::vector<gpio_port_e> ports;
+	std::vector<uint32_t> states; //current state of each port, for waveforms
+	uint64_t start_ns;
+	uint64_t end_ns;
+	double speed; //trace time per wall time, 0 for as fast as possible
+
+	uint64_t clock_start_ns;
+	std::atomic<bool> running;
+	std::atomic<bool> stopping;
+	std::atomic<unsigned long long> event_count;
+	std::mutex lock;
+	std::condition_variable cond;
+	std::thread thread;
+};
+
+/* Waits for the clock time matching @time_ns in the trace; false once stopping */
+static bool replay_wait(struct gpio_replay_s *replay, uint64_t time_ns)
+{
+	uint64_t target;
+
+	if (replay->speed <= 0)
+		return !replay->stopping.load();
+
+	target = replay->clock_start_ns + (uint64_t)((time_ns - replay->start_ns) / replay->speed);
+
+	std::unique_lock<std::mutex> lock(replay->lock);
+	while (!replay->stopping.load() && gpio_clock_now_ns() < target)
+		gpio_clock_wait_until(lock, replay->cond, target);
+	return !replay->stopping.load();
+}
+
+static void replay_apply(struct gpio_replay_s *replay, gpio_port_e port, uint32_t state, uint64_t time_ns)
+{
+	gpio_virtual_port_set(port, state);
+	gpio_sampler_feed(port, time_ns / GPIO_NS_PER_MS);
+	replay->event_count++;
+}
+
+static bool replay_edge(const gpio_edgelog_record_s *record, void *user_data)
+{
+	struct gpio_replay_s *replay = (struct gpio_replay_s *)user_data;
+
+	if (!replay_wait(replay, record->timestamp))
+		return false;
+	replay_apply(replay, record->port, record->state, record->timestamp);
+	return true;
+}
+
+static void replay_run(struct gpio_replay_s *replay)
+{
+	gpio_clock_enter();
+	if (replay->log) {
+		gpio_edgelog_foreach_edge(replay->log, replay->start_ns, replay->end_ns, replay_edge, replay);
+	} else {
+		for (size_t i = 0; i < replay->waveform.size(); i++) {
+			const gpio_replay_event_s &event = replay->waveform[i];
+			gpio_port_e port = (gpio_port_e)GET_PORT(event.pin);
+			uint32_t bit = 1 << GET_OFFSET(event.pin);
+			size_t p = 0;
+
+			if (!replay_wait(replay, event.time_ns))
+				break;
+
+			while (replay->ports[p] != port)
+				p++;
+			replay->states[p] = event.value ? (replay->states[p] | bit) : (replay->states[p] & ~bit);
+			replay_apply(replay, port, replay->states[p], event.time_ns);
+		}
+	}
+
+	replay->running = false;
+}
+
+/* Makes the ports of the trace virtual, in their initial states, until the replay is destroyed */
+static int replay_attach(struct gpio_replay_s *replay)
+{
+	for (size_t p = 0; p < replay->ports.size(); p++) {
+		if (gpio_virtual_port_attach(replay->ports[p], replay->states[p]) < 0) {
+			for (size_t q = 0; q < p; q++)
+				gpio_virtual_port_detach(replay->ports[q]);
+			return GPIO_ERROR_OUT_OF_MEMORY;
+		}
+	}
+	return GPIO_ERROR_NONE;
+}
+
+static struct gpio_replay_s *replay_alloc(void)
+{
+	struct gpio_replay_s *replay = new(std::nothrow) struct gpio_replay_s;
+
+	if (!replay)
+		return NULL;
+
+	replay->log = NULL;
+	replay->start_ns = 0;
+	replay->end_ns = 0;
+	replay->speed = 1.0;
+	replay->clock_start_ns = 0;
+	replay->running = false;
+	replay->stopping = false;
+	replay->event_count = 0;
+	return replay;
+}
+
+int gpio_replay_create_from_edgelog(const char *path, gpio_replay_h *replay)
+{
+	struct gpio_replay_s *_replay;
+	unsigned long long start_ns, end_ns, record_count;
+	int port_count;
+	int error;
+
+	_D("called gpio_replay_create_from_edgelog : path[%s]", path);
+
+	if (!path || !replay)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	_replay = replay_alloc();
+	if (!_replay)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	error = gpio_edgelog_open(path, &_replay->log);
+	if (error) {
+		delete _replay;
+		return error;
+	}
+
+	gpio_edgelog_get_range(_replay->log, &start_ns, &end_ns, &record_count);
+	gpio_edgelog_get_ports(_replay->log, NULL, 0, &port_count);
+	_replay->start_ns = start_ns;
+	_replay->end_ns = end_ns;
+	_replay->ports.resize(port_count);
+	_replay->states.resize(port_count);
+	gpio_edgelog_get_ports(_replay->log, &_replay->ports[0], port_count, &port_count);
+
+	/* The states before the first record, which may be at the start time, even 0 */
+	for (int p = 0; p < port_count; p++) {
+		uint8_t state = 0;
+
+		gpio_edgelog_get_initial_state(_replay->log, _replay->ports[p], &state);
+		_replay->states[p] = state;
+	}
+
+	error = replay_attach(_replay);
+	if (error) {
+		gpio_edgelog_close(_replay->log);
+		delete _replay;
+		return error;
+	}
+
+	*replay = _replay;
+
+	_D("success gpio_replay_create_from_edgelog : replay[0x%x], %llu records", _replay, record_count);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_replay_create_from_waveform(const char *path, gpio_replay_h *replay)
+{
+	struct gpio_replay_s *_replay;
+	char line[GPIO_REPLAY_LINE_MAX];
+	int line_number = 0;
+	FILE *fp;
+	int error;
+
+	_D("called gpio_replay_create_from_waveform : path[%s]", path);
+
+	if (!path || !replay)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return GPIO_ERROR_IO_ERROR;
+
+	_replay = replay_alloc();
+	if (!_replay) {
+		fclose(fp);
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	/* One "<time_ns> <pin> <value>" per line, in time order; '#' starts a comment */
+	while (fgets(line, sizeof(line), fp)) {
+		gpio_replay_event_s event;
+		unsigned long long time_ns;
+		long pin;
+		int value;
+		char *comment = strchr(line, '#');
+
+		line_number++;
+		if (comment)
+			*comment = '\0';
+		if (strspn(line, " \t\r\n") == strlen(line))
+			continue;
+
+		if (sscanf(line, "%llu %li %d", &time_ns, &pin, &value) != 3 || pin < 0 ||
+				(!_replay->waveform.empty() && time_ns < _replay->waveform.back().time_ns)) {
+			_E("%s:%d: invalid waveform line", path, line_number);
+			fclose(fp);
+			delete _replay;
+			return GPIO_ERROR_INVALID_PARAMETER;
+		}
+
+		event.time_ns = time_ns;
+		event.pin = (gpio_pin_e)pin;
+		event.value = value ? HIGH : LOW;
+		_replay->waveform.push_back(event);
+
+		bool known = false;
+		for (size_t p = 0; p < _replay->ports.size(); p++)
+			known |= _replay->ports[p] == (gpio_port_e)GET_PORT(pin);
+		if (!known) {
+			_replay->ports.push_back((gpio_port_e)GET_PORT(pin));
+			_replay->states.push_back(0);
+		}
+	}
+	fclose(fp);
+
+	if (!_replay->waveform.empty()) {
+		_replay->start_ns = _replay->waveform.front().time_ns;
+		_replay->end_ns = _replay->waveform.back().time_ns;
+	}
+
+	error = replay_attach(_replay);
+	if (error) {
+		delete _replay;
+		return error;
+	}
+
+	*replay = _replay;
+
+	_D("success gpio_replay_create_from_waveform : replay[0x%x], %zu events", _replay, _replay->waveform.size());
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_replay_destroy(gpio_replay_h replay)
+{
+	_D("called gpio_replay_destroy : replay[0x%x]", replay);
+
+	if (!replay)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	gpio_replay_stop(replay);
+
+	/* Only the attachments of this replay: injections and other replays keep theirs */
+	for (size_t p = 0; p < replay->ports.size(); p++)
+		gpio_virtual_port_detach(replay->ports[p]);
+	if (replay->log)
+		gpio_edgelog_close(replay->log);
+	delete replay;
+
+	_D("success gpio_replay_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_replay_set_speed(gpio_replay_h replay, double speed)
+{
+	_D("called gpio_replay_set_speed : replay[0x%x], speed[%f]", replay, speed);
+
+	/* NaN fails every comparison; 0 plays as fast as possible */
+	if (!replay || !(speed >= 0) || !std::isfinite(speed) || replay->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	replay->speed = speed;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_replay_start(gpio_replay_h replay)
+{
+	_D("called gpio_replay_start : replay[0x%x]", replay);
+
+	if (!replay || replay->running)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	/* A previous run may have ended by itself */
+	if (replay->thread.joinable())
+		replay->thread.join();
+
+	/* Every run starts from the initial states */
+	if (!replay->log)
+		std::fill(replay->states.begin(), replay->states.end(), 0);
+	for (size_t p = 0; p < replay->ports.size(); p++)
+		gpio_virtual_port_set(replay->ports[p], replay->states[p]);
+
+	replay->event_count = 0;
+	replay->stopping = false;
+	replay->running = true;
+	replay->clock_start_ns = gpio_clock_now_ns();
+
+	gpio_clock_hold();
+	try {
+		replay->thread = std::thread(replay_run, replay);
+	} catch (...) {
+		gpio_clock_release();
+		replay->running = false;
+		return GPIO_ERROR_IO_ERROR;
+	}
+
+	_D("success gpio_replay_start");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_replay_stop(gpio_replay_h replay)
+{
+	_D("called gpio_replay_stop : replay[0x%x]", replay);
+
+	if (!replay)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	{
+		std::lock_guard<std::mutex> lock(replay->lock);
+		replay->stopping = true;
+	}
+	gpio_clock_notify(replay->cond);
+	if (replay->thread.joinable())
+		replay->thread.join();
+
+	_D("success gpio_replay_stop : %llu events", replay->event_count.load());
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_replay_get_progress(gpio_replay_h replay, bool *running, unsigned long long *event_count)
+{
+	if (!replay || !running || !event_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	*running = replay->running;
+	*event_count = replay->event_count;
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <new>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_log.h"
+
+/*
+ * Bit-banged SPI master. A transfer snapshots the ports of its pins once,
+ * then precomputes every image the clock port goes through: clock idle
+ * or active, times the MOSI bit when MOSI is on the same port. Each half
+ * clock is then a single store of a precomputed image, plus one to the
+ * MOSI port when MOSI is elsewhere. The other pins of those ports keep
+ * the level they had when the transfer started.
+ */
+struct gpio_spi_s {
+	gpio_pin_e sclk;
+	gpio_pin_e mosi;
+	gpio_pin_e miso;
+	gpio_pin_e cs;
+	bool has_miso;
+	bool has_cs;
+	gpio_spi_mode_e mode;
+	gpio_spi_bit_order_e bit_order;
+	uint64_t half_ns; //half a clock period, 0 for as fast as possible
+};
+
+/* Waits for the end of the current half clock */
+static inline void spi_wait(uint64_t *next, uint64_t half_ns)
+{
+	if (!half_ns)
+		return;
+	*next += half_ns;
+	gpio_steady_wait_until(*next);
+}
+
+int gpio_spi_create(gpio_pin_e sclk, gpio_pin_e mosi, gpio_spi_h *spi)
+{
+	struct gpio_spi_s *_spi;
+
+	_D("called gpio_spi_create : sclk[%d], mosi[%d]", sclk, mosi);
+
+	if (!spi || sclk == mosi)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_port_init() < 0 ||
+			gpio_pin_set_direction(sclk, GPIO_OUT) < 0 || gpio_pin_set_direction(mosi, GPIO_OUT) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	_spi = new(std::nothrow) struct gpio_spi_s;
+	if (!_spi)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_spi->sclk = sclk;
+	_spi->mosi = mosi;
+	_spi->has_miso = false;
+	_spi->has_cs = false;
+	_spi->mode = GPIO_SPI_MODE_0;
+	_spi->bit_order = GPIO_SPI_BIT_ORDER_MSB;
+	_spi->half_ns = 0;
+
+	*spi = _spi;
+
+	_D("success gpio_spi_create : spi[0x%x]", _spi);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_destroy(gpio_spi_h spi)
+{
+	_D("called gpio_spi_destroy : spi[0x%x]", spi);
+
+	if (!spi)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	delete spi;
+
+	_D("success gpio_spi_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_set_miso(gpio_spi_h spi, gpio_pin_e miso)
+{
+	_D("called gpio_spi_set_miso : spi[0x%x], miso[%d]", spi, miso);
+
+	if (!spi || miso == spi->sclk || miso == spi->mosi || (spi->has_cs && miso == spi->cs))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_pin_set_direction(miso, GPIO_IN) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	spi->miso = miso;
+	spi->has_miso = true;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_set_cs(gpio_spi_h spi, gpio_pin_e cs)
+{
+	volatile uint32_t *data;
+
+	_D("called gpio_spi_set_cs : spi[0x%x], cs[%d]", spi, cs);
+
+	if (!spi || cs == spi->sclk || cs == spi->mosi || (spi->has_miso && cs == spi->miso))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	if (gpio_pin_set_direction(cs, GPIO_OUT) < 0)
+		return GPIO_ERROR_IO_ERROR;
+
+	/* Inactive until a transfer */
+	data = gpio_port_data((gpio_port_e)GET_PORT(cs));
+	*data = gpio_data_drive(*data, 1 << GET_OFFSET(cs), 0);
+
+	spi->cs = cs;
+	spi->has_cs = true;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_set_mode(gpio_spi_h spi, gpio_spi_mode_e mode)
+{
+	_D("called gpio_spi_set_mode : spi[0x%x], mode[%d]", spi, mode);
+
+	if (!spi || mode < GPIO_SPI_MODE_0 || mode > GPIO_SPI_MODE_3)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	spi->mode = mode;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_set_bit_order(gpio_spi_h spi, gpio_spi_bit_order_e bit_order)
+{
+	_D("called gpio_spi_set_bit_order : spi[0x%x], bit_order[%d]", spi, bit_order);
+
+	if (!spi || (bit_order != GPIO_SPI_BIT_ORDER_MSB && bit_order != GPIO_SPI_BIT_ORDER_LSB))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	spi->bit_order = bit_order;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_set_frequency(gpio_spi_h spi, unsigned int frequency_hz)
+{
+	_D("called gpio_spi_set_frequency : spi[0x%x], frequency_hz[%u]", spi, frequency_hz);
+
+	if (!spi || frequency_hz > GPIO_NS_PER_SEC / 2)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	spi->half_ns = frequency_hz ? GPIO_NS_PER_SEC / 2 / frequency_hz : 0;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_spi_transfer(gpio_spi_h spi, const uint8_t *tx, uint8_t *rx, unsigned int length)
+{
+	volatile uint32_t *sclk_data, *mosi_data, *miso_data, *cs_data = NULL;
+	uint32_t sclk_bit, mosi_bit, miso_bit = 0, cs_bit = 0;
+	uint32_t no_miso = 0;
+	uint32_t clock[2][2]; //clock port images, [clock active][MOSI bit]
+	uint32_t data[2]; //MOSI port images, when it is not the clock port
+	bool cpol, cpha, shared;
+	bool msb_first;
+	uint64_t next;
+	unsigned int bit = 0, mosi_level = 2; //MOSI level last stored, none yet
+
+	_D("called gpio_spi_transfer : spi[0x%x], length[%u]", spi, length);
+
+	if (!spi || (rx && !spi->has_miso))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	sclk_data = gpio_port_data((gpio_port_e)GET_PORT(spi->sclk));
+	mosi_data = gpio_port_data((gpio_port_e)GET_PORT(spi->mosi));
+	sclk_bit = 1 << GET_OFFSET(spi->sclk);
+	mosi_bit = 1 << GET_OFFSET(spi->mosi);
+	miso_data = &no_miso;
+	if (spi->has_miso) {
+		miso_data = gpio_port_data((gpio_port_e)GET_PORT(spi->miso));
+		miso_bit = 1 << GET_OFFSET(spi->miso);
+	}
+	if (spi->has_cs) {
+		cs_data = gpio_port_data((gpio_port_e)GET_PORT(spi->cs));
+		cs_bit = 1 << GET_OFFSET(spi->cs);
+	}
+
+	cpol = spi->mode & 2;
+	cpha = spi->mode & 1;
+	shared = sclk_data == mosi_data;
+	msb_first = spi->bit_order == GPIO_SPI_BIT_ORDER_MSB;
+
+	/* The clock idles before the chip is selected */
+	*sclk_data = gpio_data_drive(*sclk_data, cpol ? sclk_bit : 0, cpol ? 0 : sclk_bit);
+	if (cs_data)
+		*cs_data = gpio_data_drive(*cs_data, 0, cs_bit);
+
+	for (int active = 0; active < 2; active++) {
+		for (int b = 0; b < 2; b++) {
+			bool high = active ^ cpol;
+			uint32_t image = gpio_data_drive(*sclk_data, high ? sclk_bit : 0, high ? 0 : sclk_bit);
+
+			clock[active][b] = shared ? gpio_data_drive(image, b ? mosi_bit : 0, b ? 0 : mosi_bit) : image;
+		}
+	}
+	data[0] = gpio_data_drive(*mosi_data, 0, mosi_bit);
+	data[1] = gpio_data_drive(*mosi_data, mosi_bit, 0);
+
+	next = gpio_steady_now_ns();
+	for (unsigned int i = 0; i < length; i++) {
+		uint8_t out = tx ? tx[i] : 0;
+		uint8_t in = 0;
+
+		for (int n = 0; n < 8; n++) {
+			int shift = msb_first ? 7 - n : n;
+			uint32_t sample;
+
+			bit = (out >> shift) & 1;
+
+			/*
+			 * Modes 0 and 2 set the data up while the clock idles and sample on the leading edge;
+			 * modes 1 and 3 shift it out on the leading edge and sample on the trailing one
+			 */
+			if (!shared && bit != mosi_level) {
+				*mosi_data = data[bit];
+				mosi_level = bit;
+			}
+			*sclk_data = clock[cpha][bit];
+			spi_wait(&next, spi->half_ns);
+
+			if (cpha) {
+				sample = *miso_data;
+				*sclk_data = clock[0][bit];
+			} else {
+				*sclk_data = clock[1][bit];
+				sample = *miso_data;
+			}
+			spi_wait(&next, spi->half_ns);
+
+			in |= !!(sample & miso_bit) << shift;
+		}
+		if (rx)
+			rx[i] = in;
+	}
+
+	/* Back to idle, then the chip is released */
+	*sclk_data = clock[0][bit];
+	spi_wait(&next, spi->half_ns);
+	if (cs_data)
+		*cs_data = gpio_data_drive(*cs_data, cs_bit, 0);
+
+	_D("success gpio_spi_transfer");
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include <mutex>
+
+#include "gpio.h"
+#include "gpio_private.h"
+#include "gpio_capture.h"
+#include "gpio_log.h"
+
+/*
+ * A summary keeps, for windows of GPIO_SUMMARY_WINDOW samples, whether
+ * the pin was ever high, ever low, and how many edges the window holds.
+ * Level k merges pairs of windows of level k - 1, so a window of level k
+ * spans GPIO_SUMMARY_WINDOW << k samples; a level only holds complete
+ * pairs. Any range of whole windows then takes one entry per level and
+ * side, and the next window holding an edge is found the same way.
+ *
+ * An edge is at position p when sample p differs from sample p - 1.
+ * Sample 0, and the first sample after a gap, are not edges.
+ */
+
+#define GPIO_SUMMARY_WINDOW_WORDS 16
+#define GPIO_SUMMARY_WINDOW (GPIO_SUMMARY_WINDOW_WORDS * GPIO_CAPTURE_WORD_BITS)
+
+/* An entry: bit 63 when the pin was high, bit 62 when it was low, then the edge count */
+#define SUMMARY_HIGH (1ULL << 63)
+#define SUMMARY_LOW (1ULL << 62)
+#define SUMMARY_EDGES(entry) ((entry) & (SUMMARY_LOW - 1))
+
+struct gpio_summary_s {
+	std::mutex lock;
+	std::vector<std::vector<uint64_t>> levels;
+	uint64_t open; //entry of the window being filled
+	uint64_t sample_count;
+	uint64_t last; //last sample, valid if has_last
+	bool has_last;
+};
+
+static inline uint64_t summary_merge(uint64_t a, uint64_t b)
+{
+	return ((a | b) & (SUMMARY_HIGH | SUMMARY_LOW)) + SUMMARY_EDGES(a) + SUMMARY_EDGES(b);
+}
+
+/* Adds a complete window to level 0, and the pairs it completes to the levels above */
+static void summary_close(struct gpio_summary_s *summary)
+{
+	uint64_t entry = summary->open;
+
+	summary->open = 0;
+	for (size_t k = 0; ; k++) {
+		if (k == summary->levels.size())
+			summary->levels.push_back(std::vector<uint64_t>());
+
+		std::vector<uint64_t> &level = summary->levels[k];
+
+		level.push_back(entry);
+		if (level.size() & 1)
+			break;
+		entry = summary_merge(level[level.size() - 2], level[level.size() - 1]);
+	}
+}
+
+static void summary_append_word(struct gpio_summary_s *summary, uint64_t word, unsigned int count)
+{
+	uint64_t mask = count < GPIO_CAPTURE_WORD_BITS ? (1ULL << count) - 1 : ~0ULL;
+	uint64_t edges = (word ^ ((word << 1) | summary->last)) & mask;
+
+	if (!summary->has_last)
+		edges &= ~1ULL;
+
+	summary->open += __builtin_popcountll(edges);
+	if (word & mask)
+		summary->open |= SUMMARY_HIGH;
+	if (~word & mask)
+		summary->open |= SUMMARY_LOW;
+
+	summary->last = (word >> (count - 1)) & 1;
+	summary->has_last = true;
+	summary->sample_count += count;
+	if (summary->sample_count % GPIO_SUMMARY_WINDOW == 0)
+		summary_close(summary);
+}
+
+void gpio_summary_reset(gpio_summary_h summary)
+{
+	std::lock_guard<std::mutex> lock(summary->lock);
+
+	summary->levels.clear();
+	summary->open = 0;
+	summary->sample_count = 0;
+	summary->last = 0;
+	summary->has_last = false;
+}
+
+void gpio_summary_skip(gpio_summary_h summary, unsigned long long sample)
+{
+	std::lock_guard<std::mutex> lock(summary->lock);
+
+	if (sample <= summary->sample_count)
+		return;
+
+	/* The missing samples are neither high nor low, and no edge spans them */
+	while (sample / GPIO_SUMMARY_WINDOW > summary->sample_count / GPIO_SUMMARY_WINDOW) {
+		summary->sample_count = (summary->sample_count / GPIO_SUMMARY_WINDOW + 1) * GPIO_SUMMARY_WINDOW;
+		summary_close(summary);
+	}
+	summary->sample_count = sample;
+	summary->has_last = false;
+	summary->last = 0;
+}
+
+/* Entry of samples [start, end) computed from the raw samples, end - start at most a window */
+static uint64_t summary_raw(const uint64_t *words, uint64_t start, uint64_t end)
+{
+	uint64_t entry = 0;
+
+	for (uint64_t w = start / GPIO_CAPTURE_WORD_BITS; w * GPIO_CAPTURE_WORD_BITS < end; w++) {
+		uint64_t first = w * GPIO_CAPTURE_WORD_BITS;
+		uint64_t mask = ~0ULL;
+
+		if (start > first)
+			mask &= ~0ULL << (start - first);
+		if (end - first < GPIO_CAPTURE_WORD_BITS)
+			mask &= (1ULL << (end - first)) - 1;
+
+		entry += __builtin_popcountll(gpio_capture_edge_word(words, w) & mask);
+		if (words[w] & mask)
+			entry |= SUMMARY_HIGH;
+		if (~words[w] & mask)
+			entry |= SUMMARY_LOW;
+	}
+	return entry;
+}
+
+/* Entry of the complete windows [lo, hi) of level 0 */
+static uint64_t summary_windows(struct gpio_summary_s *summary, uint64_t lo, uint64_t hi)
+{
+	uint64_t entry = 0;
+
+	for (size_t k = 0; lo < hi; k++) {
+		const std::vector<uint64_t> &level = summary->levels[k];
+
+		if (lo & 1)
+			entry = summary_merge(entry, level[lo++]);
+		if (hi & 1)
+			entry = summary_merge(entry, level[--hi]);
+		lo >>= 1;
+		hi >>= 1;
+	}
+	return entry;
+}
+
+/* Entry of window @window of level 0, the open one included */
+static uint64_t summary_window(struct gpio_summary_s *summary, uint64_t window)
+{
+	if (!summary->levels.empty() && window < summary->levels[0].size())
+		return summary->levels[0][window];
+	return summary->open;
+}
+
+/* Entry of samples [start, end), with end at most sample_count */
+static uint64_t summary_range(struct gpio_summary_s *summary, const uint64_t *words, uint64_t start, uint64_t end)
+{
+	uint64_t first = (start + GPIO_SUMMARY_WINDOW - 1) / GPIO_SUMMARY_WINDOW;
+	uint64_t last = end / GPIO_SUMMARY_WINDOW;
+	uint64_t entry;
+
+	/* Within a single window */
+	if (first > last) {
+		if (words)
+			return summary_raw(words, start, end);
+		return summary_window(summary, start / GPIO_SUMMARY_WINDOW);
+	}
+
+	entry = summary_windows(summary, first, last);
+
+	if (start < first * GPIO_SUMMARY_WINDOW) {
+		entry = summary_merge(entry, words ? summary_raw(words, start, first * GPIO_SUMMARY_WINDOW) :
+				summary_window(summary, first - 1));
+	}
+	if (end > last * GPIO_SUMMARY_WINDOW) {
+		entry = summary_merge(entry, words ? summary_raw(words, last * GPIO_SUMMARY_WINDOW, end) :
+				summary_window(summary, last));
+	}
+	return entry;
+}
+
+/* First complete window from @window on holding an edge, or the number of complete windows */
+static uint64_t summary_next_window(struct gpio_summary_s *summary, uint64_t window)
+{
+	std::vector<std::vector<uint64_t>> &levels = summary->levels;
+	size_t k = 0;
+	uint64_t i = window;
+
+	if (levels.empty())
+		return 0;
+
+	/* Goes up while the window starts a pair, and right along the level */
+	for (;;) {
+		if (i >= levels[k].size()) {
+			if (k == 0)
+				return levels[0].size();
+			k--;
+			i *= 2;
+			continue;
+		}
+		if (SUMMARY_EDGES(levels[k][i]))
+			break;
+		i++;
+		while (!(i & 1) && k + 1 < levels.size() && (i >> 1) < levels[k + 1].size()) {
+			i >>= 1;
+			k++;
+		}
+	}
+
+	/* Then down to the leftmost window holding an edge */
+	while (k > 0) {
+		k--;
+		i *= 2;
+		if (!SUMMARY_EDGES(levels[k][i]))
+			i++;
+	}
+	return i;
+}
+
+/* length * b / count, without overflowing */
+static inline uint64_t bucket_offset(uint64_t length, uint64_t b, uint64_t count)
+{
+	return length / count * b + length % count * b / count;
+}
+
+static void summary_to_range(uint64_t entry, gpio_summary_range_s *range)
+{
+	range->high = !!(entry & SUMMARY_HIGH);
+	range->low = !!(entry & SUMMARY_LOW);
+	range->edges = SUMMARY_EDGES(entry);
+}
+
+int gpio_summary_create(gpio_summary_h *summary)
+{
+	struct gpio_summary_s *_summary;
+
+	_D("called gpio_summary_create");
+
+	if (!summary)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	_summary = new(std::nothrow) struct gpio_summary_s;
+	if (!_summary)
+		return GPIO_ERROR_OUT_OF_MEMORY;
+
+	_summary->open = 0;
+	_summary->sample_count = 0;
+	_summary->last = 0;
+	_summary->has_last = false;
+
+	*summary = _summary;
+
+	_D("success gpio_summary_create : summary[0x%x]", _summary);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_summary_destroy(gpio_summary_h summary)
+{
+	_D("called gpio_summary_destroy : summary[0x%x]", summary);
+
+	if (!summary)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	delete summary;
+
+	_D("success gpio_summary_destroy");
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_summary_append(gpio_summary_h summary, const uint64_t *words, unsigned long long sample_count)
+{
+	if (!summary || (!words && sample_count))
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(summary->lock);
+
+	/* Only the last append may end within a word */
+	if (summary->sample_count % GPIO_CAPTURE_WORD_BITS)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	try {
+		for (uint64_t w = 0; w * GPIO_CAPTURE_WORD_BITS < sample_count; w++) {
+			uint64_t left = sample_count - w * GPIO_CAPTURE_WORD_BITS;
+
+			summary_append_word(summary, words[w],
+					left < GPIO_CAPTURE_WORD_BITS ? left : GPIO_CAPTURE_WORD_BITS);
+		}
+	} catch (...) {
+		return GPIO_ERROR_OUT_OF_MEMORY;
+	}
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_summary_get_sample_count(gpio_summary_h summary, unsigned long long *sample_count)
+{
+	if (!summary || !sample_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(summary->lock);
+	*sample_count = summary->sample_count;
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_summary_get_range(gpio_summary_h summary, const uint64_t *words,
+		unsigned long long start, unsigned long long end, gpio_summary_range_s *range)
+{
+	if (!summary || !range || start >= end)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(summary->lock);
+
+	if (end > summary->sample_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	summary_to_range(summary_range(summary, words, start, end), range);
+
+	return GPIO_ERROR_NONE;
+}
+
+int gpio_summary_find_edge(gpio_summary_h summary, const uint64_t *words,
+		unsigned long long from, unsigned long long *position)
+{
+	uint64_t window, found, complete;
+	unsigned int count;
+
+	if (!summary || !position)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(summary->lock);
+
+	if (from >= summary->sample_count)
+		return GPIO_ERROR_NO_DATA;
+
+	window = from / GPIO_SUMMARY_WINDOW;
+	complete = summary->levels.empty() ? 0 : summary->levels[0].size();
+
+	/* The rest of the window holding @from */
+	if (words) {
+		uint64_t end = (window + 1) * GPIO_SUMMARY_WINDOW;
+
+		if (end > summary->sample_count)
+			end = summary->sample_count;
+		gpio_capture_find_edges(words, end, GPIO_EDGE_BOTH, from, position, 1, &count);
+		if (count)
+			return GPIO_ERROR_NONE;
+		window++;
+	}
+
+	/* Past the complete windows, only the open one is left */
+	found = summary_next_window(summary, window);
+	if (found == complete && (window > complete || complete * GPIO_SUMMARY_WINDOW == summary->sample_count ||
+				!SUMMARY_EDGES(summary->open)))
+		return GPIO_ERROR_NO_DATA;
+	window = found;
+
+	if (!words) {
+		*position = window * GPIO_SUMMARY_WINDOW > from ? window * GPIO_SUMMARY_WINDOW : from;
+		return GPIO_ERROR_NONE;
+	}
+
+	gpio_capture_find_edges(words, summary->sample_count, GPIO_EDGE_BOTH,
+			window * GPIO_SUMMARY_WINDOW, position, 1, &count);
+
+	return count ? GPIO_ERROR_NONE : GPIO_ERROR_NO_DATA;
+}
+
+int gpio_summary_render(gpio_summary_h summary, const uint64_t *words,
+		unsigned long long start, unsigned long long end, gpio_summary_range_s *buckets, unsigned int bucket_count)
+{
+	uint64_t length = end - start;
+
+	if (!summary || !buckets || !bucket_count || start >= end || length < bucket_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	std::lock_guard<std::mutex> lock(summary->lock);
+
+	if (end > summary->sample_count)
+		return GPIO_ERROR_INVALID_PARAMETER;
+
+	for (unsigned int b = 0; b < bucket_count; b++) {
+		uint64_t first = start + bucket_offset(length, b, bucket_count);
+		uint64_t last = start + bucket_offset(length, b + 1, bucket_count);
+
+		summary_to_range(summary_range(summary, words, first, last), &buckets[b]);
+	}
+
+	return GPIO_ERROR_NONE;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2014 Samsung Electronics Co., Ltd All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Deterministic run of a listener and a replay on the virtual clock:
+ * every sampling and replay deadline up to an advance has run when
+ * gpio_clock_advance() returns, with timestamps of virtual time.
+ * Built with the sources of src, and run on the board as it maps the registers:
+ *
+ *   test_clock
+ *
+ * Exits with 0 if every check passed.
+ */
+
+#include <stdio.h>
+#include <atomic>
+
+#include "gpio.h"
+
+#define TEST_INTERVAL_MS 10
+#define TEST_RISE_MS 50
+#define TEST_FALL_MS 80
+#define TEST_WAVEFORM "/tmp/test_clock_waveform.txt"
+
+#define NS_PER_MS 1000000ULL
+
+static int failures = 0;
+
+static std::atomic<int> level_events(0);
+static std::atomic<unsigned long long> level_first(0);
+static std::atomic<unsigned long long> level_last(0);
+
+static std::atomic<int> replay_events(0);
+static std::atomic<unsigned long long> replay_timestamps[2];
+
+static void check(bool ok, const char *what)
+{
+	printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+static void level_cb(gpio_h gpio, gpio_event_s *event, void *data)
+{
+	if (!level_events++)
+		level_first = event->timestamp;
+	level_last = event->timestamp;
+}
+
+static void replay_cb(gpio_h gpio, gpio_event_s *event, void *data)
+{
+	int index = replay_events++;
+
+	if (index < 2)
+		replay_timestamps[index] = event->timestamp;
+}
+
+/*
+ * Advances the clock to 1 ns before the deadline of @change, @ms into the
+ * trace, then to the deadline: the line of the trace start is played with
+ * the replay, and is no edge.
+ */
+static void advance_through(gpio_replay_h replay, unsigned long long start_ns, unsigned long long ms,
+		int change, const char *what)
+{
+	unsigned long long now, played;
+	bool running;
+
+	gpio_clock_get_time(&now);
+	gpio_clock_advance(start_ns + ms * NS_PER_MS - 1 - now);
+	gpio_replay_get_progress(replay, &running, &played);
+	check(played == (unsigned long long)change && replay_events == change - 1, what);
+
+	gpio_clock_advance(1);
+	gpio_replay_get_progress(replay, &running, &played);
+	check(played == (unsigned long long)change + 1 && replay_events == change, what);
+}
+
+/* A pin held HIGH by injection, sampled every TEST_INTERVAL_MS: one LEVEL_HIGH event per interval */
+static void test_listener(void)
+{
+	gpio_h gpio;
+	gpio_listener_h listener;
+
+	if (gpio_get_default_gpio(J27_13, &gpio, GPIO_IN) != GPIO_ERROR_NONE ||
+			gpio_create_listener(gpio, &listener) != GPIO_ERROR_NONE) {
+		check(false, "listener created");
+		return;
+	}
+
+	gpio_inject_data(J27_13, HIGH);
+	gpio_listener_set_edge(listener, GPIO_EDGE_LEVEL_HIGH);
+	gpio_listener_set_event_cb(listener, TEST_INTERVAL_MS, level_cb, NULL);
+	gpio_listener_start(listener);
+	level_events = 0;
+
+	gpio_clock_advance(TEST_INTERVAL_MS * NS_PER_MS - 1);
+	check(level_events == 0, "no sample before the first interval");
+
+	gpio_clock_advance(1 + 9 * TEST_INTERVAL_MS * NS_PER_MS);
+	check(level_events == 10, "one sample per interval over ten intervals");
+	check(level_last - level_first == 9 * TEST_INTERVAL_MS, "samples timed to the interval");
+
+	gpio_listener_stop(listener);
+	gpio_destroy_listener(listener);
+	gpio_inject_detach(J27_13);
+}
+
+/* Each change of the waveform is played exactly at its deadline, and stamped with its trace time; on another port */
+static void test_replay(void)
+{
+	gpio_h gpio;
+	gpio_listener_h listener;
+	gpio_replay_h replay;
+	unsigned long long start, played;
+	bool running;
+	FILE *fp;
+
+	fp = fopen(TEST_WAVEFORM, "w");
+	if (!fp) {
+		check(false, "waveform written");
+		return;
+	}
+	fprintf(fp, "0 %d 0\n", (int)GPX0_0);
+	fprintf(fp, "%llu %d 1\n", TEST_RISE_MS * NS_PER_MS, (int)GPX0_0);
+	fprintf(fp, "%llu %d 0\n", TEST_FALL_MS * NS_PER_MS, (int)GPX0_0);
+	fclose(fp);
+
+	if (gpio_replay_create_from_waveform(TEST_WAVEFORM, &replay) != GPIO_ERROR_NONE) {
+		check(false, "replay created");
+		remove(TEST_WAVEFORM);
+		return;
+	}
+	remove(TEST_WAVEFORM);
+
+	if (gpio_get_default_gpio(GPX0_0, &gpio, GPIO_IN) != GPIO_ERROR_NONE ||
+			gpio_create_listener(gpio, &listener) != GPIO_ERROR_NONE) {
+		check(false, "listener created");
+		gpio_replay_destroy(replay);
+		return;
+	}
+
+	/* The port of the trace is virtual, and LOW, from the start of the replay: the listener sees only its changes */
+	gpio_listener_set_edge(listener, GPIO_EDGE_BOTH);
+	gpio_listener_set_event_cb(listener, TEST_INTERVAL_MS, replay_cb, NULL);
+	gpio_replay_set_speed(replay, 1.0);
+	gpio_clock_get_time(&start);
+	gpio_replay_start(replay);
+	gpio_listener_start(listener);
+
+	advance_through(replay, start, TEST_RISE_MS, 1, "rise played at its deadline");
+	advance_through(replay, start, TEST_FALL_MS, 2, "fall played at its deadline");
+	check(replay_timestamps[0] == TEST_RISE_MS && replay_timestamps[1] == TEST_FALL_MS,
+			"events stamped with the time of their change");
+
+	gpio_clock_advance(TEST_INTERVAL_MS * NS_PER_MS);
+	gpio_replay_get_progress(replay, &running, &played);
+	check(!running && played == 3, "replay ended with its trace");
+
+	gpio_listener_stop(listener);
+	gpio_destroy_listener(listener);
+	gpio_replay_destroy(replay);
+}
+
+int main(void)
+{
+	check(gpio_clock_advance(1) == GPIO_ERROR_INVALID_PARAMETER, "real clock refuses to advance");
+	check(gpio_clock_set_virtual(true) == GPIO_ERROR_NONE, "virtual clock selected");
+
+	test_listener();
+	test_replay();
+
+	check(gpio_clock_set_virtual(false) == GPIO_ERROR_NONE, "real clock selected again");
+
+	printf("%d failure(s)\n", failures);
+	return failures ? 1 : 0;
+}